@@ -0,0 +1,243 @@
+#include "AsyncWebAdapter.h"
+
+#ifdef SMOKER_ASYNC_WEB
+
+#include <SPIFFS.h>
+#include <string.h>
+
+// The body arrives in pieces before the request handler runs; it is assembled in
+// the request's scratch pointer, which the library frees with the request
+static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total)
+{
+    if (total > AsyncWebAdapter::MAX_BODY_SIZE)
+    {
+        return;
+    }
+    if (index == 0)
+    {
+        request->_tempObject = malloc(total + 1);
+        if (request->_tempObject == nullptr)
+        {
+            return;
+        }
+        static_cast<char *>(request->_tempObject)[total] = '\0';
+    }
+    if (request->_tempObject != nullptr && index + length <= total)
+    {
+        memcpy(static_cast<char *>(request->_tempObject) + index, data, length);
+    }
+}
+
+AsyncWebAdapter::AsyncWebAdapter(uint16_t port) : server(port), eventSource("/api/events") {}
+
+void AsyncWebAdapter::on(const char *uri, HTTPMethod method, Handler handler)
+{
+    server.on(uri, method, [this, handler](AsyncWebServerRequest *request)
+              { enqueue(request, handler, false); }, nullptr, collectBody);
+}
+
+void AsyncWebAdapter::onNotFound(Handler handler)
+{
+    server.onNotFound([this, handler](AsyncWebServerRequest *request)
+                      { enqueue(request, handler, false); });
+}
+
+void AsyncWebAdapter::onUpload(const char *uri, Handler handler)
+{
+    server.on(uri, HTTP_POST, [this, handler](AsyncWebServerRequest *request)
+              { enqueue(request, handler, true); }, nullptr,
+              [this](AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total)
+              { writeUpload(request, data, length, index, total); });
+}
+
+// On the AsyncTCP task: the body is written a TCP segment at a time, so an
+// upload costs one segment of RAM whatever the file size
+void AsyncWebAdapter::writeUpload(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total)
+{
+    if (index == 0)
+    {
+        UploadResult *result = static_cast<UploadResult *>(calloc(1, sizeof(UploadResult)));
+        request->_tempObject = result;
+        if (result == nullptr)
+        {
+            return;
+        }
+        String path = request->arg("path");
+        if (!path.startsWith("/"))
+            path = "/" + path;
+        if (uploadRequest != nullptr || path.length() < 2 || !(uploadFile = SPIFFS.open(path, "w")))
+        {
+            result->failed = true;
+            return;
+        }
+        uploadRequest = request;
+        request->onDisconnect([this, request]()
+                              { closeUpload(request); });
+    }
+
+    UploadResult *result = static_cast<UploadResult *>(request->_tempObject);
+    if (result == nullptr || request != uploadRequest)
+    {
+        return;
+    }
+    size_t written = uploadFile.write(data, length);
+    result->written += written;
+    result->failed = written != length;
+    if (result->failed || index + length >= total)
+    {
+        closeUpload(request);
+    }
+}
+
+void AsyncWebAdapter::closeUpload(AsyncWebServerRequest *request)
+{
+    if (request == uploadRequest)
+    {
+        uploadFile.close();
+        uploadRequest = nullptr;
+    }
+}
+
+long AsyncWebAdapter::uploadedBytes() const
+{
+    const UploadResult *result = currentUpload ? static_cast<const UploadResult *>(current->_tempObject) : nullptr;
+    return result != nullptr && !result->failed ? (long)result->written : -1;
+}
+
+void AsyncWebAdapter::begin()
+{
+    server.addHandler(&eventSource);
+    server.begin();
+}
+
+void AsyncWebAdapter::stop()
+{
+    server.end();
+}
+
+// On the AsyncTCP task: hand the complete request to the comms task
+void AsyncWebAdapter::enqueue(AsyncWebServerRequest *request, const Handler &handler, bool upload)
+{
+    if (!queue.push({request->pause(), &handler, upload}))
+    {
+        request->send(503, "text/plain", "Busy, try again");
+    }
+}
+
+void AsyncWebAdapter::handleClient()
+{
+    PendingRequest next;
+    while (queue.pop(next))
+    {
+        // Held for the handler, so a disconnect meanwhile cannot free it
+        std::shared_ptr<AsyncWebServerRequest> request = next.request.lock();
+        if (request)
+        {
+            dispatch(request.get(), *next.handler, next.upload);
+        }
+    }
+}
+
+void AsyncWebAdapter::dispatch(AsyncWebServerRequest *request, const Handler &handler, bool upload)
+{
+    current = request;
+    currentUpload = upload;
+    pendingHeaderCount = 0;
+
+    handler();
+
+    current = nullptr;
+    currentUpload = false;
+}
+
+bool AsyncWebAdapter::hasArg(const String &name) const
+{
+    if (name == "plain")
+    {
+        return !currentUpload && current->_tempObject != nullptr;
+    }
+    return current->hasArg(name.c_str());
+}
+
+String AsyncWebAdapter::arg(const String &name) const
+{
+    if (name == "plain")
+    {
+        return hasArg(name) ? String(static_cast<const char *>(current->_tempObject)) : String();
+    }
+    return current->arg(name);
+}
+
+bool AsyncWebAdapter::hasHeader(const String &name) const
+{
+    return current->hasHeader(name);
+}
+
+String AsyncWebAdapter::header(const String &name) const
+{
+    return current->header(name.c_str());
+}
+
+void AsyncWebAdapter::sendHeader(const String &name, const String &value)
+{
+    if (pendingHeaderCount < MAX_PENDING_HEADERS)
+    {
+        pendingHeaders[pendingHeaderCount][0] = name;
+        pendingHeaders[pendingHeaderCount][1] = value;
+        pendingHeaderCount++;
+    }
+    else
+    {
+        Serial.println("AsyncWebAdapter: too many response headers");
+    }
+}
+
+void AsyncWebAdapter::addPendingHeaders(AsyncWebServerResponse *response)
+{
+    for (int i = 0; i < pendingHeaderCount; ++i)
+    {
+        response->addHeader(pendingHeaders[i][0], pendingHeaders[i][1]);
+    }
+    pendingHeaderCount = 0;
+}
+
+void AsyncWebAdapter::respond(AsyncWebServerResponse *response)
+{
+    addPendingHeaders(response);
+    current->send(response);
+}
+
+void AsyncWebAdapter::send(int code, const char *contentType, const String &content)
+{
+    respond(current->beginResponse(code, contentType, content));
+}
+
+void AsyncWebAdapter::send_P(int code, const char *contentType, const char *content, size_t length)
+{
+    // Copied: the response is transmitted after the handler returns and the source may change by then
+    String body;
+    body.concat(content, length);
+    respond(current->beginResponse(code, contentType, body));
+}
+
+size_t AsyncWebAdapter::streamFile(File &file, const String &contentType)
+{
+    size_t size = file.size();
+    respond(current->beginResponse(SPIFFS, file.path(), contentType));
+    return size;
+}
+
+void AsyncWebAdapter::sendChunked(int code, const char *contentType, std::function<size_t(uint8_t *buffer, size_t maxLength)> filler)
+{
+    AsyncWebServerResponse *response = current->beginChunkedResponse(contentType, [filler](uint8_t *buffer, size_t maxLength, size_t index) -> size_t
+                                                                     { return filler(buffer, maxLength); });
+    response->setCode(code);
+    respond(response);
+}
+
+void AsyncWebAdapter::onDisconnect(std::function<void(void)> callback)
+{
+    current->onDisconnect(callback);
+}
+
+#endif
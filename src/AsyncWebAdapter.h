@@ -0,0 +1,115 @@
+#pragma once
+
+#ifdef SMOKER_ASYNC_WEB
+
+#include <Arduino.h>
+#include <FS.h>
+#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include "SpscQueue.h"
+
+// Event-driven HTTP server for WebInterface, selected with -DSMOKER_ASYNC_WEB
+// (the RelayBoardAsync environment in platformio.ini).
+//
+// Presents ESPAsyncWebServer through the part of the synchronous WebServer
+// API that WebInterface's handlers use, so the same handler set registered in
+// WebInterface::begin() runs on either server. Connections are accepted and
+// read by the AsyncTCP task. Once a request (and its POST body) is complete
+// it is paused and queued, and handleClient(), called from the comms task,
+// runs its handler there: handlers take the shared-state and logger locks and
+// write SPIFFS as they do with the synchronous server, without holding up the
+// AsyncTCP task or its watchdog. The response is then drained by AsyncTCP;
+// chunk fillers and streamed files only read. Requests are dispatched one at a time, so the adapter
+// tracks a single current request.
+//
+// Differences from the synchronous server:
+// - Files are re-opened by path and streamed by the response; the handler's
+//   File can be closed as soon as streamFile() returns.
+// - Responses of unknown length go through sendChunked(); there is no
+//   setContentLength()/sendContent().
+// - POST bodies are kept for arg("plain") up to MAX_BODY_SIZE bytes. Routes
+//   registered with onUpload() write the body to a SPIFFS file as it arrives
+//   instead, so a file of any size is never held in RAM.
+class AsyncWebAdapter
+{
+public:
+    typedef std::function<void(void)> Handler;
+
+    static const size_t MAX_BODY_SIZE = 16384;
+
+    explicit AsyncWebAdapter(uint16_t port);
+
+    void on(const char *uri, HTTPMethod method, Handler handler);
+    void onNotFound(Handler handler);
+    // POST whose body is written to the SPIFFS file named by its path argument
+    // as it arrives; the handler runs once it is complete, see uploadedBytes()
+    void onUpload(const char *uri, Handler handler);
+    void collectHeaders(const char *headerKeys[], size_t count) {} // async requests keep every header
+    void begin();
+    void handleClient(); // runs the handlers of the requests queued by the AsyncTCP task
+    void stop();
+
+    bool hasArg(const String &name) const;
+    String arg(const String &name) const;
+    bool hasHeader(const String &name) const;
+    String header(const String &name) const;
+
+    void sendHeader(const String &name, const String &value);
+    void send(int code, const char *contentType = "", const String &content = String());
+    void send_P(int code, const char *contentType, const char *content, size_t length);
+    size_t streamFile(File &file, const String &contentType);
+
+    // Bytes of the current onUpload() request written to its file, -1 if it could not be written whole
+    long uploadedBytes() const;
+
+    // Chunked response pulled from filler by the AsyncTCP task until it returns 0.
+    // Anything filler uses must outlive the handler, e.g. by being captured in a shared_ptr.
+    void sendChunked(int code, const char *contentType, std::function<size_t(uint8_t *buffer, size_t maxLength)> filler);
+
+    // Run once the current request's connection closes, i.e. after its response was sent
+    void onDisconnect(std::function<void(void)> callback);
+
+    // Server-Sent Events endpoint (/api/events)
+    AsyncEventSource &events() { return eventSource; }
+
+private:
+    static const int MAX_PENDING_HEADERS = 4;
+    static const size_t QUEUE_SLOTS = 9; // requests waiting for the comms task, plus one
+
+    // A complete request waiting for handleClient(); gone if the client disconnected meanwhile
+    struct PendingRequest
+    {
+        AsyncWebServerRequestPtr request;
+        const Handler *handler;
+        bool upload;
+    };
+
+    // Outcome of an onUpload() body, in the request's scratch pointer
+    struct UploadResult
+    {
+        size_t written;
+        bool failed;
+    };
+
+    AsyncWebServer server;
+    AsyncEventSource eventSource;
+    SpscQueue<PendingRequest, QUEUE_SLOTS> queue;
+    AsyncWebServerRequest *current = nullptr;
+    bool currentUpload = false;
+    String pendingHeaders[MAX_PENDING_HEADERS][2];
+    int pendingHeaderCount = 0;
+
+    // File being uploaded; one upload at a time, written on the AsyncTCP task
+    File uploadFile;
+    AsyncWebServerRequest *uploadRequest = nullptr;
+
+    void enqueue(AsyncWebServerRequest *request, const Handler &handler, bool upload);
+    void dispatch(AsyncWebServerRequest *request, const Handler &handler, bool upload);
+    void writeUpload(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total);
+    void closeUpload(AsyncWebServerRequest *request);
+    void addPendingHeaders(AsyncWebServerResponse *response);
+    void respond(AsyncWebServerResponse *response);
+};
+
+#endif
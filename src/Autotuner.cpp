@@ -0,0 +1,230 @@
+#include "Autotuner.h"
+#include <math.h>
+#include <string.h>
+
+static const float AUTOTUNE_PI = 3.14159265f;
+
+Autotuner::Autotuner()
+    : settings{},
+      status(Status::Idle),
+      failureReason(""),
+      relayHigh(true),
+      haveCycleStart(false),
+      skippedFirstCycle(false),
+      lastElapsedMs(0),
+      cycleStartMs(0),
+      phaseMax(0.0f),
+      phaseMin(0.0f),
+      lastMax(0.0f),
+      cycleCount(0),
+      dutyTimeSum(0.0),
+      timeSum(0.0),
+      result{}
+{
+    memset(transferFunc, 0, sizeof(transferFunc));
+}
+
+void Autotuner::start(const AutotuneSettings &newSettings, const float newTransferFunc[11][2])
+{
+    settings = newSettings;
+    if (settings.cycles < 1)
+        settings.cycles = 1;
+    if (settings.cycles > MAX_CYCLES)
+        settings.cycles = MAX_CYCLES;
+    memcpy(transferFunc, newTransferFunc, sizeof(transferFunc));
+
+    status = Status::Running;
+    failureReason = "";
+    relayHigh = true;
+    haveCycleStart = false;
+    skippedFirstCycle = false;
+    lastElapsedMs = 0;
+    cycleStartMs = 0;
+    phaseMax = -1.0e6f;
+    phaseMin = 1.0e6f;
+    lastMax = 0.0f;
+    cycleCount = 0;
+    dutyTimeSum = 0.0;
+    timeSum = 0.0;
+    result = {};
+}
+
+void Autotuner::cancel(const char *reason)
+{
+    if (status == Status::Running)
+        fail(reason);
+}
+
+void Autotuner::fail(const char *reason)
+{
+    status = Status::Failed;
+    failureReason = reason;
+}
+
+float Autotuner::currentDuty() const
+{
+    float duty = settings.bias + (relayHigh ? settings.amplitude : -settings.amplitude);
+    if (duty < 0.0f)
+        duty = 0.0f;
+    if (duty > 100.0f)
+        duty = 100.0f;
+    return duty;
+}
+
+float Autotuner::update(float temperature, unsigned long elapsedMs)
+{
+    if (status != Status::Running)
+        return settings.bias;
+
+    if (elapsedMs >= settings.maxDurationMs)
+    {
+        fail("timed out before the oscillation settled");
+        return settings.bias;
+    }
+
+    // Average the applied duty over the cycles that are being measured
+    if (skippedFirstCycle)
+    {
+        double dt = (double)(elapsedMs - lastElapsedMs);
+        dutyTimeSum += currentDuty() * dt;
+        timeSum += dt;
+    }
+    lastElapsedMs = elapsedMs;
+
+    if (temperature > phaseMax)
+        phaseMax = temperature;
+    if (temperature < phaseMin)
+        phaseMin = temperature;
+
+    if (relayHigh && temperature > settings.target + settings.hysteresis)
+    {
+        // High -> low closes a full cycle: one low phase (peak) and one high phase (trough)
+        if (haveCycleStart)
+        {
+            if (!skippedFirstCycle)
+            {
+                // The first cycle still carries the approach transient
+                skippedFirstCycle = true;
+            }
+            else
+            {
+                periods[cycleCount] = (elapsedMs - cycleStartMs) / 1000.0f;
+                maxima[cycleCount] = lastMax;
+                minima[cycleCount] = phaseMin;
+                cycleCount++;
+            }
+        }
+        haveCycleStart = true;
+        cycleStartMs = elapsedMs;
+        relayHigh = false;
+        phaseMax = temperature;
+    }
+    else if (!relayHigh && temperature < settings.target - settings.hysteresis)
+    {
+        lastMax = phaseMax;
+        relayHigh = true;
+        phaseMin = temperature;
+    }
+
+    if (cycleCount >= settings.cycles)
+    {
+        identify();
+    }
+
+    return currentDuty();
+}
+
+void Autotuner::identify()
+{
+    float periodSum = 0.0f, maxSum = 0.0f, minSum = 0.0f;
+    for (int i = 0; i < cycleCount; ++i)
+    {
+        periodSum += periods[i];
+        maxSum += maxima[i];
+        minSum += minima[i];
+    }
+
+    float tu = periodSum / cycleCount;
+    float a = (maxSum - minSum) / (2.0f * cycleCount);
+    float h = settings.hysteresis;
+    if (a <= h || tu <= 0.0f)
+    {
+        fail("oscillation smaller than the hysteresis band");
+        return;
+    }
+
+    // Describing function of a relay with hysteresis
+    float ku = (4.0f * settings.amplitude) / (AUTOTUNE_PI * sqrtf(a * a - h * h));
+    float wu = 2.0f * AUTOTUNE_PI / tu;
+
+    result.ultimateGain = ku;
+    result.ultimatePeriodS = tu;
+    result.amplitudeF = a;
+    result.meanDuty = (timeSum > 0.0) ? (float)(dutyTimeSum / timeSum) : settings.bias;
+
+    // Static gain from the local slope of the transfer function (temperature per duty %)
+    float k = 0.0f;
+    for (int i = 0; i < 10; ++i)
+    {
+        if (settings.target >= transferFunc[i][1] && settings.target <= transferFunc[i + 1][1])
+        {
+            float dDuty = transferFunc[i + 1][0] - transferFunc[i][0];
+            if (dDuty > 0.0f)
+                k = (transferFunc[i + 1][1] - transferFunc[i][1]) / dDuty;
+            break;
+        }
+    }
+
+    // FOPDT at the ultimate frequency: K/sqrt(1+(wT)^2) = 1/Ku and wL + atan(wT) = pi
+    result.processGain = k;
+    if (k * ku > 1.0f)
+    {
+        result.timeConstantS = sqrtf((k * ku) * (k * ku) - 1.0f) / wu;
+        result.deadTimeS = (AUTOTUNE_PI - atanf(wu * result.timeConstantS)) / wu;
+    }
+    else
+    {
+        // Slope unknown or inconsistent: pure dead time model
+        result.timeConstantS = 0.0f;
+        result.deadTimeS = tu / 2.0f;
+    }
+
+    // Tyreus-Luyben: less aggressive than Ziegler-Nichols, suits a slow smoker
+    float ti = 2.2f * tu;
+    float td = tu / 6.3f;
+    result.kp = ku / 2.2f;
+    result.ki = result.kp / ti;
+    result.kd = result.kp * td;
+
+    // Shift the duty column so the table reproduces the duty that actually held the target
+    float shift = result.meanDuty - settings.bias;
+    for (int i = 0; i < 11; ++i)
+    {
+        float duty = transferFunc[i][0] + shift;
+        if (duty < 0.0f)
+            duty = 0.0f;
+        if (duty > 100.0f)
+            duty = 100.0f;
+        result.augerTransferFunc[i][0] = duty;
+        result.augerTransferFunc[i][1] = transferFunc[i][1];
+    }
+
+    status = Status::Complete;
+}
+
+const char *Autotuner::GetStatusName(Status status)
+{
+    switch (status)
+    {
+    case Status::Idle:
+        return "Idle";
+    case Status::Running:
+        return "Running";
+    case Status::Complete:
+        return "Complete";
+    case Status::Failed:
+        return "Failed";
+    default:
+        return "Unknown";
+    }
+}
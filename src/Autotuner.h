@@ -0,0 +1,94 @@
+#pragma once
+
+// Relay-feedback (Astrom-Hagglund) autotuner for the auger temperature loop.
+// The auger duty is switched between bias +/- amplitude around a target
+// temperature; the resulting limit cycle gives the ultimate gain and period,
+// from which a first-order-plus-dead-time model, PID gains and a corrected
+// auger transfer function are derived. No Arduino dependencies so the
+// identification can be run against a simulated plant.
+
+struct AutotuneSettings
+{
+    float target;             // Chamber temperature to oscillate around (F)
+    float bias;               // Duty the relay is centered on, normally the feedforward (%)
+    float amplitude;          // Relay step either side of bias (duty %)
+    float hysteresis;         // Switching band either side of target (F)
+    int cycles;               // Full oscillations to average after the first one
+    unsigned long maxDurationMs; // Give up if the cycles are not complete by then
+};
+
+struct AutotuneResult
+{
+    float ultimateGain;    // Ku (duty % per F)
+    float ultimatePeriodS; // Tu
+    float amplitudeF;      // Half peak-to-peak chamber oscillation
+    float meanDuty;        // Time averaged duty that held the target
+    float processGain;     // FOPDT K (F per duty %), from the transfer function slope
+    float timeConstantS;   // FOPDT T
+    float deadTimeS;       // FOPDT L
+    float kp;              // Suggested PID gains (Tyreus-Luyben)
+    float ki;
+    float kd;
+    float augerTransferFunc[11][2]; // Suggested table, duties shifted to meanDuty at the target
+};
+
+class Autotuner
+{
+public:
+    enum class Status
+    {
+        Idle = 0,
+        Running = 1,
+        Complete = 2,
+        Failed = 3
+    };
+
+    static const int MAX_CYCLES = 8;
+
+    Autotuner();
+
+    // Begin an experiment; transferFunc is the current auger table used for the model gain
+    void start(const AutotuneSettings &settings, const float transferFunc[11][2]);
+
+    // Feed one chamber temperature sample; returns the auger duty to apply
+    float update(float temperature, unsigned long elapsedMs);
+
+    void cancel(const char *reason = "cancelled");
+
+    Status getStatus() const { return status; }
+    static const char *GetStatusName(Status status);
+    int getCompletedCycles() const { return cycleCount; }
+    const char *getFailureReason() const { return failureReason; }
+    const AutotuneResult &getResult() const { return result; }
+    const AutotuneSettings &getSettings() const { return settings; }
+
+private:
+    AutotuneSettings settings;
+    Status status;
+    const char *failureReason;
+    float transferFunc[11][2];
+
+    bool relayHigh;
+    bool haveCycleStart;
+    bool skippedFirstCycle;
+    unsigned long lastElapsedMs;
+    unsigned long cycleStartMs;
+    float phaseMax;
+    float phaseMin;
+    float lastMax;
+
+    int cycleCount;
+    float periods[MAX_CYCLES];
+    float maxima[MAX_CYCLES];
+    float minima[MAX_CYCLES];
+    double dutyTimeSum;
+    double timeSum;
+
+    AutotuneResult result;
+
+    float currentDuty() const;
+    void fail(const char *reason);
+    void identify();
+};
+
+extern Autotuner autotuner;
@@ -1,19 +1,87 @@
 #include "DataLogger.h"
+#include "TraceBuffer.h"
+#include "LogFormat.h"
+#include "LogIndex.h"
 
 // Static member initialization
 LogConfig DataLogger::config = DEFAULT_LOG_CONFIG;
 unsigned long DataLogger::lastLogTime = 0;
 int DataLogger::currentLogFileIndex = 0;
 unsigned long DataLogger::currentLogFileSize = 0;
+char DataLogger::staging[DataLogger::STAGING_SIZE];
+size_t DataLogger::stagingHead = 0;
+size_t DataLogger::stagedBytes = 0;
+int DataLogger::stagedRecords = 0;
+unsigned long DataLogger::oldestStagedMs = 0;
+int DataLogger::lastState = -1;
+int DataLogger::lastQueuedState = -1;
+SpscQueue<DataLogger::LogQueueEntry, DataLogger::QUEUE_SIZE> DataLogger::queue;
+unsigned long DataLogger::lastRecordMs = 0;
+unsigned long DataLogger::clockOffsetMs = 0;
+bool DataLogger::needSync = false;
+int DataLogger::samplesSinceSync = 0;
+unsigned long DataLogger::fileStartMs[DataLogger::MAX_LOG_FILES];
+bool DataLogger::fileValid[DataLogger::MAX_LOG_FILES];
+const unsigned long DataLogger::TIER_BUCKET_MS[DataLogger::TIER_COUNT] = {60000, 600000};
+LogRollup DataLogger::tierBuckets[DataLogger::TIER_COUNT];
+LogRollupRecord DataLogger::tierPending[DataLogger::TIER_COUNT][DataLogger::TIER_PENDING];
+int DataLogger::tierPendingCount[DataLogger::TIER_COUNT];
+LogSettingsRecord DataLogger::lastSettings;
+bool DataLogger::needSettings = true;
+SemaphoreHandle_t DataLogger::mutex = nullptr;
+SemaphoreHandle_t DataLogger::flushDone = nullptr;
+std::atomic<bool> DataLogger::flushRequested(false);
+std::atomic<bool> DataLogger::closeRequested(false);
+std::atomic<bool> DataLogger::clearRequested(false);
+TaskHandle_t DataLogger::writer = nullptr;
+
+// Serializes staging and flushing; web handlers may flush from another task than the logger
+class LoggerLock
+{
+public:
+    explicit LoggerLock(SemaphoreHandle_t mutex) : mutex(mutex)
+    {
+        if (mutex)
+            xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~LoggerLock()
+    {
+        if (mutex)
+            xSemaphoreGive(mutex);
+    }
+
+private:
+    SemaphoreHandle_t mutex;
+};
 
 void DataLogger::init(const LogConfig &newConfig)
 {
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+        flushDone = xSemaphoreCreateBinary();
+    }
     config = newConfig;
+    config.maxLogFiles = constrain(config.maxLogFiles, 1, MAX_LOG_FILES);
     lastLogTime = millis();
-    currentLogFileIndex = 0;
     currentLogFileSize = 0;
+    stagingHead = 0;
+    stagedBytes = 0;
+    stagedRecords = 0;
+    clockOffsetMs = 0;
+    lastRecordMs = now();
+    needSync = false;
+    resetTiers();
 
-    if (!config.enabled)
+    // Readers need the surviving files and the log clock even while logging is
+    // off, so the newest file is resumed whether or not it will be written to
+    currentLogFileIndex = scanLogFiles();
+    if (fileValid[currentLogFileIndex] && !resumeLogFile())
+    {
+        fileValid[currentLogFileIndex] = false;
+    }
+
+    if (!config.enabled || fileValid[currentLogFileIndex])
         return;
 
     // Create initial log file
@@ -23,6 +91,31 @@ void DataLogger::init(const LogConfig &newConfig)
     }
 }
 
+// Note the start time of every log file in the ring; returns the slot of the newest
+int DataLogger::scanLogFiles()
+{
+    int newest = 0;
+    for (int i = 0; i < MAX_LOG_FILES; i++)
+    {
+        fileValid[i] = false;
+        String filepath = getLogFilePath(i);
+        if (!SPIFFS.exists(filepath))
+            continue;
+        File file = SPIFFS.open(filepath, "r");
+        LogFileHeader header;
+        if (file && file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            LogFormat::checkHeader(header) && header.bucketMs == 0)
+        {
+            fileValid[i] = true;
+            fileStartMs[i] = header.baseTimestampMs;
+            if (!fileValid[newest] || fileStartMs[i] > fileStartMs[newest])
+                newest = i;
+        }
+        file.close();
+    }
+    return newest;
+}
+
 bool DataLogger::createNewLogFile()
 {
     // Ensure logs directory exists
@@ -36,35 +129,48 @@ bool DataLogger::createNewLogFile()
 
     String filepath = getLogFilePath(currentLogFileIndex);
 
-    // Check if file already exists and get its size
-    if (SPIFFS.exists(filepath))
+    // A new file in this slot; the index and tiers left by the file it replaces no longer apply
+    removeLogFile(currentLogFileIndex);
+
+    currentLogFileSize = 0;
+    File file = SPIFFS.open(filepath, "w");
+    if (!file)
     {
-        File file = SPIFFS.open(filepath, "r");
-        if (file)
-        {
-            currentLogFileSize = file.size();
-            file.close();
-        }
+        Serial.println("Failed to create log file: " + filepath);
+        return false;
     }
-    else
+    file.close();
+    writeLogHeader();
+
+    return fileValid[currentLogFileIndex];
+}
+
+// Keep appending to the newest log; millis() restarted, so resync the timeline
+bool DataLogger::resumeLogFile()
+{
+    String filepath = getLogFilePath(currentLogFileIndex);
+    uint32_t lastTimestampMs;
+    if (!LogIndex::update(filepath, lastTimestampMs))
+        return false;
+
+    File file = SPIFFS.open(filepath, "r");
+    currentLogFileSize = file ? file.size() : 0;
+    file.close();
+    rebuildTiers();
+    // Continue the log clock from the end of the file, so time never runs backwards in it
+    if ((long)(lastTimestampMs - now()) >= 0)
     {
-        currentLogFileSize = 0;
-        File file = SPIFFS.open(filepath, "w");
-        if (!file)
-        {
-            Serial.println("Failed to create log file: " + filepath);
-            return false;
-        }
-        writeLogHeader();
-        file.close();
+        clockOffsetMs += lastTimestampMs - now() + 1;
     }
-
+    lastRecordMs = now();
+    needSync = true;
+    needSettings = true;
     return true;
 }
 
 String DataLogger::getLogFilePath(int index)
 {
-    return "/logs/data_" + String(index) + ".csv";
+    return "/logs/data_" + String(index) + ".bin";
 }
 
 void DataLogger::rotateLogFile()
@@ -75,13 +181,8 @@ void DataLogger::rotateLogFile()
         currentLogFileIndex = 0;
     }
 
-    String filepath = getLogFilePath(currentLogFileIndex);
-
-    // Delete old file if it exists
-    if (SPIFFS.exists(filepath))
-    {
-        SPIFFS.remove(filepath);
-    }
+    // Delete old file, its index and tiers if they exist
+    removeLogFile(currentLogFileIndex);
 
     // Create new log file
     currentLogFileSize = 0;
@@ -95,14 +196,22 @@ void DataLogger::writeLogHeader()
     if (!file)
     {
         Serial.println("Failed to open log file for header: " + filepath);
+        needSync = true;
         return;
     }
 
-    String header = "Timestamp,SmokeChamberTemp,FirePotTemp,Setpoint,SmokeSetpoint,ActiveState,"
-                    "IgniterMode,AugerMode,AugerDutyCycle,AugerFrequency,"
-                    "FanMode,FanDutyCycle,FanFrequency\n";
-
-    file.print(header);
+    // Records in the new file continue from the last one written to the previous file,
+    // or from the oldest staged one when the file is started again under them
+    LogFileHeader header = LogFormat::makeHeader(stagedBytes > 0 ? oldestStagedMs : lastRecordMs);
+    fileStartMs[currentLogFileIndex] = header.baseTimestampMs;
+    fileValid[currentLogFileIndex] = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    if (!fileValid[currentLogFileIndex])
+    {
+        // writeStaged() starts the file again when there is room; its first record is absolute
+        Serial.println("Short write to log file header: " + filepath);
+        needSync = true;
+    }
+    needSettings = true;
     currentLogFileSize = file.size();
     file.close();
 }
@@ -112,7 +221,7 @@ void DataLogger::logData(
     float firePotTemp,
     float setpoint,
     float smokesetpoint,
-    const char *activeState,
+    int activeState,
     int igniterMode,
     int augerMode,
     float augerDutyCycle,
@@ -121,43 +230,505 @@ void DataLogger::logData(
     float fanDutyCycle,
     float fanFrequency)
 {
-    if (!config.enabled || !shouldLog())
+    if (!config.enabled)
+        return;
+
+    // Only decides whether the sample is due; encoding and flash I/O happen in writerTask()
+    bool due = shouldLog();
+    if (!due && activeState == lastQueuedState)
+        return;
+
+    LogQueueEntry entry = {{now(), smokeChamberTemp, firePotTemp, setpoint, smokesetpoint, activeState,
+                            igniterMode, augerMode, augerDutyCycle, augerFrequency,
+                            fanMode, fanDutyCycle, fanFrequency},
+                           due};
+    if (due)
+        lastLogTime = millis();
+    if (queue.push(entry))
+        lastQueuedState = activeState;
+}
+
+void DataLogger::writerTask()
+{
+    writer = xTaskGetCurrentTaskHandle();
+    LogQueueEntry entry;
+    while (queue.pop(entry))
+    {
+        LoggerLock lock(mutex);
+        if (config.enabled)
+            process(entry);
+    }
+
+    LoggerLock lock(mutex);
+    if (clearRequested.exchange(false))
+    {
+        clearFiles();
+        xSemaphoreGive(flushDone);
+    }
+    // After the queue is drained, so a flush also covers the samples logged before it was asked for
+    if (flushRequested.exchange(false))
+    {
+        if (closeRequested.exchange(false))
+            closeTiers();
+        writeAll();
+        xSemaphoreGive(flushDone);
+    }
+    else if (stagedBytes > 0 && now() - oldestStagedMs >= config.flushIntervalMs)
+    {
+        writeAll();
+    }
+}
+
+void DataLogger::process(const LogQueueEntry &entry)
+{
+    const LogSample &sample = entry.sample;
+    if (entry.record)
+    {
+        unsigned long deltaMs = sample.timestampMs - lastRecordMs;
+        // A sync record and the settings after it start a block LogIndex can seek to
+        if (needSync || deltaMs > LOG_MAX_DELTA_MS || samplesSinceSync >= LogIndex::BLOCK_RECORDS)
+        {
+            LogSyncRecord sync = LogFormat::makeSync(sample.timestampMs);
+            stage(&sync, sample.timestampMs);
+            needSync = false;
+            needSettings = true;
+            samplesSinceSync = 0;
+            deltaMs = 0;
+        }
+        // Setpoints and frequencies only go in when they change, or at the start of a file
+        LogSettingsRecord settings = LogFormat::encodeSettings(sample);
+        if (needSettings || memcmp(&settings, &lastSettings, sizeof(settings)) != 0)
+        {
+            stage(&settings, sample.timestampMs);
+            lastSettings = settings;
+            needSettings = false;
+        }
+        LogRecord record = LogFormat::encode(sample, (uint16_t)deltaMs);
+        stage(&record, sample.timestampMs);
+        samplesSinceSync++;
+        lastRecordMs = sample.timestampMs;
+        rollUp(sample);
+    }
+
+    // State changes (including shutdown) are written out right away, the rest in batches
+    if (sample.state != lastState)
+    {
+        lastState = sample.state;
+        writeAll();
+    }
+    else if (stagedRecords >= config.flushRecords)
+    {
+        writeStaged(false);
+    }
+}
+
+DataLogger::QueueStats DataLogger::getQueueStats()
+{
+    QueueStats stats;
+    stats.depth = queue.size();
+    stats.capacity = queue.capacity();
+    stats.highWater = queue.getHighWater();
+    stats.dropped = queue.getDropped();
+    return stats;
+}
+
+void DataLogger::stage(const void *record, unsigned long sampleMs)
+{
+    const char *line = (const char *)record;
+    size_t length = sizeof(LogRecord);
+    if (length > STAGING_SIZE - stagedBytes)
+    {
+        writeStaged(true);
+        if (length > STAGING_SIZE - stagedBytes)
+        {
+            Serial.println("Log staging full, record dropped");
+            return;
+        }
+    }
+    // The sample's own time, so the age check also counts the time it waited in the queue
+    if (stagedBytes == 0)
+    {
+        oldestStagedMs = sampleMs;
+    }
+
+    size_t tail = (stagingHead + stagedBytes) % STAGING_SIZE;
+    size_t first = STAGING_SIZE - tail;
+    if (first > length)
+        first = length;
+    memcpy(staging + tail, line, first);
+    memcpy(staging, line + first, length - first);
+    stagedBytes += length;
+    stagedRecords++;
+}
+
+void DataLogger::writeStaged(bool all)
+{
+    size_t count = stagedBytes;
+    if (!all)
+    {
+        // Fill the file up to the last SPIFFS data page boundary the staged bytes reach,
+        // the remainder waits for the next batch
+        size_t overhang = (currentLogFileSize + stagedBytes) % SPIFFS_PAGE_DATA_SIZE;
+        if (overhang >= count)
+            return;
+        count -= overhang;
+        // ...rounded down to whole records, so a power cut never leaves half a record in the
+        // file; the page is left up to one record short and topped up in place by the next batch
+        count -= count % sizeof(LogRecord);
+        if (count == 0)
+            return;
+    }
+    if (count == 0)
+        return;
+
+    // A full partition cost the file its header; start it again, or keep the
+    // records staged until there is room
+    if (!fileValid[currentLogFileIndex] && !createNewLogFile())
         return;
 
     String filepath = getLogFilePath(currentLogFileIndex);
+    TraceBuffer::begin("log open");
     File file = SPIFFS.open(filepath, "a");
+    TraceBuffer::end("log open");
     if (!file)
     {
         Serial.println("Failed to open log file: " + filepath);
         return;
     }
 
-    // Format: timestamp,value1,value2,...
-    String line = String(millis()) + ",";
-    line += String(smokeChamberTemp, 2) + ",";
-    line += String(firePotTemp, 2) + ",";
-    line += String(setpoint, 2) + ",";
-    line += String(smokesetpoint, 2) + ",";
-    line += String(activeState) + ",";
-    line += String(igniterMode) + ",";
-    line += String(augerMode) + ",";
-    line += String(augerDutyCycle, 2) + ",";
-    line += String(augerFrequency, 2) + ",";
-    line += String(fanMode) + ",";
-    line += String(fanDutyCycle, 2) + ",";
-    line += String(fanFrequency, 2) + "\n";
-
-    file.print(line);
-    currentLogFileSize = file.size();
+    TraceBuffer::begin("log write");
+    size_t first = STAGING_SIZE - stagingHead;
+    if (first > count)
+        first = count;
+    size_t written = file.write((const uint8_t *)staging + stagingHead, first);
+    if (written == first && count > first)
+        written += file.write((const uint8_t *)staging, count - first);
+    TraceBuffer::end("log write");
+    TraceBuffer::begin("log close");
     file.close();
+    TraceBuffer::end("log close");
+
+    indexWritten(written);
+    currentLogFileSize += written;
+    if (written != count)
+    {
+        // The file may now end in part of a record, and anything appended after it would be
+        // read out of step. Readers skip a partial record at the end of a file, so leave this
+        // one as it is and continue in the next; rotating also frees the oldest file's space.
+        // The staged records are dropped rather than retried against a full partition: their
+        // deltas lead on from the ones that were lost, so the next file starts with a sync.
+        Serial.println("Short write to log file: " + filepath);
+        stagingHead = 0;
+        stagedBytes = 0;
+        stagedRecords = 0;
+        needSync = true;
+        closeTiers();
+        writeTiers();
+        rotateLogFile();
+        return;
+    }
+
+    stagingHead = (stagingHead + count) % STAGING_SIZE;
+    stagedBytes -= count;
+
+    // Only whole records are written, so the ring still starts on one
+    stagedRecords = stagedBytes / sizeof(LogRecord);
+    if (stagedBytes > 0)
+        oldestStagedMs = findOldestStagedMs();
 
     // Check if we need to rotate to next file
     if (currentLogFileSize >= config.maxLogFileSizeBytes)
     {
+        if (stagedBytes > 0)
+        {
+            writeStaged(true);
+            return;
+        }
+        // Buckets belong with the file they summarize; close the open ones early
+        // so none spans two files
+        closeTiers();
+        writeTiers();
         rotateLogFile();
     }
+}
 
-    lastLogTime = millis();
+unsigned long DataLogger::findOldestStagedMs()
+{
+    // Each sample's delta is from the one before it (a sync record starts at a delta of 0),
+    // so the deltas of all staged samples but the oldest lead back to it from lastRecordMs
+    unsigned long oldestMs = lastRecordMs;
+    bool first = true;
+    for (size_t pos = 0; pos < stagedBytes; pos += sizeof(LogRecord))
+    {
+        LogRecord record;
+        size_t start = (stagingHead + pos) % STAGING_SIZE;
+        size_t part = STAGING_SIZE - start;
+        if (part > sizeof(record))
+            part = sizeof(record);
+        memcpy(&record, staging + start, part);
+        memcpy((char *)&record + part, staging, sizeof(record) - part);
+        uint16_t marker = LogFormat::marker(record);
+        if (marker == LOG_SYNC_MARKER || marker == LOG_SETTINGS_MARKER)
+            continue;
+        if (!first)
+            oldestMs -= record.deltaMs;
+        first = false;
+    }
+    return oldestMs;
+}
+
+void DataLogger::indexWritten(size_t count)
+{
+    LogIndexEntry entries[8];
+    size_t entryCount = 0;
+    String filepath = getLogFilePath(currentLogFileIndex);
+    for (size_t pos = 0; pos + sizeof(LogRecord) <= count; pos += sizeof(LogRecord))
+    {
+        LogSyncRecord sync;
+        size_t start = (stagingHead + pos) % STAGING_SIZE;
+        size_t first = STAGING_SIZE - start;
+        if (first > sizeof(sync))
+            first = sizeof(sync);
+        memcpy(&sync, staging + start, first);
+        memcpy((char *)&sync + first, staging, sizeof(sync) - first);
+        if (sync.marker != LOG_SYNC_MARKER)
+            continue;
+
+        entries[entryCount].timestampMs = sync.timestampMs;
+        entries[entryCount].offset = currentLogFileSize + pos;
+        if (++entryCount == sizeof(entries) / sizeof(entries[0]))
+        {
+            LogIndex::append(filepath, entries, entryCount);
+            entryCount = 0;
+        }
+    }
+    if (entryCount > 0)
+        LogIndex::append(filepath, entries, entryCount);
+}
+
+void DataLogger::flush(bool closeBuckets)
+{
+    if (writer == nullptr || writer == xTaskGetCurrentTaskHandle())
+    {
+        LoggerLock lock(mutex);
+        if (closeBuckets)
+            closeTiers();
+        writeAll();
+        return;
+    }
+
+    if (closeBuckets)
+        closeRequested = true;
+    if (!askWriter(flushRequested))
+    {
+        Serial.println("Log flush timed out, staged records not written yet");
+    }
+}
+
+bool DataLogger::askWriter(std::atomic<bool> &request)
+{
+    // Flash I/O stays on the writer task: wake it and wait for it to do the work
+    xSemaphoreTake(flushDone, 0); // the late answer to an earlier request that timed out
+    request = true;
+    xTaskNotifyGive(writer);
+    return xSemaphoreTake(flushDone, pdMS_TO_TICKS(FLUSH_WAIT_MS)) == pdTRUE;
+}
+
+void DataLogger::writeAll()
+{
+    writeStaged(true);
+    writeTiers();
+}
+
+void DataLogger::rollUp(const LogSample &sample)
+{
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        rollUp(sample, tier);
+    }
+}
+
+void DataLogger::rollUp(const LogSample &sample, int tier)
+{
+    LogRollup &bucket = tierBuckets[tier];
+    unsigned long startMs = sample.timestampMs - sample.timestampMs % TIER_BUCKET_MS[tier];
+    if (bucket.count > 0 && bucket.startMs != startMs)
+        closeTier(tier);
+    if (bucket.count == 0)
+        bucket.reset(startMs);
+    bucket.add(sample);
+}
+
+void DataLogger::rebuildTiers()
+{
+    String filepath = getLogFilePath(currentLogFileIndex);
+    uint32_t coveredMs[TIER_COUNT];
+    uint32_t fromMs = UINT32_MAX;
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        coveredMs[tier] = getTierEndMs(filepath, tier);
+        if (coveredMs[tier] < fromMs)
+            fromMs = coveredMs[tier];
+    }
+
+    File file = SPIFFS.open(filepath, "r");
+    LogFileHeader header;
+    if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || !LogFormat::checkHeader(header))
+    {
+        file.close();
+        return;
+    }
+    // Decoding starts at a sync record and its settings, or at the start of the file
+    uint32_t offset = LogIndex::find(filepath, fromMs);
+    if (offset > sizeof(header))
+        file.seek(offset);
+
+    uint32_t timestampMs = header.baseTimestampMs;
+    LogSettingsRecord settings = {};
+    LogRecord records[16];
+    size_t count;
+    while ((count = file.read((uint8_t *)records, sizeof(records)) / sizeof(LogRecord)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint16_t marker = LogFormat::marker(records[i]);
+            if (marker == LOG_SETTINGS_MARKER)
+            {
+                memcpy(&settings, &records[i], sizeof(settings));
+                continue;
+            }
+            if (marker == LOG_SYNC_MARKER)
+            {
+                LogSyncRecord sync;
+                memcpy(&sync, &records[i], sizeof(sync));
+                timestampMs = sync.timestampMs;
+                continue;
+            }
+            timestampMs += records[i].deltaMs;
+            LogSample sample;
+            LogFormat::decode(header, settings, records[i], timestampMs, sample);
+            for (int tier = 0; tier < TIER_COUNT; tier++)
+            {
+                if (timestampMs >= coveredMs[tier])
+                    rollUp(sample, tier);
+            }
+        }
+    }
+    file.close();
+    writeTiers();
+}
+
+uint32_t DataLogger::getTierEndMs(const String &dataPath, int tier)
+{
+    String tierPath = getTierPath(dataPath, tier);
+    if (!SPIFFS.exists(tierPath))
+        return 0;
+    File file = SPIFFS.open(tierPath, "r");
+    LogFileHeader header;
+    uint32_t endMs = 0;
+    if (file && file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+        LogFormat::checkHeader(header) && header.bucketMs == TIER_BUCKET_MS[tier])
+    {
+        size_t records = (file.size() - sizeof(header)) / sizeof(LogRollupRecord);
+        uint32_t startMs;
+        if (records > 0 && file.seek(sizeof(header) + (records - 1) * sizeof(LogRollupRecord)) &&
+            file.read((uint8_t *)&startMs, sizeof(startMs)) == sizeof(startMs))
+            endMs = startMs + TIER_BUCKET_MS[tier];
+    }
+    file.close();
+    return endMs;
+}
+
+void DataLogger::closeTier(int tier)
+{
+    tierPending[tier][tierPendingCount[tier]++] = LogFormat::encodeRollup(tierBuckets[tier]);
+    if (tierPendingCount[tier] == TIER_PENDING)
+        writeTier(tier);
+    tierBuckets[tier].count = 0;
+}
+
+void DataLogger::closeTiers()
+{
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        if (tierBuckets[tier].count > 0)
+            closeTier(tier);
+    }
+}
+
+void DataLogger::writeTiers()
+{
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        writeTier(tier);
+    }
+}
+
+void DataLogger::writeTier(int tier)
+{
+    if (tierPendingCount[tier] == 0)
+        return;
+
+    String filepath = getTierPath(getLogFilePath(currentLogFileIndex), tier);
+    File file = SPIFFS.open(filepath, "a");
+    if (!file)
+    {
+        Serial.println("Failed to open log tier: " + filepath);
+    }
+    else
+    {
+        if (file.size() == 0)
+        {
+            LogFileHeader header = LogFormat::makeHeader(tierPending[tier][0].timestampMs, TIER_BUCKET_MS[tier]);
+            file.write((const uint8_t *)&header, sizeof(header));
+        }
+        file.write((const uint8_t *)tierPending[tier], tierPendingCount[tier] * sizeof(LogRollupRecord));
+        file.close();
+    }
+    // Like the samples, dropped rather than retried forever against a full partition
+    tierPendingCount[tier] = 0;
+}
+
+void DataLogger::resetTiers()
+{
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        tierBuckets[tier].count = 0;
+        tierPendingCount[tier] = 0;
+    }
+}
+
+String DataLogger::getTierPath(const String &dataPath, int tier)
+{
+    return dataPath.substring(0, dataPath.lastIndexOf('.')) + "." + String(TIER_BUCKET_MS[tier] / 60000) + "m";
+}
+
+void DataLogger::removeLogFile(int index)
+{
+    fileValid[index] = false;
+    String filepath = getLogFilePath(index);
+    String paths[TIER_COUNT + 2] = {filepath, LogIndex::getPath(filepath)};
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        paths[tier + 2] = getTierPath(filepath, tier);
+    }
+    for (const String &path : paths)
+    {
+        if (SPIFFS.exists(path))
+        {
+            SPIFFS.remove(path);
+        }
+    }
+}
+
+unsigned long DataLogger::getLossWindowMs()
+{
+    return config.enabled ? config.flushIntervalMs + WRITER_PERIOD_MS : 0;
+}
+
+size_t DataLogger::getStagedBytes()
+{
+    return stagedBytes;
 }
 
 LogConfig DataLogger::getConfig()
@@ -167,22 +738,52 @@ LogConfig DataLogger::getConfig()
 
 void DataLogger::setConfig(const LogConfig &newConfig)
 {
+    // What is staged goes out before the writer task stops taking samples
+    if (config.enabled && !newConfig.enabled)
+    {
+        flush();
+    }
+
+    LoggerLock lock(mutex);
+    bool wasEnabled = config.enabled;
     config = newConfig;
+    config.maxLogFiles = constrain(config.maxLogFiles, 1, MAX_LOG_FILES);
     if (config.enabled)
     {
         lastLogTime = millis();
     }
+    // Logging was off at boot and there was no file to resume: writeStaged()
+    // creates one on the writer task with the first batch, which starts absolute
+    if (config.enabled && !wasEnabled && !fileValid[currentLogFileIndex])
+    {
+        needSync = true;
+    }
 }
 
 void DataLogger::clearAllLogs()
 {
-    for (int i = 0; i < config.maxLogFiles; i++)
+    if (writer == nullptr || writer == xTaskGetCurrentTaskHandle())
     {
-        String filepath = getLogFilePath(i);
-        if (SPIFFS.exists(filepath))
-        {
-            SPIFFS.remove(filepath);
-        }
+        LoggerLock lock(mutex);
+        clearFiles();
+        return;
+    }
+    if (!askWriter(clearRequested))
+    {
+        Serial.println("Log clear timed out, the logger task clears the files when it next runs");
+    }
+}
+
+void DataLogger::clearFiles()
+{
+    stagedBytes = 0;
+    stagedRecords = 0;
+    lastRecordMs = now();
+    needSync = false;
+    resetTiers();
+    for (int i = 0; i < MAX_LOG_FILES; i++)
+    {
+        removeLogFile(i);
     }
     currentLogFileIndex = 0;
     currentLogFileSize = 0;
@@ -216,6 +817,56 @@ String DataLogger::getActiveLogFile()
     return getLogFilePath(currentLogFileIndex);
 }
 
+bool DataLogger::findLogFile(unsigned long timeMs, LogFileSpan &span)
+{
+    LoggerLock lock(mutex);
+    int found = -1;
+    int oldest = -1;
+    for (int i = 0; i < MAX_LOG_FILES; i++)
+    {
+        if (!fileValid[i])
+            continue;
+        if (oldest < 0 || fileStartMs[i] < fileStartMs[oldest])
+            oldest = i;
+        if (fileStartMs[i] <= timeMs && (found < 0 || fileStartMs[i] > fileStartMs[found]))
+            found = i;
+    }
+    if (found < 0)
+        found = oldest;
+    return found >= 0 && makeSpan(found, span);
+}
+
+bool DataLogger::nextLogFile(const LogFileSpan &span, LogFileSpan &next)
+{
+    LoggerLock lock(mutex);
+    int found = -1;
+    for (int i = 0; i < MAX_LOG_FILES; i++)
+    {
+        if (fileValid[i] && fileStartMs[i] > span.startMs && (found < 0 || fileStartMs[i] < fileStartMs[found]))
+            found = i;
+    }
+    return found >= 0 && makeSpan(found, next);
+}
+
+// A file ends where the next one in time starts; the newest runs to now
+bool DataLogger::makeSpan(int index, LogFileSpan &span)
+{
+    span.index = index;
+    span.startMs = fileStartMs[index];
+    span.endMs = now();
+    for (int i = 0; i < MAX_LOG_FILES; i++)
+    {
+        if (fileValid[i] && fileStartMs[i] > span.startMs && fileStartMs[i] < span.endMs)
+            span.endMs = fileStartMs[i];
+    }
+    return true;
+}
+
+unsigned long DataLogger::now()
+{
+    return millis() + clockOffsetMs;
+}
+
 bool DataLogger::shouldLog()
 {
     return (millis() - lastLogTime) >= config.logIntervalMs;
@@ -2,6 +2,12 @@
 
 #include <Arduino.h>
 #include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "LogFormat.h"
+#include "SpscQueue.h"
 
 // Data logging configuration
 struct LogConfig
@@ -10,6 +16,16 @@ struct LogConfig
     unsigned long logIntervalMs;     // How often to log (in milliseconds)
     int maxLogFiles;                  // Maximum number of log files to keep
     unsigned long maxLogFileSizeBytes; // Max size per log file before rolling to next
+    int flushRecords;                 // Write staged records to flash once this many are waiting
+    unsigned long flushIntervalMs;    // ...or once the oldest staged record is this old
+};
+
+// A log file of the rotation ring and the span of time it holds
+struct LogFileSpan
+{
+    int index;
+    unsigned long startMs; // header base timestamp
+    unsigned long endMs;   // start of the next file in time, now() for the active one
 };
 
 // Default configuration
@@ -17,22 +33,45 @@ const LogConfig DEFAULT_LOG_CONFIG = {
     .enabled = false,
     .logIntervalMs = 5000,    // Log every 5 seconds
     .maxLogFiles = 10,        // Keep 10 log files
-    .maxLogFileSizeBytes = 100000 // 100KB per file
+    .maxLogFileSizeBytes = 100000, // 100KB per file
+    .flushRecords = 25,       // One 251-byte SPIFFS data page of records
+    .flushIntervalMs = 60000  // At most one minute of records lost on power cut
 };
 
+// logData() queues samples for writerTask(), which encodes them as binary
+// records (LogFormat.h) and appends them in page-sized batches, with a sparse
+// time index (LogIndex.h) and 1 and 10 minute rolled-up tiers beside each file.
 class DataLogger
 {
 public:
+    static const size_t STAGING_SIZE = 2048; // about 200 staged records
+    static const size_t SPIFFS_PAGE_DATA_SIZE = 251; // file bytes per 256-byte SPIFFS page
+    static const unsigned long WRITER_PERIOD_MS = 100; // writerTask() is called this often
+    static const unsigned long FLUSH_WAIT_MS = 1000;   // longest flush() waits for the writer task
+    static const int MAX_LOG_FILES = 50;
+    static const size_t QUEUE_SIZE = 32; // slots between logData() and the writer task
+    static const int TIER_COUNT = 2;
+    static const unsigned long TIER_BUCKET_MS[TIER_COUNT]; // shortest first
+    static const int TIER_PENDING = 8;   // closed buckets per tier write, one flash page
+
+    struct QueueStats
+    {
+        size_t depth;
+        size_t capacity;
+        size_t highWater;      // deepest the queue has been since boot
+        unsigned long dropped; // samples lost because the queue was full
+    };
+
     // Initialize the logger with configuration
     static void init(const LogConfig &config);
 
-    // Log a line of CSV data with timestamp
+    // Log one sample; activeState is the SmokerStateMachine::State number
     static void logData(
         float smokeChamberTemp,
         float firePotTemp,
         float setpoint,
         float smokesetpoint,
-        const char *activeState,
+        int activeState,
         int igniterMode,
         int augerMode,
         float augerDutyCycle,
@@ -41,13 +80,36 @@ public:
         float fanDutyCycle,
         float fanFrequency);
 
+    // Drain the queue into the staging ring and apply the flush policy (writer task only):
+    // a batch is written at flushRecords, flushIntervalMs, a state change or flush().
+    // The task calling it is the writer; it should wait for its next pass with
+    // ulTaskNotifyTake() so flush() can wake it.
+    static void writerTask();
+
+    static QueueStats getQueueStats();
+
+    // Write every staged record to the log file (before reboot, download, etc.),
+    // with the open tier buckets closed early if closeBuckets (before reboot).
+    // From any task but the writer, this asks the writer task to do it and
+    // returns when it has, or after FLUSH_WAIT_MS if it has not.
+    static void flush(bool closeBuckets = false);
+
+    // Longest span of samples that a power cut can lose, or that readers can
+    // trail by, with the current configuration: the oldest unsaved sample is flushIntervalMs old by the
+    // writer pass that writes it, and passes are WRITER_PERIOD_MS apart
+    static unsigned long getLossWindowMs();
+
+    // Bytes currently staged in RAM
+    static size_t getStagedBytes();
+
     // Get the current log configuration
     static LogConfig getConfig();
 
     // Update the log configuration
     static void setConfig(const LogConfig &config);
 
-    // Delete all log files
+    // Delete all log files; from any task but the writer, done by the writer
+    // task like flush(), waiting up to FLUSH_WAIT_MS for it
     static void clearAllLogs();
 
     // Get list of log files
@@ -56,22 +118,126 @@ public:
     // Get current active log file name
     static String getActiveLogFile();
 
+    // Rolled-up tier file of a log file
+    static String getTierPath(const String &dataPath, int tier);
+
+    // Get the path for a log file by index
+    static String getLogFilePath(int index);
+
+    // The surviving log file holding timeMs, or the oldest if timeMs is before
+    // all of them; false if there are none
+    static bool findLogFile(unsigned long timeMs, LogFileSpan &span);
+
+    // The log file after span in time; false after the active one
+    static bool nextLogFile(const LogFileSpan &span, LogFileSpan &next);
+
+    // Log clock, the time base of record timestamps: millis(), moved forward at
+    // boot past the last record of the file being appended to. Time spent
+    // powered off is not counted, but timestamps never go backwards in a file.
+    static unsigned long now();
+
 private:
     static LogConfig config;
     static unsigned long lastLogTime;
     static int currentLogFileIndex;
     static unsigned long currentLogFileSize;
 
+    static char staging[STAGING_SIZE];
+    static size_t stagingHead;  // next byte to write to flash
+    static size_t stagedBytes;
+    static int stagedRecords;
+    static unsigned long oldestStagedMs; // log time of the oldest staged sample
+    static int lastState;
+    static int lastQueuedState; // producer side, to queue state changes between samples
+    static unsigned long lastRecordMs; // delta base for the next record
+    static unsigned long clockOffsetMs; // now() - millis()
+    static bool needSync;              // next record needs an absolute timestamp first
+    static int samplesSinceSync;       // samples in the current index block
+    static unsigned long fileStartMs[MAX_LOG_FILES];
+    static bool fileValid[MAX_LOG_FILES];
+    static LogSettingsRecord lastSettings;
+    static bool needSettings;          // next sample needs a settings record first
+    static SemaphoreHandle_t mutex;
+    static SemaphoreHandle_t flushDone;     // given by the writer task after a requested flush or clear
+    static std::atomic<bool> flushRequested;
+    static std::atomic<bool> closeRequested; // ...with the open buckets closed
+    static std::atomic<bool> clearRequested;
+    static TaskHandle_t writer;             // task running writerTask(), once it has run
+
+    // Write the staged records and closed buckets out (writer task, lock held)
+    static void writeAll();
+
+    // Delete every file and start a new one (writer task, lock held)
+    static void clearFiles();
+
+    // Set request, wake the writer task and wait up to FLUSH_WAIT_MS for it; false on timeout
+    static bool askWriter(std::atomic<bool> &request);
+
+    struct LogQueueEntry
+    {
+        LogSample sample;
+        bool record; // false: only the state changed, nothing to store
+    };
+    static SpscQueue<LogQueueEntry, QUEUE_SIZE> queue;
+
+    // Encode one queued sample into the staging ring (writer task, lock held)
+    static void process(const LogQueueEntry &entry);
+
+    static LogRollup tierBuckets[TIER_COUNT]; // open bucket of each tier
+    static LogRollupRecord tierPending[TIER_COUNT][TIER_PENDING];
+    static int tierPendingCount[TIER_COUNT];
+
+    // Add a sample to the open bucket of each tier, or of one, closing the bucket it ends
+    static void rollUp(const LogSample &sample);
+    static void rollUp(const LogSample &sample, int tier);
+
+    // Roll up the samples of the active file after the last bucket each tier file holds,
+    // the ones a power cut lost from RAM; the newest buckets are left open
+    static void rebuildTiers();
+
+    // End of the last bucket in a tier file, 0 if it has none
+    static uint32_t getTierEndMs(const String &dataPath, int tier);
+
+    // Move the open bucket of one or all tiers to the pending records
+    static void closeTier(int tier);
+    static void closeTiers();
+
+    // Append the closed buckets of one or all tiers to the active file's tier files
+    static void writeTier(int tier);
+    static void writeTiers();
+    static void resetTiers();
+
+    // Delete a log file with its index and tiers
+    static void removeLogFile(int index);
+
+    // Read the header of every file in the ring; returns the slot of the newest
+    static int scanLogFiles();
+
+    static bool makeSpan(int index, LogFileSpan &span);
+
+    // Append one record (any of the LogFormat record kinds) of the sample logged at sampleMs to the ring
+    static void stage(const void *record, unsigned long sampleMs);
+
+    // Write staged bytes to the active file; all of them, or only up to a page boundary
+    static void writeStaged(bool all);
+
+    // Log time of the oldest staged sample, worked back from the newest through the record deltas
+    static unsigned long findOldestStagedMs();
+
+    // Index the sync records in the first count staged bytes once they are in the file
+    static void indexWritten(size_t count);
+
     // Create a new log file and write header
     static bool createNewLogFile();
 
-    // Get the path for a log file by index
-    static String getLogFilePath(int index);
+    // Continue the newest log file after a reboot: index, tiers, log clock and a
+    // sync record before the next sample. False if the file cannot be read.
+    static bool resumeLogFile();
 
     // Rotate to the next log file (delete oldest if needed)
     static void rotateLogFile();
 
-    // Write CSV header to the current log file
+    // Write the binary file header to the current log file
     static void writeLogHeader();
 
     // Check if it's time to log data
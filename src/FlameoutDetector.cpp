@@ -0,0 +1,88 @@
+#include "FlameoutDetector.h"
+
+FlameoutDetector::FlameoutDetector()
+{
+    reset();
+}
+
+void FlameoutDetector::reset()
+{
+    head = 0;
+    count = 0;
+    score = 0.0f;
+    confidence = 0.0f;
+    slope = 0.0f;
+    fedGrams = 0.0f;
+    settledFeedRate = -1.0f;
+}
+
+bool FlameoutDetector::update(float firePotTemp, float deliveredGrams, float dtS, const FlameoutSettings &settings)
+{
+    temps[head] = firePotTemp;
+    grams[head] = deliveredGrams;
+    head = (head + 1) % WINDOW_SAMPLES;
+    if (count < WINDOW_SAMPLES)
+        count++;
+
+    // Need a full window before the slope means anything
+    if (count < WINDOW_SAMPLES || dtS <= 0.0f)
+        return false;
+
+    // Least-squares slope over the window, samples are evenly spaced by dtS
+    int oldest = head; // the window is full, so head is the oldest sample
+    float meanX = (WINDOW_SAMPLES - 1) / 2.0f;
+    float meanY = 0.0f;
+    for (int i = 0; i < WINDOW_SAMPLES; ++i)
+        meanY += temps[(oldest + i) % WINDOW_SAMPLES];
+    meanY /= WINDOW_SAMPLES;
+
+    float sxy = 0.0f, sxx = 0.0f;
+    for (int i = 0; i < WINDOW_SAMPLES; ++i)
+    {
+        float dx = i - meanX;
+        sxy += dx * (temps[(oldest + i) % WINDOW_SAMPLES] - meanY);
+        sxx += dx * dx;
+    }
+    slope = (sxy / sxx) / dtS;
+
+    int newest = (head + WINDOW_SAMPLES - 1) % WINDOW_SAMPLES;
+    fedGrams = grams[newest] - grams[oldest];
+
+    // Feed rate the fire has settled to; a window well below it means the feed was just cut
+    float feedRate = fedGrams / (WINDOW_SAMPLES * dtS);
+    if (settledFeedRate < 0.0f)
+        settledFeedRate = feedRate;
+    settledFeedRate += (feedRate - settledFeedRate) * dtS / FEED_SETTLE_S;
+    bool feedCut = feedRate < settledFeedRate * FEED_CUT_RATIO;
+
+    // Cooling faster than the threshold is evidence, holding or heating is counter-evidence
+    float evidence = 0.0f;
+    if (settings.slopeThreshold > 0.0f)
+    {
+        evidence = (-slope - settings.slopeThreshold) / settings.slopeThreshold;
+        if (evidence > 1.0f)
+            evidence = 1.0f;
+        if (evidence < -1.0f)
+            evidence = -1.0f;
+    }
+
+    // Cooling only points at the fire when fuel was actually going in
+    if (evidence > 0.0f && settings.minFeedGrams > 0.0f && fedGrams < settings.minFeedGrams)
+        evidence *= (fedGrams > 0.0f) ? fedGrams / settings.minFeedGrams : 0.0f;
+
+    // ...and more than the fire cools by itself after a feed cut
+    if (evidence > 0.0f && feedCut)
+        evidence = 0.0f;
+
+    if (firePotTemp < settings.burningTemp)
+        evidence = 1.0f;
+
+    score += evidence * dtS;
+    if (score < 0.0f)
+        score = 0.0f;
+    if (score > EVIDENCE_TIME_S)
+        score = EVIDENCE_TIME_S;
+    confidence = score / EVIDENCE_TIME_S;
+
+    return confidence >= settings.confidence;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Online fire-health check for Auto mode. A burning fire that is being fed
+// holds or raises the fire-pot temperature; a fire-pot that keeps cooling
+// while pellets go in, or drops below the burning temperature, is evidence of
+// a flameout. Cooling after the feed rate was cut is what a healthy fire
+// does too, so it only counts once the fire has had time to settle to the
+// lower rate. Evidence is integrated into a confidence in [0, 1] so a single
+// noisy sample cannot trip it, and flameout is declared once the confidence
+// reaches the configured level. No Arduino dependencies so recorded or
+// simulated traces can be replayed through it to measure detection latency
+// and false positives.
+
+struct FlameoutSettings
+{
+    float slopeThreshold; // Fire-pot cooling rate treated as suspicious (F per second, > 0)
+    float minFeedGrams;   // Pellets fed over the window for the cooling to count fully
+    float confidence;     // Confidence needed to declare a flameout (0-1)
+    float burningTemp;    // Below this the fire-pot is out regardless of slope (F)
+};
+
+class FlameoutDetector
+{
+public:
+    static const int WINDOW_SAMPLES = 40;   // 20 s of slope history at the 500 ms task rate
+    static constexpr float EVIDENCE_TIME_S = 20.0f; // Sustained full evidence needed for confidence 1
+    static constexpr float FEED_SETTLE_S = 240.0f;  // Time constant of the feed rate the fire is settled to
+    static constexpr float FEED_CUT_RATIO = 0.9f;   // Window feed rate below this share of it counts as a cut
+
+    FlameoutDetector();
+
+    // Forget all history (call when entering a state that runs the detector)
+    void reset();
+
+    // Add one sample; deliveredGrams is the running pellet total. Returns true once flameout is declared.
+    bool update(float firePotTemp, float deliveredGrams, float dtS, const FlameoutSettings &settings);
+
+    float getConfidence() const { return confidence; }
+    float getSlope() const { return slope; }       // F per second over the window
+    float getFedGrams() const { return fedGrams; } // pellets fed over the window
+    float getSettledFeedRate() const { return settledFeedRate; } // g/s the fire is settled to
+
+private:
+    float temps[WINDOW_SAMPLES];
+    float grams[WINDOW_SAMPLES];
+    int head;
+    int count;
+    float score;
+    float confidence;
+    float slope;
+    float fedGrams;
+    float settledFeedRate; // slow average of the window feed rate, negative until the window first fills
+};
+
+extern FlameoutDetector flameoutDetector;
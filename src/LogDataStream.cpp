@@ -0,0 +1,405 @@
+#include "LogDataStream.h"
+#include <SPIFFS.h>
+#include "DataLogger.h"
+#include "LogIndex.h"
+#include "SmokerStateMachine.h"
+#include <math.h>
+#include <string.h>
+
+static const char CSV_HEADER[] = "Timestamp,SmokeChamberTemp,FirePotTemp,Setpoint,SmokeSetpoint,ActiveState,"
+                                 "IgniterMode,AugerMode,AugerDutyCycle,AugerFrequency,"
+                                 "FanMode,FanDutyCycle,FanFrequency\n";
+static const char CSV_BUCKET_HEADER[] = "Timestamp,Count,SmokeChamberTemp,SmokeChamberTempMin,SmokeChamberTempMax,"
+                                        "FirePotTemp,FirePotTempMin,FirePotTempMax,Setpoint,SmokeSetpoint,ActiveState,"
+                                        "IgniterMode,AugerMode,AugerDutyCycle,AugerDutyCycleMin,AugerDutyCycleMax,AugerFrequency,"
+                                        "FanMode,FanDutyCycle,FanDutyCycleMin,FanDutyCycleMax,FanFrequency\n";
+
+LogDataStream::LogDataStream(unsigned long startMs, unsigned long endMs, int points, Format format)
+    : LogDataStream(String(), startMs, endMs, points, format)
+{
+    ring = true;
+}
+
+LogDataStream::LogDataStream(const String &dataPath, unsigned long startMs, unsigned long endMs, int points, Format format)
+    : ring(false),
+      span{},
+      dataPath(dataPath),
+      startMs(startMs),
+      endMs(endMs),
+      bucketMs(0),
+      fileTier(-1),
+      tier(-1),
+      samplesFromMs(startMs),
+      format(format),
+      phase(Phase::Open),
+      firstRow(true),
+      timestampMs(0),
+      settings{},
+      recordSize(sizeof(LogRecord)),
+      recordCount(0),
+      recordPos(0),
+      pendingLength(0),
+      pendingPos(0)
+{
+    bucket.reset(0);
+    if (points <= 0)
+        return;
+
+    // Buckets of a whole number of the coarsest tier buckets that fit, or of seconds
+    unsigned long lastMs = endMs < DataLogger::now() ? endMs : DataLogger::now();
+    unsigned long spanMs = lastMs > startMs ? lastMs - startMs : 0;
+    bucketMs = spanMs / points + 1;
+    if (bucketMs <= DataLogger::getConfig().logIntervalMs)
+    {
+        bucketMs = 0; // every sample already fits in points rows
+        return;
+    }
+    for (int i = 0; i < DataLogger::TIER_COUNT; i++)
+    {
+        if (DataLogger::TIER_BUCKET_MS[i] <= bucketMs)
+            fileTier = i;
+    }
+    unsigned long unitMs = fileTier >= 0 ? DataLogger::TIER_BUCKET_MS[fileTier] : 1000;
+    bucketMs = (bucketMs + unitMs - 1) / unitMs * unitMs;
+
+    // Start on a bucket boundary so the first row is a whole bucket
+    this->startMs = startMs - startMs % bucketMs;
+    samplesFromMs = this->startMs;
+}
+
+LogDataStream::~LogDataStream()
+{
+    file.close();
+}
+
+size_t LogDataStream::read(uint8_t *buffer, size_t maxLength)
+{
+    size_t written = 0;
+    while (written < maxLength)
+    {
+        if (pendingPos < pendingLength)
+        {
+            size_t count = pendingLength - pendingPos;
+            if (count > maxLength - written)
+                count = maxLength - written;
+            memcpy(buffer + written, pending + pendingPos, count);
+            pendingPos += count;
+            written += count;
+            continue;
+        }
+
+        pendingLength = 0;
+        pendingPos = 0;
+        switch (phase)
+        {
+        case Phase::Open:
+            pendingLength = strlcpy(pending, format == Format::Json ? "{\"data\":[" : bucketMs ? CSV_BUCKET_HEADER : CSV_HEADER,
+                                    sizeof(pending));
+            if (ring)
+            {
+                // The file holding the start of the range, or the oldest one
+                bool found = DataLogger::findLogFile(startMs, span);
+                if (found)
+                    dataPath = DataLogger::getLogFilePath(span.index);
+                phase = found && (openSource() || openNextFile()) ? Phase::Rows : Phase::Close;
+            }
+            else
+            {
+                phase = openSource() ? Phase::Rows : Phase::Close;
+            }
+            break;
+        case Phase::Rows:
+            readRow();
+            break;
+        case Phase::Close:
+            if (format == Format::Json)
+                pendingLength = strlcpy(pending, "]}", sizeof(pending));
+            phase = Phase::Done;
+            break;
+        case Phase::Done:
+            return written;
+        }
+    }
+    return written;
+}
+
+bool LogDataStream::openSource()
+{
+    file.close();
+    recordCount = 0;
+    recordPos = 0;
+    tier = fileTier;
+    samplesFromMs = startMs;
+
+    if (tier >= 0)
+    {
+        String tierPath = DataLogger::getTierPath(dataPath, tier);
+        if (SPIFFS.exists(tierPath))
+            file = SPIFFS.open(tierPath, "r");
+        if (file && file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            LogFormat::checkHeader(header) && header.bucketMs == DataLogger::TIER_BUCKET_MS[tier])
+        {
+            // Fixed-size records in time order: binary search for the first bucket of the range
+            recordSize = sizeof(LogRollupRecord);
+            size_t low = 0;
+            size_t high = (file.size() - sizeof(header)) / recordSize;
+            while (low < high)
+            {
+                size_t mid = low + (high - low) / 2;
+                uint32_t bucketStartMs;
+                if (!file.seek(sizeof(header) + mid * recordSize) ||
+                    file.read((uint8_t *)&bucketStartMs, sizeof(bucketStartMs)) != sizeof(bucketStartMs))
+                    break;
+                if (bucketStartMs < startMs)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            file.seek(sizeof(header) + low * recordSize);
+            return true;
+        }
+        // No closed buckets yet, or an unreadable tier: all from the samples
+        file.close();
+        tier = -1;
+    }
+    return openSamples();
+}
+
+bool LogDataStream::openSamples()
+{
+    file.close();
+    recordCount = 0;
+    recordPos = 0;
+    tier = -1;
+
+    if (SPIFFS.exists(dataPath))
+        file = SPIFFS.open(dataPath, "r");
+    if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        !LogFormat::checkHeader(header) || header.bucketMs != 0)
+        return false;
+
+    // A block starts with a sync record and the settings, so nothing before it is needed
+    recordSize = sizeof(LogRecord);
+    timestampMs = header.baseTimestampMs;
+    uint32_t offset = LogIndex::find(dataPath, samplesFromMs);
+    if (offset > sizeof(header))
+        file.seek(offset);
+    return true;
+}
+
+bool LogDataStream::nextRecord(const uint8_t *&record)
+{
+    if (recordPos >= recordCount)
+    {
+        // A record cut short by a power loss at the end of the file is ignored
+        recordCount = file.read(records, sizeof(records) / recordSize * recordSize) / recordSize;
+        recordPos = 0;
+        if (recordCount == 0)
+            return false;
+    }
+    record = records + recordPos++ * recordSize;
+    return true;
+}
+
+// One record of the current source into pending[], a bucket, or the decoder state
+void LogDataStream::readRow()
+{
+    const uint8_t *data;
+    if (!nextRecord(data))
+    {
+        // The tier ran out; the samples after its last closed bucket finish the file
+        if (tier >= 0 && openSamples())
+            return;
+        if (!openNextFile())
+            finishRows();
+        return;
+    }
+
+    if (tier >= 0)
+    {
+        LogRollupRecord record;
+        memcpy(&record, data, sizeof(record));
+        if (record.timestampMs > endMs)
+        {
+            finishRows();
+            return;
+        }
+        LogRollup rollup;
+        LogFormat::decodeRollup(header, record, rollup);
+        samplesFromMs = record.timestampMs + DataLogger::TIER_BUCKET_MS[tier];
+        startBucket(record.timestampMs);
+        bucket.merge(rollup);
+        return;
+    }
+
+    LogRecord record;
+    memcpy(&record, data, sizeof(record));
+    if (LogFormat::marker(record) == LOG_SETTINGS_MARKER)
+    {
+        memcpy(&settings, &record, sizeof(settings));
+    }
+    else if (LogFormat::marker(record) == LOG_SYNC_MARKER)
+    {
+        LogSyncRecord sync;
+        memcpy(&sync, &record, sizeof(sync));
+        timestampMs = sync.timestampMs;
+    }
+    else
+    {
+        timestampMs += record.deltaMs;
+        // Timestamps only go forward within a file, so the range ends at the first later row
+        if (timestampMs > endMs)
+        {
+            finishRows();
+        }
+        else if (timestampMs >= samplesFromMs)
+        {
+            LogSample sample;
+            LogFormat::decode(header, settings, record, timestampMs, sample);
+            if (bucketMs == 0)
+            {
+                formatRow(sample);
+            }
+            else
+            {
+                startBucket(timestampMs);
+                bucket.add(sample);
+            }
+        }
+    }
+}
+
+bool LogDataStream::openNextFile()
+{
+    if (!ring)
+        return false;
+    LogFileSpan next;
+    while (DataLogger::nextLogFile(span, next) && next.startMs <= endMs)
+    {
+        span = next;
+        dataPath = DataLogger::getLogFilePath(span.index);
+        if (openSource())
+            return true;
+    }
+    return false;
+}
+
+// Format the open bucket if rowMs falls outside it, and open the bucket of rowMs
+void LogDataStream::startBucket(unsigned long rowMs)
+{
+    unsigned long bucketStartMs = rowMs - rowMs % bucketMs;
+    if (bucket.count > 0 && bucket.startMs == bucketStartMs)
+        return;
+    if (bucket.count > 0)
+        formatBucket(bucket);
+    bucket.reset(bucketStartMs);
+}
+
+void LogDataStream::finishRows()
+{
+    if (bucket.count > 0)
+    {
+        formatBucket(bucket);
+        bucket.reset(0);
+    }
+    phase = Phase::Close;
+}
+
+// JSON has no NaN, an invalid reading is written as null
+static int formatTemp(char *out, size_t size, float value, bool json)
+{
+    if (isnan(value))
+        return strlcpy(out, json ? "null" : "nan", size);
+    return snprintf(out, size, "%.2f", value);
+}
+
+// One sample as a JSON object or CSV line into pending[]
+bool LogDataStream::formatRow(const LogSample &sample)
+{
+    bool json = format == Format::Json;
+    char smokeChamberTemp[16], firePotTemp[16], setpoint[16];
+    formatTemp(smokeChamberTemp, sizeof(smokeChamberTemp), sample.smokeChamberTemp, json);
+    formatTemp(firePotTemp, sizeof(firePotTemp), sample.firePotTemp, json);
+    formatTemp(setpoint, sizeof(setpoint), sample.setpoint, json);
+    const char *state = SmokerStateMachine::GetStateName((SmokerStateMachine::State)sample.state);
+
+    int length;
+    if (json)
+    {
+        length = snprintf(pending, sizeof(pending),
+                          "%s{\"timestamp\":%lu,\"smokeChamberTemp\":%s,\"firePotTemp\":%s,\"setpoint\":%s,"
+                          "\"smokeSetpoint\":%.2f,\"activeState\":\"%s\",\"igniterMode\":%d,\"augerMode\":%d,"
+                          "\"augerDutyCycle\":%.2f,\"augerFrequency\":%.2f,\"fanMode\":%d,"
+                          "\"fanDutyCycle\":%.2f,\"fanFrequency\":%.2f}",
+                          firstRow ? "" : ",", sample.timestampMs, smokeChamberTemp, firePotTemp, setpoint,
+                          sample.smokesetpoint, state, sample.igniterMode, sample.augerMode,
+                          sample.augerDutyCycle, sample.augerFrequency, sample.fanMode,
+                          sample.fanDutyCycle, sample.fanFrequency);
+    }
+    else
+    {
+        length = snprintf(pending, sizeof(pending), "%lu,%s,%s,%s,%.2f,%s,%d,%d,%.2f,%.2f,%d,%.2f,%.2f\n",
+                          sample.timestampMs, smokeChamberTemp, firePotTemp, setpoint,
+                          sample.smokesetpoint, state, sample.igniterMode, sample.augerMode,
+                          sample.augerDutyCycle, sample.augerFrequency, sample.fanMode,
+                          sample.fanDutyCycle, sample.fanFrequency);
+    }
+    if (length < 0 || (size_t)length >= sizeof(pending))
+        return false;
+
+    pendingLength = length;
+    firstRow = false;
+    return true;
+}
+
+// One bucket as a JSON object or CSV line into pending[]: the sample columns
+// hold the means (or the last value, for setpoints, state and modes), with Min/Max beside them
+bool LogDataStream::formatBucket(const LogRollup &rollup)
+{
+    bool json = format == Format::Json;
+    const LogStat *stats[] = {&rollup.smokeChamberTemp, &rollup.firePotTemp, &rollup.augerDutyCycle, &rollup.fanDutyCycle};
+    char values[4][3][16]; // mean, min, max of each
+    for (int i = 0; i < 4; i++)
+    {
+        formatTemp(values[i][0], sizeof(values[i][0]), stats[i]->mean(), json);
+        formatTemp(values[i][1], sizeof(values[i][1]), stats[i]->count ? stats[i]->min : NAN, json);
+        formatTemp(values[i][2], sizeof(values[i][2]), stats[i]->count ? stats[i]->max : NAN, json);
+    }
+    char setpoint[16];
+    formatTemp(setpoint, sizeof(setpoint), rollup.last.setpoint, json);
+    const LogSample &last = rollup.last;
+    const char *state = SmokerStateMachine::GetStateName((SmokerStateMachine::State)last.state);
+
+    int length;
+    if (json)
+    {
+        length = snprintf(pending, sizeof(pending),
+                          "%s{\"timestamp\":%lu,\"count\":%lu,"
+                          "\"smokeChamberTemp\":%s,\"smokeChamberTempMin\":%s,\"smokeChamberTempMax\":%s,"
+                          "\"firePotTemp\":%s,\"firePotTempMin\":%s,\"firePotTempMax\":%s,"
+                          "\"setpoint\":%s,\"smokeSetpoint\":%.2f,\"activeState\":\"%s\",\"igniterMode\":%d,\"augerMode\":%d,"
+                          "\"augerDutyCycle\":%s,\"augerDutyCycleMin\":%s,\"augerDutyCycleMax\":%s,\"augerFrequency\":%.2f,"
+                          "\"fanMode\":%d,\"fanDutyCycle\":%s,\"fanDutyCycleMin\":%s,\"fanDutyCycleMax\":%s,\"fanFrequency\":%.2f}",
+                          firstRow ? "" : ",", (unsigned long)rollup.startMs, (unsigned long)rollup.count,
+                          values[0][0], values[0][1], values[0][2], values[1][0], values[1][1], values[1][2],
+                          setpoint, last.smokesetpoint, state, last.igniterMode, last.augerMode,
+                          values[2][0], values[2][1], values[2][2], last.augerFrequency,
+                          last.fanMode, values[3][0], values[3][1], values[3][2], last.fanFrequency);
+    }
+    else
+    {
+        length = snprintf(pending, sizeof(pending),
+                          "%lu,%lu,%s,%s,%s,%s,%s,%s,%s,%.2f,%s,%d,%d,%s,%s,%s,%.2f,%d,%s,%s,%s,%.2f\n",
+                          (unsigned long)rollup.startMs, (unsigned long)rollup.count,
+                          values[0][0], values[0][1], values[0][2], values[1][0], values[1][1], values[1][2],
+                          setpoint, last.smokesetpoint, state, last.igniterMode, last.augerMode,
+                          values[2][0], values[2][1], values[2][2], last.augerFrequency,
+                          last.fanMode, values[3][0], values[3][1], values[3][2], last.fanFrequency);
+    }
+    if (length < 0 || (size_t)length >= sizeof(pending))
+        return false;
+
+    pendingLength = length;
+    firstRow = false;
+    return true;
+}
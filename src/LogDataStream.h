@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "LogFormat.h"
+#include "DataLogger.h"
+
+// Decodes the binary log files (see LogFormat.h) into either the
+// /api/logging/data JSON ({"data":[{...},...]}) or the CSV download, a piece
+// at a time, so the response can be sent with chunked transfer encoding.
+// It reads one file, or the whole rotation ring as one log: the files
+// holding the range, oldest first, each opened only when the previous one is
+// done. Records are read through a fixed buffer; memory use is the object
+// itself (about 1.5 KB) whatever the size of the log or of the range asked for.
+//
+// With points > 0 the range is cut into equal buckets, at most about points
+// of them, and each row is the min/max/mean of a bucket. Buckets are built
+// from the coarsest rolled-up tier that fits (see DataLogger.h), then from
+// the samples logged after its last closed bucket.
+class LogDataStream
+{
+public:
+    enum class Format
+    {
+        Json,
+        Csv
+    };
+
+    // Rows timestamped from startMs to endMs inclusive, from all log files
+    LogDataStream(unsigned long startMs, unsigned long endMs, int points, Format format);
+
+    // ...from the log file at dataPath only
+    LogDataStream(const String &dataPath, unsigned long startMs, unsigned long endMs, int points, Format format);
+    ~LogDataStream();
+
+    // Copy up to maxLength bytes of the response into buffer; 0 once the response is complete
+    size_t read(uint8_t *buffer, size_t maxLength);
+
+private:
+    static const size_t READ_BYTES = 320; // 32 samples or 10 rollups
+
+    enum class Phase
+    {
+        Open,
+        Rows,
+        Close,
+        Done
+    };
+
+    bool ring;        // walk the rotation ring rather than one file
+    LogFileSpan span; // file being read, when walking the ring
+    String dataPath;
+    File file;
+    unsigned long startMs;
+    unsigned long endMs;
+    unsigned long bucketMs;      // length of an output row, 0 for a row per sample
+    int fileTier;                // tier to read from each file, -1 for none
+    int tier;                    // tier file being read, -1 for the samples
+    unsigned long samplesFromMs; // earlier samples are covered by the tier
+    Format format;
+    Phase phase;
+    bool firstRow;
+
+    LogFileHeader header;
+    uint32_t timestampMs;       // absolute time of the last decoded record
+    LogSettingsRecord settings; // setpoints and frequencies in effect
+    LogRollup bucket;           // output row being built
+
+    uint8_t records[READ_BYTES];
+    size_t recordSize;
+    size_t recordCount;
+    size_t recordPos;
+
+    char pending[640]; // formatted output not yet handed out
+    size_t pendingLength;
+    size_t pendingPos;
+
+    // Open the current file's tier, or its samples, at the first record of the range
+    bool openSource();
+    // Open the current file's samples after the buckets read from its tier
+    bool openSamples();
+    // Move to the next file of the ring holding part of the range
+    bool openNextFile();
+    bool nextRecord(const uint8_t *&record);
+    void readRow();
+    void startBucket(unsigned long rowMs);
+    void finishRows();
+    bool formatRow(const LogSample &sample);
+    bool formatBucket(const LogRollup &rollup);
+};
@@ -0,0 +1,255 @@
+#include "LogFormat.h"
+#include <math.h>
+#include <string.h>
+
+static const float TEMP_SCALE = 0.1f;
+static const float SMOKE_SETPOINT_SCALE = 0.5f;
+static const float DUTY_SCALE = 0.5f;
+static const float FREQUENCY_SCALE = 0.1f;
+
+static int16_t scaleTemp(float value, float scale)
+{
+    if (isnan(value))
+        return LOG_INVALID_TEMP;
+    float counts = roundf(value / scale);
+    if (counts <= INT16_MIN || counts > INT16_MAX)
+        return LOG_INVALID_TEMP;
+    return (int16_t)counts;
+}
+
+static uint8_t scaleByte(float value, float scale)
+{
+    if (isnan(value) || value <= 0.0f)
+        return 0;
+    float counts = roundf(value / scale);
+    return counts > 255.0f ? 255 : (uint8_t)counts;
+}
+
+static float unscaleTemp(int16_t counts, float scale)
+{
+    return counts == LOG_INVALID_TEMP ? NAN : counts * scale;
+}
+
+LogFileHeader LogFormat::makeHeader(uint32_t baseTimestampMs, uint32_t bucketMs)
+{
+    LogFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+    header.schemaVersion = LOG_SCHEMA_VERSION;
+    header.recordSize = bucketMs ? sizeof(LogRollupRecord) : sizeof(LogRecord);
+    header.baseTimestampMs = baseTimestampMs;
+    header.tempScale = TEMP_SCALE;
+    header.smokeSetpointScale = SMOKE_SETPOINT_SCALE;
+    header.dutyScale = DUTY_SCALE;
+    header.frequencyScale = FREQUENCY_SCALE;
+    header.bucketMs = bucketMs;
+    return header;
+}
+
+bool LogFormat::checkHeader(const LogFileHeader &header)
+{
+    return memcmp(header.magic, LOG_MAGIC, sizeof(header.magic)) == 0 &&
+           header.schemaVersion == LOG_SCHEMA_VERSION &&
+           header.recordSize == (header.bucketMs ? sizeof(LogRollupRecord) : sizeof(LogRecord));
+}
+
+LogRecord LogFormat::encode(const LogSample &sample, uint16_t deltaMs)
+{
+    LogRecord record;
+    record.deltaMs = deltaMs;
+    record.smokeChamberTemp = scaleTemp(sample.smokeChamberTemp, TEMP_SCALE);
+    record.firePotTemp = scaleTemp(sample.firePotTemp, TEMP_SCALE);
+    record.state = (uint8_t)sample.state;
+    record.modes = (uint8_t)(((sample.igniterMode & 0x3) << 6) | ((sample.augerMode & 0x7) << 3) | (sample.fanMode & 0x7));
+    record.augerDutyCycle = scaleByte(sample.augerDutyCycle, DUTY_SCALE);
+    record.fanDutyCycle = scaleByte(sample.fanDutyCycle, DUTY_SCALE);
+    return record;
+}
+
+LogSettingsRecord LogFormat::encodeSettings(const LogSample &sample)
+{
+    LogSettingsRecord record;
+    memset(&record, 0, sizeof(record));
+    record.marker = LOG_SETTINGS_MARKER;
+    record.setpoint = scaleTemp(sample.setpoint, TEMP_SCALE);
+    record.smokesetpoint = scaleByte(sample.smokesetpoint, SMOKE_SETPOINT_SCALE);
+    record.augerFrequency = scaleByte(sample.augerFrequency, FREQUENCY_SCALE);
+    record.fanFrequency = scaleByte(sample.fanFrequency, FREQUENCY_SCALE);
+    return record;
+}
+
+LogSyncRecord LogFormat::makeSync(uint32_t timestampMs)
+{
+    LogSyncRecord record;
+    memset(&record, 0, sizeof(record));
+    record.marker = LOG_SYNC_MARKER;
+    record.timestampMs = timestampMs;
+    return record;
+}
+
+void LogFormat::decode(const LogFileHeader &header, const LogSettingsRecord &settings, const LogRecord &record,
+                       uint32_t timestampMs, LogSample &sample)
+{
+    sample.timestampMs = timestampMs;
+    sample.smokeChamberTemp = unscaleTemp(record.smokeChamberTemp, header.tempScale);
+    sample.firePotTemp = unscaleTemp(record.firePotTemp, header.tempScale);
+    sample.setpoint = unscaleTemp(settings.setpoint, header.tempScale);
+    sample.smokesetpoint = settings.smokesetpoint * header.smokeSetpointScale;
+    sample.state = record.state;
+    sample.igniterMode = (record.modes >> 6) & 0x3;
+    sample.augerMode = (record.modes >> 3) & 0x7;
+    sample.fanMode = record.modes & 0x7;
+    sample.augerDutyCycle = record.augerDutyCycle * header.dutyScale;
+    sample.fanDutyCycle = record.fanDutyCycle * header.dutyScale;
+    sample.augerFrequency = settings.augerFrequency * header.frequencyScale;
+    sample.fanFrequency = settings.fanFrequency * header.frequencyScale;
+}
+
+LogRollupRecord LogFormat::encodeRollup(const LogRollup &rollup)
+{
+    LogRollupRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestampMs = rollup.startMs;
+    record.count = rollup.count > UINT16_MAX ? UINT16_MAX : rollup.count;
+    const LogStat *temps[] = {&rollup.smokeChamberTemp, &rollup.firePotTemp};
+    int16_t *tempFields[] = {record.smokeChamberTemp, record.firePotTemp};
+    for (int i = 0; i < 2; i++)
+    {
+        tempFields[i][0] = scaleTemp(temps[i]->count ? temps[i]->min : NAN, TEMP_SCALE);
+        tempFields[i][1] = scaleTemp(temps[i]->mean(), TEMP_SCALE);
+        tempFields[i][2] = scaleTemp(temps[i]->count ? temps[i]->max : NAN, TEMP_SCALE);
+    }
+    const LogStat *duties[] = {&rollup.augerDutyCycle, &rollup.fanDutyCycle};
+    uint8_t *dutyFields[] = {record.augerDutyCycle, record.fanDutyCycle};
+    for (int i = 0; i < 2; i++)
+    {
+        dutyFields[i][0] = scaleByte(duties[i]->count ? duties[i]->min : NAN, DUTY_SCALE);
+        dutyFields[i][1] = scaleByte(duties[i]->mean(), DUTY_SCALE);
+        dutyFields[i][2] = scaleByte(duties[i]->count ? duties[i]->max : NAN, DUTY_SCALE);
+    }
+
+    LogRecord last = encode(rollup.last, 0);
+    LogSettingsRecord settings = encodeSettings(rollup.last);
+    record.setpoint = settings.setpoint;
+    record.smokesetpoint = settings.smokesetpoint;
+    record.state = last.state;
+    record.modes = last.modes;
+    record.augerFrequency = settings.augerFrequency;
+    record.fanFrequency = settings.fanFrequency;
+    return record;
+}
+
+// A stat from its scaled min, mean and max; the mean stands in for every sample
+static void unscaleStat(const int16_t counts[3], float scale, uint32_t count, LogStat &stat)
+{
+    stat.reset();
+    float mean = unscaleTemp(counts[1], scale);
+    if (isnan(mean) || count == 0)
+        return;
+    stat.min = unscaleTemp(counts[0], scale);
+    stat.max = unscaleTemp(counts[2], scale);
+    stat.sum = mean * count;
+    stat.count = count;
+}
+
+void LogFormat::decodeRollup(const LogFileHeader &header, const LogRollupRecord &record, LogRollup &rollup)
+{
+    rollup.reset(record.timestampMs);
+    rollup.count = record.count;
+    unscaleStat(record.smokeChamberTemp, header.tempScale, record.count, rollup.smokeChamberTemp);
+    unscaleStat(record.firePotTemp, header.tempScale, record.count, rollup.firePotTemp);
+    int16_t augerDutyCycle[3], fanDutyCycle[3];
+    for (int i = 0; i < 3; i++)
+    {
+        augerDutyCycle[i] = record.augerDutyCycle[i];
+        fanDutyCycle[i] = record.fanDutyCycle[i];
+    }
+    unscaleStat(augerDutyCycle, header.dutyScale, record.count, rollup.augerDutyCycle);
+    unscaleStat(fanDutyCycle, header.dutyScale, record.count, rollup.fanDutyCycle);
+
+    LogRecord last;
+    memset(&last, 0, sizeof(last));
+    last.smokeChamberTemp = record.smokeChamberTemp[1];
+    last.firePotTemp = record.firePotTemp[1];
+    last.state = record.state;
+    last.modes = record.modes;
+    last.augerDutyCycle = record.augerDutyCycle[1];
+    last.fanDutyCycle = record.fanDutyCycle[1];
+    LogSettingsRecord settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.setpoint = record.setpoint;
+    settings.smokesetpoint = record.smokesetpoint;
+    settings.augerFrequency = record.augerFrequency;
+    settings.fanFrequency = record.fanFrequency;
+    decode(header, settings, last, record.timestampMs, rollup.last);
+}
+
+void LogStat::reset()
+{
+    min = NAN;
+    max = NAN;
+    sum = 0.0f;
+    count = 0;
+}
+
+void LogStat::add(float value)
+{
+    if (isnan(value))
+        return;
+    if (count == 0 || value < min)
+        min = value;
+    if (count == 0 || value > max)
+        max = value;
+    sum += value;
+    count++;
+}
+
+void LogStat::merge(const LogStat &other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0 || other.min < min)
+        min = other.min;
+    if (count == 0 || other.max > max)
+        max = other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+float LogStat::mean() const
+{
+    return count ? sum / count : NAN;
+}
+
+void LogRollup::reset(uint32_t startMs)
+{
+    this->startMs = startMs;
+    count = 0;
+    smokeChamberTemp.reset();
+    firePotTemp.reset();
+    augerDutyCycle.reset();
+    fanDutyCycle.reset();
+    memset(&last, 0, sizeof(last));
+}
+
+void LogRollup::add(const LogSample &sample)
+{
+    count++;
+    smokeChamberTemp.add(sample.smokeChamberTemp);
+    firePotTemp.add(sample.firePotTemp);
+    augerDutyCycle.add(sample.augerDutyCycle);
+    fanDutyCycle.add(sample.fanDutyCycle);
+    last = sample;
+}
+
+void LogRollup::merge(const LogRollup &other)
+{
+    if (other.count == 0)
+        return;
+    count += other.count;
+    smokeChamberTemp.merge(other.smokeChamberTemp);
+    firePotTemp.merge(other.firePotTemp);
+    augerDutyCycle.merge(other.augerDutyCycle);
+    fanDutyCycle.merge(other.fanDutyCycle);
+    last = other.last;
+}
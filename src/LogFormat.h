@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary data log layout. A log file is one LogFileHeader followed by
+// fixed-size records. Sample records store their time as a delta from the
+// previous record (the first from the header's base), temperatures and duty
+// cycles as scaled integers, the state as its SmokerStateMachine::State
+// number and the three output modes packed in one byte. The scales are
+// written into the header so a reader decodes any file by its own header.
+//
+// The first field of every record tells the kinds apart:
+// - LOG_SETTINGS_MARKER: setpoints and PWM frequencies. They rarely change,
+//   so they are written once per file and again only when they change; the
+//   samples that follow carry them implicitly.
+// - LOG_SYNC_MARKER: an absolute timestamp, for a gap too long for a 16-bit
+//   delta, after a reboot, and at the start of every block of LogIndex.h
+//   (always followed by a settings record, so decoding can start there).
+// - anything else: a sample.
+//
+// Rolled-up tier files (one per bucket length, see DataLogger) use the same
+// header with bucketMs set, followed by LogRollupRecords in time order.
+
+static const char LOG_MAGIC[4] = {'S', 'L', 'O', 'G'};
+static const uint16_t LOG_SCHEMA_VERSION = 1;
+static const uint16_t LOG_SYNC_MARKER = 0xFFFF;
+static const uint16_t LOG_SETTINGS_MARKER = 0xFFFE;
+static const uint16_t LOG_MAX_DELTA_MS = 0xFFFD;
+static const int16_t LOG_INVALID_TEMP = INT16_MIN; // NaN or out of range reading
+
+#pragma pack(push, 1)
+struct LogFileHeader
+{
+    char magic[4];
+    uint16_t schemaVersion;
+    uint16_t recordSize;
+    uint32_t baseTimestampMs; // DataLogger::now() the first record's delta counts from
+    float tempScale;          // F per count: smokeChamberTemp, firePotTemp, setpoint
+    float smokeSetpointScale;
+    float dutyScale;          // % per count
+    float frequencyScale;     // Hz per count
+    uint32_t bucketMs;        // rollup tier files: bucket length; 0 for sample files
+};
+
+struct LogRecord
+{
+    uint16_t deltaMs; // since the previous sample or sync record
+    int16_t smokeChamberTemp;
+    int16_t firePotTemp;
+    uint8_t state;
+    uint8_t modes; // igniter bits 7-6, auger bits 5-3, fan bits 2-0
+    uint8_t augerDutyCycle;
+    uint8_t fanDutyCycle;
+};
+
+struct LogSettingsRecord
+{
+    uint16_t marker; // LOG_SETTINGS_MARKER
+    int16_t setpoint;
+    uint8_t smokesetpoint;
+    uint8_t augerFrequency;
+    uint8_t fanFrequency;
+    uint8_t reserved[3];
+};
+
+struct LogSyncRecord
+{
+    uint16_t marker; // LOG_SYNC_MARKER
+    uint32_t timestampMs;
+    uint8_t reserved[4];
+};
+
+struct LogRollupRecord
+{
+    uint32_t timestampMs; // bucket start
+    uint16_t count;       // samples in the bucket
+    int16_t smokeChamberTemp[3]; // min, mean, max
+    int16_t firePotTemp[3];
+    uint8_t augerDutyCycle[3];
+    uint8_t fanDutyCycle[3];
+    int16_t setpoint; // the rest as of the last sample in the bucket
+    uint8_t smokesetpoint;
+    uint8_t state;
+    uint8_t modes;
+    uint8_t augerFrequency;
+    uint8_t fanFrequency;
+    uint8_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LogFileHeader) == 32, "log header layout");
+static_assert(sizeof(LogRecord) == 10, "log record layout");
+static_assert(sizeof(LogSettingsRecord) == sizeof(LogRecord), "settings record must match the record size");
+static_assert(sizeof(LogSyncRecord) == sizeof(LogRecord), "sync record must match the record size");
+static_assert(sizeof(LogRollupRecord) == 32, "rollup record layout");
+
+// One decoded sample, the columns of the CSV export
+struct LogSample
+{
+    unsigned long timestampMs;
+    float smokeChamberTemp;
+    float firePotTemp;
+    float setpoint;
+    float smokesetpoint;
+    int state;
+    int igniterMode;
+    int augerMode;
+    float augerDutyCycle;
+    float augerFrequency;
+    int fanMode;
+    float fanDutyCycle;
+    float fanFrequency;
+};
+
+// Min, max and mean of one channel over a bucket; NaN readings are left out
+struct LogStat
+{
+    float min;
+    float max;
+    float sum;
+    uint32_t count;
+
+    void reset();
+    void add(float value);
+    void merge(const LogStat &other);
+    float mean() const; // NaN when there were no readings
+};
+
+// The samples of one time bucket rolled up, a row of the rolled-up tiers
+struct LogRollup
+{
+    uint32_t startMs;
+    uint32_t count;
+    LogStat smokeChamberTemp;
+    LogStat firePotTemp;
+    LogStat augerDutyCycle;
+    LogStat fanDutyCycle;
+    LogSample last; // setpoints, state, modes and frequencies at the end of the bucket
+
+    void reset(uint32_t startMs);
+    void add(const LogSample &sample);
+    void merge(const LogRollup &other); // a later bucket that falls inside this one
+};
+
+class LogFormat
+{
+public:
+    // Header for a new file whose first record counts from baseTimestampMs;
+    // bucketMs for a rollup tier file
+    static LogFileHeader makeHeader(uint32_t baseTimestampMs, uint32_t bucketMs = 0);
+
+    // True if the header is one this build can decode
+    static bool checkHeader(const LogFileHeader &header);
+
+    // Scale a sample into its records; deltaMs must not exceed LOG_MAX_DELTA_MS
+    static LogRecord encode(const LogSample &sample, uint16_t deltaMs);
+    static LogSettingsRecord encodeSettings(const LogSample &sample);
+    static LogSyncRecord makeSync(uint32_t timestampMs);
+
+    // Record kind from its first field
+    static uint16_t marker(const LogRecord &record) { return record.deltaMs; }
+
+    // Unscale a sample record with the file's header and the settings in effect;
+    // timestampMs is the absolute time of the record
+    static void decode(const LogFileHeader &header, const LogSettingsRecord &settings, const LogRecord &record,
+                       uint32_t timestampMs, LogSample &sample);
+
+    // Scale a closed bucket for a tier file, and back with that file's header
+    static LogRollupRecord encodeRollup(const LogRollup &rollup);
+    static void decodeRollup(const LogFileHeader &header, const LogRollupRecord &record, LogRollup &rollup);
+};
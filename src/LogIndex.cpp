@@ -0,0 +1,146 @@
+#include "LogIndex.h"
+#include <SPIFFS.h>
+#include <string.h>
+
+static const size_t SCAN_RECORDS = 16;
+
+String LogIndex::getPath(const String &dataPath)
+{
+    return dataPath.substring(0, dataPath.lastIndexOf('.')) + ".idx";
+}
+
+bool LogIndex::update(const String &dataPath, uint32_t &lastTimestampMs)
+{
+    File data = SPIFFS.open(dataPath, "r");
+    if (!data)
+        return false;
+
+    LogFileHeader header;
+    if (data.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || !LogFormat::checkHeader(header))
+    {
+        data.close();
+        return false;
+    }
+    uint32_t dataSize = data.size();
+    uint32_t offset = sizeof(header);
+    uint32_t timestampMs = header.baseTimestampMs;
+
+    // Resume after the last entry if it still points at the sync record it describes,
+    // otherwise the index is from an older file in this slot or cut short: rebuild it
+    String indexPath = getPath(dataPath);
+    if (SPIFFS.exists(indexPath))
+    {
+        File index = SPIFFS.open(indexPath, "r");
+        size_t indexSize = index ? index.size() : 0;
+        bool valid = index && indexSize % sizeof(LogIndexEntry) == 0;
+        if (valid && indexSize > 0)
+        {
+            LogIndexEntry last;
+            LogSyncRecord sync;
+            valid = index.seek(indexSize - sizeof(last)) &&
+                    index.read((uint8_t *)&last, sizeof(last)) == sizeof(last) &&
+                    last.offset >= sizeof(header) && last.offset + sizeof(sync) <= dataSize &&
+                    data.seek(last.offset) &&
+                    data.read((uint8_t *)&sync, sizeof(sync)) == sizeof(sync) &&
+                    sync.marker == LOG_SYNC_MARKER && sync.timestampMs == last.timestampMs;
+            if (valid)
+            {
+                offset = last.offset + sizeof(sync);
+                timestampMs = last.timestampMs;
+            }
+        }
+        if (index)
+            index.close();
+        if (!valid)
+        {
+            Serial.println("Rebuilding log index: " + indexPath);
+            SPIFFS.remove(indexPath);
+        }
+    }
+
+    // Index the sync records past that point and follow the timeline to the last record
+    data.seek(offset);
+    LogRecord records[SCAN_RECORDS];
+    LogIndexEntry entries[SCAN_RECORDS];
+    size_t entryCount = 0;
+    size_t count;
+    while ((count = data.read((uint8_t *)records, sizeof(records)) / sizeof(LogRecord)) > 0)
+    {
+        for (size_t i = 0; i < count; i++, offset += sizeof(LogRecord))
+        {
+            uint16_t marker = LogFormat::marker(records[i]);
+            if (marker == LOG_SYNC_MARKER)
+            {
+                LogSyncRecord sync;
+                memcpy(&sync, &records[i], sizeof(sync));
+                timestampMs = sync.timestampMs;
+                entries[entryCount].timestampMs = timestampMs;
+                entries[entryCount].offset = offset;
+                if (++entryCount == SCAN_RECORDS)
+                {
+                    append(dataPath, entries, entryCount);
+                    entryCount = 0;
+                }
+            }
+            else if (marker != LOG_SETTINGS_MARKER)
+            {
+                timestampMs += records[i].deltaMs;
+            }
+        }
+    }
+    data.close();
+    if (entryCount > 0)
+        append(dataPath, entries, entryCount);
+
+    lastTimestampMs = timestampMs;
+    return true;
+}
+
+void LogIndex::append(const String &dataPath, const LogIndexEntry *entries, size_t count)
+{
+    String indexPath = getPath(dataPath);
+    File index = SPIFFS.open(indexPath, "a");
+    if (!index)
+    {
+        Serial.println("Failed to open log index: " + indexPath);
+        return;
+    }
+    index.write((const uint8_t *)entries, count * sizeof(LogIndexEntry));
+    index.close();
+}
+
+uint32_t LogIndex::find(const String &dataPath, uint32_t startMs)
+{
+    uint32_t offset = sizeof(LogFileHeader);
+    String indexPath = getPath(dataPath);
+    if (!SPIFFS.exists(indexPath))
+        return offset;
+    File index = SPIFFS.open(indexPath, "r");
+    if (!index)
+        return offset;
+
+    // Count the entries before startMs; the last of them starts the first block to read
+    LogIndexEntry entry;
+    size_t low = 0;
+    size_t high = index.size() / sizeof(entry);
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (!index.seek(mid * sizeof(entry)) || index.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+        {
+            low = 0; // unreadable, fall back to the whole file
+            break;
+        }
+        if (entry.timestampMs < startMs)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low > 0 && index.seek((low - 1) * sizeof(entry)) &&
+        index.read((uint8_t *)&entry, sizeof(entry)) == sizeof(entry))
+    {
+        offset = entry.offset;
+    }
+    index.close();
+    return offset;
+}
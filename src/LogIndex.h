@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "LogFormat.h"
+
+// Sparse time index kept next to each binary log file (data_N.bin has
+// data_N.idx). The writer starts a new block at least every BLOCK_RECORDS
+// samples with a sync record followed by a settings record, so decoding can
+// begin at any sync record without reading what comes before it. The index is
+// the {timestamp, offset} of every sync record in file order. Log timestamps
+// never go backwards within a file (see DataLogger::now()), so a range query
+// binary-searches the index and seeks straight to the first block it needs.
+//
+// The index is derived data: entries are appended after the records they
+// point at reach flash, and update() rebuilds a missing or damaged index, or
+// adds the entries a power cut lost, by scanning the data file.
+#pragma pack(push, 1)
+struct LogIndexEntry
+{
+    uint32_t timestampMs; // of the sync record
+    uint32_t offset;      // of the sync record in the data file
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LogIndexEntry) == 8, "log index entry layout");
+
+class LogIndex
+{
+public:
+    static const int BLOCK_RECORDS = 64; // samples between sync records, at most
+
+    // Index path for a data file path
+    static String getPath(const String &dataPath);
+
+    // Bring the index of an existing data file up to date. False if the data
+    // file has no valid header; otherwise lastTimestampMs is the time of its
+    // last record (the header base if it has none).
+    static bool update(const String &dataPath, uint32_t &lastTimestampMs);
+
+    // Append entries for sync records that were just written to the data file
+    static void append(const String &dataPath, const LogIndexEntry *entries, size_t count);
+
+    // Offset to start decoding from to see every sample at or after startMs:
+    // the last block that starts before startMs, or the first record after the header
+    static uint32_t find(const String &dataPath, uint32_t startMs);
+};
@@ -0,0 +1,119 @@
+#include "PelletFeed.h"
+#include "SmokerControl.h"
+#include "RelayDriver.h"
+
+// Static member initialization
+PelletFeed::CalibrationState PelletFeed::calibrationState = PelletFeed::CalibrationState::Idle;
+unsigned long PelletFeed::calibrationEndMs = 0;
+unsigned long long PelletFeed::calibrationStartOnMs = 0;
+unsigned long long PelletFeed::calibrationOnMs = 0;
+unsigned long long PelletFeed::lastOnTimeMs = 0;
+float PelletFeed::deliveredGrams = 0.0f;
+int PelletFeed::modeBeforeCalibration = static_cast<int>(AugerControl::Mode::Off);
+
+unsigned long long PelletFeed::augerOnTimeMs()
+{
+    return RelayDriver::getStats(RelayDriver::Auger).onTimeMs;
+}
+
+bool PelletFeed::startCalibration(unsigned long durationMs)
+{
+    // Never hijack an auger that is feeding a fire
+    if (calibrationState == CalibrationState::Running ||
+        (smokerData.auger.mode != AugerControl::Mode::Off && smokerData.auger.mode != AugerControl::Mode::Manual) ||
+        durationMs == 0)
+    {
+        return false;
+    }
+
+    modeBeforeCalibration = static_cast<int>(smokerData.auger.mode);
+    smokerData.auger.mode = AugerControl::Mode::On;
+    calibrationStartOnMs = augerOnTimeMs();
+    calibrationOnMs = 0;
+    calibrationEndMs = millis() + durationMs;
+    calibrationState = CalibrationState::Running;
+    return true;
+}
+
+bool PelletFeed::finishCalibration(float grams)
+{
+    if (calibrationState != CalibrationState::WaitingForWeight || grams <= 0.0f || calibrationOnMs == 0)
+    {
+        return false;
+    }
+
+    // Measured relay on-time rather than the requested duration
+    smokerConfig.tunable.augerGramsPerSecond = grams / (calibrationOnMs / 1000.0f);
+    calibrationState = CalibrationState::Idle;
+    return true;
+}
+
+void PelletFeed::cancelCalibration()
+{
+    if (calibrationState == CalibrationState::Running)
+    {
+        // Only give the auger back if nothing else has taken it since
+        if (smokerData.auger.mode == AugerControl::Mode::On)
+        {
+            smokerData.auger.mode = static_cast<AugerControl::Mode>(modeBeforeCalibration);
+        }
+        lastOnTimeMs = augerOnTimeMs(); // calibration pellets went into the container
+    }
+    calibrationState = CalibrationState::Idle;
+}
+
+void PelletFeed::task()
+{
+    unsigned long long onTimeMs = augerOnTimeMs();
+    if (calibrationState != CalibrationState::Running)
+    {
+        deliveredGrams += ((onTimeMs - lastOnTimeMs) / 1000.0f) * smokerConfig.tunable.augerGramsPerSecond;
+    }
+    lastOnTimeMs = onTimeMs;
+
+    if (calibrationState == CalibrationState::Running)
+    {
+        if (smokerData.auger.mode != AugerControl::Mode::On)
+        {
+            // Something else set the auger mode, the run is no longer timed on-time
+            calibrationState = CalibrationState::Idle;
+        }
+        else if ((long)(millis() - calibrationEndMs) >= 0)
+        {
+            smokerData.auger.mode = static_cast<AugerControl::Mode>(modeBeforeCalibration);
+            calibrationOnMs = onTimeMs - calibrationStartOnMs;
+            calibrationState = CalibrationState::WaitingForWeight;
+        }
+    }
+}
+
+float PelletFeed::dutyForFeedRate(float gramsPerMinute)
+{
+    if (smokerConfig.tunable.augerGramsPerSecond <= 0.0f || gramsPerMinute <= 0.0f)
+    {
+        return 0.0f;
+    }
+    float duty = (gramsPerMinute / 60.0f) / smokerConfig.tunable.augerGramsPerSecond * 100.0f;
+    return constrain(duty, 0.0f, 100.0f);
+}
+
+void PelletFeed::resetDelivered()
+{
+    deliveredGrams = 0.0f;
+    lastOnTimeMs = augerOnTimeMs();
+}
+
+const char *PelletFeed::GetCalibrationStateName(CalibrationState state)
+{
+    switch (state)
+    {
+    case CalibrationState::Idle:
+        return "Idle";
+    case CalibrationState::Running:
+        return "Running";
+    case CalibrationState::WaitingForWeight:
+        return "Waiting for Weight";
+    default:
+        return "Unknown";
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Pellet mass-flow bookkeeping for the auger.
+// - Calibration: run the auger for a fixed time into a container, weigh the
+//   pellets and report the weight; gramsPerSecond = grams / auger on-time.
+// - Mass mode: converts a target feed rate (g/min) into an auger duty cycle,
+//   so the delivered mass does not depend on the PWM period.
+// - Running integral of pellets delivered, from the achieved relay on-time
+//   (calibration runs excluded).
+class PelletFeed
+{
+public:
+    enum class CalibrationState
+    {
+        Idle = 0,
+        Running = 1,      // auger forced on for the calibration time
+        WaitingForWeight = 2
+    };
+
+    // Start a calibration run; only allowed while the fire is not being fed
+    static bool startCalibration(unsigned long durationMs);
+
+    // Finish a calibration with the weighed mass; stores augerGramsPerSecond
+    static bool finishCalibration(float grams);
+
+    // Stop a calibration run; the auger mode is restored only if it is still the On set for it
+    static void cancelCalibration();
+
+    // Update the delivered mass and the calibration timer (call from the 500ms task)
+    static void task();
+
+    // Auger duty % needed for a feed rate in grams per minute
+    static float dutyForFeedRate(float gramsPerMinute);
+
+    static void resetDelivered();
+    static float getDeliveredGrams() { return deliveredGrams; }
+    static CalibrationState getCalibrationState() { return calibrationState; }
+    static const char *GetCalibrationStateName(CalibrationState state);
+
+private:
+    static CalibrationState calibrationState;
+    static unsigned long calibrationEndMs;
+    static unsigned long long calibrationStartOnMs;
+    static unsigned long long calibrationOnMs;
+    static unsigned long long lastOnTimeMs;
+    static float deliveredGrams;
+    static int modeBeforeCalibration;
+
+    static unsigned long long augerOnTimeMs();
+};
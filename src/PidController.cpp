@@ -0,0 +1,74 @@
+#include "PidController.h"
+
+PidController::PidController()
+    : kp(0.0f), ki(0.0f), kd(0.0f),
+      outMin(0.0f), outMax(100.0f),
+      integral(0.0f),
+      pTerm(0.0f), dTerm(0.0f),
+      lastMeasurement(0.0f),
+      initialized(false)
+{
+}
+
+void PidController::setGains(float newKp, float newKi, float newKd)
+{
+    kp = newKp;
+    ki = newKi;
+    kd = newKd;
+}
+
+void PidController::setOutputLimits(float minOutput, float maxOutput)
+{
+    outMin = minOutput;
+    outMax = maxOutput;
+}
+
+void PidController::reset(float measurement)
+{
+    integral = 0.0f;
+    pTerm = 0.0f;
+    dTerm = 0.0f;
+    lastMeasurement = measurement;
+    initialized = true;
+}
+
+float PidController::update(float setpoint, float measurement, float feedforward, float dtSeconds)
+{
+    if (!initialized || dtSeconds <= 0.0f)
+    {
+        reset(measurement);
+    }
+
+    float error = setpoint - measurement;
+    pTerm = kp * error;
+
+    // Derivative on measurement so setpoint steps (recipe steps) do not kick the auger
+    dTerm = (dtSeconds > 0.0f) ? -kd * (measurement - lastMeasurement) / dtSeconds : 0.0f;
+    lastMeasurement = measurement;
+
+    float output = feedforward + pTerm + integral + dTerm;
+
+    // Only integrate when it would not push further into saturation
+    bool saturatedHigh = output >= outMax && error > 0.0f;
+    bool saturatedLow = output <= outMin && error < 0.0f;
+    if (!saturatedHigh && !saturatedLow)
+    {
+        integral += ki * error * dtSeconds;
+    }
+
+    // The integrator alone may never hold more than the full output range
+    float integralMax = outMax - feedforward;
+    float integralMin = outMin - feedforward;
+    if (integral > integralMax)
+        integral = integralMax;
+    if (integral < integralMin)
+        integral = integralMin;
+
+    output = feedforward + pTerm + integral + dTerm;
+    if (output > outMax)
+        output = outMax;
+    if (output < outMin)
+        output = outMin;
+
+    return output;
+}
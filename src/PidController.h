@@ -0,0 +1,30 @@
+#pragma once
+
+// Discrete PID with feedforward, derivative on measurement and integrator
+// clamping. Call update() at a fixed rate with the real elapsed time.
+class PidController
+{
+public:
+    PidController();
+
+    void setGains(float kp, float ki, float kd);
+    void setOutputLimits(float minOutput, float maxOutput);
+
+    // Clear the integrator and derivative history (bumpless start from feedforward)
+    void reset(float measurement);
+
+    // Returns feedforward + P + I + D limited to the output range
+    float update(float setpoint, float measurement, float feedforward, float dtSeconds);
+
+    float getProportional() const { return pTerm; }
+    float getIntegral() const { return integral; }
+    float getDerivative() const { return dTerm; }
+
+private:
+    float kp, ki, kd;
+    float outMin, outMax;
+    float integral;
+    float pTerm, dTerm;
+    float lastMeasurement;
+    bool initialized;
+};
@@ -0,0 +1,108 @@
+#include "Profiler.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static portMUX_TYPE zoneMux = portMUX_INITIALIZER_UNLOCKED;
+#define ZONE_LOCK() portENTER_CRITICAL(&zoneMux)
+#define ZONE_UNLOCK() portEXIT_CRITICAL(&zoneMux)
+#else
+#include <chrono>
+#include <mutex>
+static std::mutex zoneMutex;
+#define ZONE_LOCK() zoneMutex.lock()
+#define ZONE_UNLOCK() zoneMutex.unlock()
+#endif
+
+static ProfileZone *zones[ProfileZone::MAX_ZONES];
+static int zoneCount = 0;
+
+ProfileZone::ProfileZone(const char *name)
+    : name(name)
+{
+    reset();
+    Profiler::registerZone(this);
+}
+
+void ProfileZone::record(uint32_t cycles)
+{
+    uint32_t us = cycles / Profiler::cyclesPerUs();
+    int bucket = 0;
+    while (us > 1 && bucket < BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    count++;
+    totalCycles += cycles;
+    if (cycles > maxCycles)
+        maxCycles = cycles;
+    histogram[bucket]++;
+}
+
+void ProfileZone::reset()
+{
+    count = 0;
+    totalCycles = 0;
+    maxCycles = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
+
+void Profiler::registerZone(ProfileZone *zone)
+{
+    // Zones register on the first pass through their scope; past the limit they still record but are not reported
+    ZONE_LOCK();
+    if (zoneCount < ProfileZone::MAX_ZONES)
+    {
+        zones[zoneCount++] = zone;
+    }
+    ZONE_UNLOCK();
+}
+
+bool Profiler::isEnabled()
+{
+#ifdef SMOKER_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+int Profiler::getZoneCount()
+{
+    return zoneCount;
+}
+
+ProfileZone *Profiler::getZone(int index)
+{
+    return (index >= 0 && index < zoneCount) ? zones[index] : nullptr;
+}
+
+void Profiler::reset()
+{
+    for (int i = 0; i < zoneCount; ++i)
+    {
+        zones[i]->reset();
+    }
+}
+
+uint32_t Profiler::now()
+{
+#ifdef ARDUINO
+    return ESP.getCycleCount();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+uint32_t Profiler::cyclesPerUs()
+{
+#ifdef ARDUINO
+    return ESP.getCpuFreqMHz();
+#else
+    return 1000;
+#endif
+}
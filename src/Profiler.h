@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Hot-path profiler. PROFILE_SCOPE("name") times the enclosing block with the
+// CPU cycle counter (std::chrono on host builds) and adds the duration to a
+// per-site log2 histogram: bucket k counts durations in [2^k, 2^(k+1)) us,
+// bucket 0 also takes everything below 1 us.
+//
+// Compiled in only when SMOKER_PROFILING is defined (see platformio.ini);
+// without it PROFILE_SCOPE expands to nothing and no zones exist.
+//
+// Each site is expected to run from one task at a time, so recording is a few
+// unsynchronized increments; a reset racing a record can lose that sample.
+
+class ProfileZone
+{
+public:
+    static const int BUCKETS = 24; // up to ~16 s
+    static const int MAX_ZONES = 24;
+
+    explicit ProfileZone(const char *name);
+
+    void record(uint32_t cycles);
+    void reset();
+
+    const char *name;
+    uint32_t count;
+    uint64_t totalCycles;
+    uint32_t maxCycles;
+    uint32_t histogram[BUCKETS];
+};
+
+class Profiler
+{
+public:
+    static bool isEnabled();
+    static int getZoneCount();
+    static ProfileZone *getZone(int index);
+    static void reset();
+
+    // Cycle counter and its rate, ESP32 CCOUNT on target, nanoseconds on the host
+    static uint32_t now();
+    static uint32_t cyclesPerUs();
+
+private:
+    friend class ProfileZone;
+    static void registerZone(ProfileZone *zone);
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileZone &zone) : zone(zone), start(Profiler::now()) {}
+    ~ProfileScope() { zone.record(Profiler::now() - start); }
+
+private:
+    ProfileZone &zone;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SMOKER_PROFILING
+#define PROFILE_SCOPE(zoneName)                                                   \
+    static ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(zoneName);          \
+    ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZone_, __LINE__))
+#else
+#define PROFILE_SCOPE(zoneName) \
+    do                          \
+    {                           \
+    } while (0)
+#endif
@@ -0,0 +1,154 @@
+#include "RelayDriver.h"
+#include <SPIFFS.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "SmokerControl.h"
+#include "TraceBuffer.h"
+
+static const char *RELAY_STATS_FILE = "/relayStats.json";
+static const char *RELAY_NAMES[RelayDriver::RelayCount] = {"auger", "fan", "igniter"};
+static const char *RELAY_EDGE_NAMES[RelayDriver::RelayCount][2] = {
+    {"auger off", "auger on"}, {"fan off", "fan on"}, {"igniter off", "igniter on"}};
+
+// Static member initialization
+RelayDriver::RelayState RelayDriver::relays[RelayDriver::RelayCount] = {};
+portMUX_TYPE RelayDriver::mux = portMUX_INITIALIZER_UNLOCKED;
+bool RelayDriver::dirty = false;
+unsigned long RelayDriver::lastPersistMs = 0;
+
+void RelayDriver::begin(int augerPin, int fanPin, int igniterPin)
+{
+    relays[Auger].pin = augerPin;
+    relays[Fan].pin = fanPin;
+    relays[Igniter].pin = igniterPin;
+
+    for (int i = 0; i < RelayCount; ++i)
+    {
+        pinMode(relays[i].pin, OUTPUT);
+        digitalWrite(relays[i].pin, Off);
+        relays[i].on = false;
+    }
+}
+
+void RelayDriver::write(Relay relay, bool on, int64_t nowUs)
+{
+    portENTER_CRITICAL(&mux);
+    RelayState &r = relays[relay];
+    if (r.on != on)
+    {
+        digitalWrite(r.pin, on ? On : Off);
+        TraceBuffer::instant(RELAY_EDGE_NAMES[relay][on ? 1 : 0]);
+        r.on = on;
+        r.stats.transitions++;
+
+        if (on)
+        {
+            r.onSinceUs = nowUs;
+        }
+        else
+        {
+            unsigned long onMs = (unsigned long)((nowUs - r.onSinceUs) / 1000);
+            r.stats.onTimeMs += onMs;
+            r.stats.energizedMinutes = (unsigned long)(r.stats.onTimeMs / 60000ULL);
+            if (onMs > r.stats.longestOnMs)
+                r.stats.longestOnMs = onMs;
+        }
+        dirty = true;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+// Counters including the period the relay is currently energized for
+RelayDriver::RelayStats RelayDriver::snapshot(Relay relay, int64_t nowUs)
+{
+    portENTER_CRITICAL(&mux);
+    RelayState r = relays[relay];
+    portEXIT_CRITICAL(&mux);
+
+    if (r.on)
+    {
+        unsigned long onMs = (unsigned long)((nowUs - r.onSinceUs) / 1000);
+        r.stats.onTimeMs += onMs;
+        r.stats.energizedMinutes = (unsigned long)(r.stats.onTimeMs / 60000ULL);
+        if (onMs > r.stats.longestOnMs)
+            r.stats.longestOnMs = onMs;
+    }
+    return r.stats;
+}
+
+RelayDriver::RelayStats RelayDriver::getStats(Relay relay)
+{
+    return snapshot(relay, esp_timer_get_time());
+}
+
+void RelayDriver::loadStats()
+{
+    if (!SPIFFS.exists(RELAY_STATS_FILE))
+        return;
+
+    File file = SPIFFS.open(RELAY_STATS_FILE, "r");
+    if (!file)
+    {
+        Serial.println("Failed to open relay stats file");
+        return;
+    }
+
+    StaticJsonDocument<512> doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error)
+    {
+        Serial.print("Relay stats file is corrupt: ");
+        Serial.println(error.c_str());
+        return;
+    }
+
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < RelayCount; ++i)
+    {
+        JsonObject saved = doc[RELAY_NAMES[i]];
+        relays[i].stats.transitions += saved["transitions"] | 0UL;
+        relays[i].stats.onTimeMs += saved["onTimeMs"] | 0ULL;
+        relays[i].stats.longestOnMs = max(relays[i].stats.longestOnMs, saved["longestOnMs"] | 0UL);
+        relays[i].stats.energizedMinutes = (unsigned long)(relays[i].stats.onTimeMs / 60000ULL);
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void RelayDriver::persistTask(bool force)
+{
+    unsigned long now = millis();
+    if (!dirty || (!force && (now - lastPersistMs) < PERSIST_INTERVAL_MS))
+        return;
+
+    // Clear the flag before reading the counters so an edge from the timer task
+    // while the file is written marks them dirty again instead of being lost
+    portENTER_CRITICAL(&mux);
+    dirty = false;
+    portEXIT_CRITICAL(&mux);
+
+    StaticJsonDocument<512> doc;
+    int64_t nowUs = esp_timer_get_time();
+    for (int i = 0; i < RelayCount; ++i)
+    {
+        RelayStats stats = snapshot(static_cast<Relay>(i), nowUs);
+        JsonObject saved = doc[RELAY_NAMES[i]].to<JsonObject>();
+        saved["transitions"] = stats.transitions;
+        saved["onTimeMs"] = stats.onTimeMs;
+        saved["longestOnMs"] = stats.longestOnMs;
+    }
+
+    File file = SPIFFS.open(RELAY_STATS_FILE, "w");
+    if (!file)
+    {
+        Serial.println("Failed to open relay stats file for writing");
+        portENTER_CRITICAL(&mux);
+        dirty = true;
+        portEXIT_CRITICAL(&mux);
+        return;
+    }
+    serializeJson(doc, file);
+    file.close();
+
+    lastPersistMs = now;
+}
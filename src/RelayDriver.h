@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Lowest layer of the relay outputs. Caches each pin's state so the GPIO is
+// only written on a transition and keeps wear counters per relay. The
+// counters are saved to SPIFFS by persistTask() so they survive reboots.
+class RelayDriver
+{
+public:
+    enum Relay
+    {
+        Auger = 0,
+        Fan = 1,
+        Igniter = 2,
+        RelayCount = 3
+    };
+
+    struct RelayStats
+    {
+        unsigned long transitions;     // off->on and on->off edges
+        unsigned long long onTimeMs;   // cumulative energized time
+        unsigned long longestOnMs;     // longest single energized period
+        unsigned long energizedMinutes; // onTimeMs in whole minutes (igniter element life)
+    };
+
+    // Configure the pins and drive every relay off
+    static void begin(int augerPin, int fanPin, int igniterPin);
+
+    // Restore the counters saved by persistTask() (SPIFFS must be mounted)
+    static void loadStats();
+
+    // Set the relay; only touches the GPIO when the state changes. Safe from the timer task.
+    static void write(Relay relay, bool on, int64_t nowUs);
+
+    static RelayStats getStats(Relay relay);
+
+    // Save the counters if they changed and the save interval elapsed (call from loop())
+    static void persistTask(bool force = false);
+
+    static const unsigned long PERSIST_INTERVAL_MS = 10UL * 60UL * 1000UL;
+
+private:
+    struct RelayState
+    {
+        int pin;
+        bool on;
+        int64_t onSinceUs;
+        RelayStats stats;
+    };
+
+    static RelayState relays[RelayCount];
+    static portMUX_TYPE mux;
+    static bool dirty;
+    static unsigned long lastPersistMs;
+
+    static RelayStats snapshot(Relay relay, int64_t nowUs);
+};
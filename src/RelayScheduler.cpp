@@ -0,0 +1,158 @@
+#include "RelayScheduler.h"
+#include "SmokerControl.h"
+#include "RelayDriver.h"
+#include "TraceBuffer.h"
+
+// Shortest cycle accepted, anything below is treated as plain on/off
+static const int64_t MIN_PERIOD_US = 100000;
+
+RelayScheduler::RelayScheduler()
+    : timer(nullptr)
+{
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        channels[i] = {};
+        channels[i].pin = -1;
+        channels[i].commandPeriodUs = MIN_PERIOD_US;
+    }
+}
+
+void RelayScheduler::begin(int augerPin, int fanPin, int igniterPin)
+{
+    channels[Auger].pin = augerPin;
+    channels[Fan].pin = fanPin;
+    channels[Igniter].pin = igniterPin;
+    RelayDriver::begin(augerPin, fanPin, igniterPin);
+
+    esp_timer_create_args_t args = {};
+    args.callback = &RelayScheduler::timerCallback;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "relays";
+    esp_timer_create(&args, &timer);
+    esp_timer_start_periodic(timer, TICK_US);
+}
+
+void RelayScheduler::setDuty(Channel channel, float percent, float periodSeconds)
+{
+    percent = constrain(percent, 0.0f, 100.0f);
+    int64_t periodUs = (int64_t)(periodSeconds * 1000000.0f);
+    if (periodUs < MIN_PERIOD_US)
+        periodUs = MIN_PERIOD_US;
+    int64_t onUs = (int64_t)(periodUs * (percent / 100.0f));
+
+    portENTER_CRITICAL(&mux);
+    channels[channel].commandPeriodUs = periodUs;
+    channels[channel].commandOnUs = onUs;
+    portEXIT_CRITICAL(&mux);
+}
+
+void RelayScheduler::setOn(Channel channel, bool on)
+{
+    setDuty(channel, on ? 100.0f : 0.0f, MIN_PERIOD_US / 1000000.0f);
+}
+
+RelayScheduler::CycleStats RelayScheduler::getStats(Channel channel) const
+{
+    portENTER_CRITICAL(&mux);
+    CycleStats stats = channels[channel].stats;
+    portEXIT_CRITICAL(&mux);
+    return stats;
+}
+
+void RelayScheduler::resetStats()
+{
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        channels[i].stats = {};
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void RelayScheduler::timerCallback(void *arg)
+{
+    static_cast<RelayScheduler *>(arg)->tick(esp_timer_get_time());
+}
+
+void RelayScheduler::tick(int64_t nowUs)
+{
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        if (channels[i].pin >= 0)
+            tickChannel(static_cast<Channel>(i), nowUs);
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void RelayScheduler::tickChannel(Channel channel, int64_t nowUs)
+{
+    ChannelState &ch = channels[channel];
+
+    // An idle output that gets a non-zero command starts its cycle now instead
+    // of waiting out the rest of the current (empty) period
+    bool idleWakeup = ch.running && !ch.pinOn && ch.onUs == 0 && ch.commandOnUs > 0;
+
+    if (!ch.running || idleWakeup || nowUs - ch.cycleStartUs >= ch.periodUs)
+    {
+        if (ch.running)
+        {
+            if (ch.pinOn)
+            {
+                ch.achievedUs += nowUs - ch.edgeUs;
+                ch.edgeUs = nowUs;
+            }
+
+            long error = (long)(ch.achievedUs - ch.onUs);
+            ch.stats.commandedOnUs = (unsigned long)ch.onUs;
+            ch.stats.achievedOnUs = (unsigned long)ch.achievedUs;
+            ch.stats.lastErrorUs = error;
+            if ((unsigned long)labs(error) > ch.stats.maxErrorUs)
+                ch.stats.maxErrorUs = (unsigned long)labs(error);
+            ch.stats.cycles++;
+            TraceBuffer::checkRelayError(error);
+
+            // Next cycle starts on the absolute schedule unless we fell a whole period behind
+            ch.cycleStartUs += ch.periodUs;
+            if (idleWakeup || nowUs - ch.cycleStartUs >= ch.periodUs)
+                ch.cycleStartUs = nowUs;
+        }
+        else
+        {
+            ch.cycleStartUs = nowUs;
+            ch.running = true;
+        }
+
+        ch.periodUs = ch.commandPeriodUs;
+        ch.onUs = min(ch.commandOnUs, ch.periodUs);
+        ch.achievedUs = 0;
+    }
+    else if (ch.pinOn)
+    {
+        // Duty changes take effect on the running pulse, never re-energize after the off edge
+        ch.onUs = min(ch.commandOnUs, ch.periodUs);
+    }
+
+    bool wantOn = (nowUs - ch.cycleStartUs) < ch.onUs;
+    if (wantOn != ch.pinOn)
+    {
+        writePin(channel, wantOn, nowUs);
+    }
+}
+
+void RelayScheduler::writePin(Channel channel, bool on, int64_t nowUs)
+{
+    ChannelState &ch = channels[channel];
+    // Scheduler channels and driver relays share the same order
+    RelayDriver::write(static_cast<RelayDriver::Relay>(channel), on, nowUs);
+    if (on)
+    {
+        ch.edgeUs = nowUs;
+    }
+    else
+    {
+        ch.achievedUs += nowUs - ch.edgeUs;
+    }
+    ch.pinOn = on;
+}
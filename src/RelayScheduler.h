@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Time-proportioning relay outputs driven from a 1 ms esp_timer instead of
+// loop(). The scheduler owns the auger, fan and igniter pins; foreground code
+// only posts duty/period commands with setDuty()/setOn(), which never block.
+// Cycles run on absolute start times so a slow loop() cannot stretch a pulse.
+class RelayScheduler
+{
+public:
+    enum Channel
+    {
+        Auger = 0,
+        Fan = 1,
+        Igniter = 2,
+        ChannelCount = 3
+    };
+
+    // Commanded vs achieved on-time of the last completed cycle
+    struct CycleStats
+    {
+        unsigned long commandedOnUs;
+        unsigned long achievedOnUs;
+        long lastErrorUs;         // achieved - commanded
+        unsigned long maxErrorUs; // largest |error| since the last reset
+        unsigned long cycles;
+    };
+
+    static const unsigned long TICK_US = 1000;
+
+    RelayScheduler();
+
+    // Configure the pins and start the timer
+    void begin(int augerPin, int fanPin, int igniterPin);
+
+    // Time-proportioning command, percent 0-100 of periodSeconds
+    void setDuty(Channel channel, float percent, float periodSeconds);
+
+    // Plain on/off output (used for the igniter)
+    void setOn(Channel channel, bool on);
+
+    CycleStats getStats(Channel channel) const;
+    void resetStats();
+
+    // Advance all channels to nowUs; called by the timer, public so it can be driven by a simulated clock
+    void tick(int64_t nowUs);
+
+private:
+    struct ChannelState
+    {
+        int pin;
+        // latest command (written by setDuty, read by tick)
+        int64_t commandPeriodUs;
+        int64_t commandOnUs;
+        // active cycle
+        bool running;
+        int64_t cycleStartUs;
+        int64_t periodUs;
+        int64_t onUs;
+        bool pinOn;
+        int64_t edgeUs;     // time of the last rising edge
+        int64_t achievedUs; // time spent on in this cycle
+        CycleStats stats;
+    };
+
+    ChannelState channels[ChannelCount];
+    esp_timer_handle_t timer;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    void tickChannel(Channel channel, int64_t nowUs);
+    void writePin(Channel channel, bool on, int64_t nowUs);
+    static void timerCallback(void *arg);
+};
+
+extern RelayScheduler relayScheduler;
@@ -0,0 +1,80 @@
+#include "SensorAcquisition.h"
+#include "TraceBuffer.h"
+
+SensorAcquisition::SensorAcquisition()
+    : spi(VSPI)
+{
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        sensors[i] = nullptr;
+        samples[i] = {.temperatureF = 0.0f, .raw = 0, .openCircuit = false, .timestampMs = 0, .sequence = 0};
+        nextReadMs[i] = 0;
+    }
+}
+
+void SensorAcquisition::begin(int8_t sclk, int8_t miso, int8_t firePotCs, int8_t smokeChamberCs)
+{
+    // MISO only, the MAX6675 has no data input
+    spi.begin(sclk, miso, -1, -1);
+
+    sensors[FirePot] = new MAX6675(&spi, firePotCs);
+    sensors[SmokeChamber] = new MAX6675(&spi, smokeChamberCs);
+
+    // Stagger the channels by half a conversion so one task() call never has to read both
+    unsigned long now = millis();
+    nextReadMs[FirePot] = now + MAX6675::CONVERSION_TIME_MS;
+    nextReadMs[SmokeChamber] = now + MAX6675::CONVERSION_TIME_MS + MAX6675::CONVERSION_TIME_MS / 2;
+}
+
+void SensorAcquisition::prime()
+{
+    // Chip selects were just released in begin(), give the first conversion time to finish
+    delay(MAX6675::CONVERSION_TIME_MS);
+
+    unsigned long now = millis();
+    readChannel(FirePot, now);
+    readChannel(SmokeChamber, now + MAX6675::CONVERSION_TIME_MS / 2);
+}
+
+void SensorAcquisition::task()
+{
+    unsigned long now = millis();
+
+    for (int i = 0; i < ChannelCount; ++i)
+    {
+        if (sensors[i] && (long)(now - nextReadMs[i]) >= 0)
+        {
+            readChannel(static_cast<Channel>(i), now);
+            return; // one transfer per call
+        }
+    }
+}
+
+void SensorAcquisition::readChannel(Channel channel, unsigned long now)
+{
+    TRACE_SCOPE(channel == FirePot ? "read fire pot" : "read smoke chamber");
+    uint16_t raw = sensors[channel]->readRaw();
+
+    ThermocoupleSample sample;
+    sample.raw = raw;
+    sample.openCircuit = MAX6675::isOpen(raw);
+    // Open thermocouple reads as 0C, same as MAX6675::readFahrenheit()
+    sample.temperatureF = sample.openCircuit ? 32.0f : MAX6675::rawToCelsius(raw) * 9.0f / 5.0f + 32.0f;
+    sample.timestampMs = millis();
+
+    portENTER_CRITICAL(&sampleMux);
+    sample.sequence = samples[channel].sequence + 1;
+    samples[channel] = sample;
+    portEXIT_CRITICAL(&sampleMux);
+
+    // Reading restarted the conversion; next result is valid one conversion time from now
+    nextReadMs[channel] = now + MAX6675::CONVERSION_TIME_MS;
+}
+
+ThermocoupleSample SensorAcquisition::getSample(Channel channel) const
+{
+    portENTER_CRITICAL(&sampleMux);
+    ThermocoupleSample sample = samples[channel];
+    portEXIT_CRITICAL(&sampleMux);
+    return sample;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "max6675.h"
+
+// One published thermocouple reading
+struct ThermocoupleSample
+{
+    float temperatureF;        // Converted temperature (32F when openCircuit)
+    uint16_t raw;              // Raw MAX6675 register
+    bool openCircuit;          // Fault bit reported by the chip
+    unsigned long timestampMs; // millis() when the reading was taken
+    uint32_t sequence;         // Increments on every new reading, 0 = no reading yet
+};
+
+// Reads both MAX6675 thermocouples over the hardware SPI peripheral.
+// The sensors share SCK/MISO and have separate chip selects. task() performs
+// at most one 16 bit transfer per call (a few microseconds) and only once the
+// chip's conversion time has elapsed, so it is safe to call from every loop().
+// Consumers read the latest sample with getSample() which never blocks.
+class SensorAcquisition
+{
+public:
+    enum Channel
+    {
+        FirePot = 0,
+        SmokeChamber = 1,
+        ChannelCount = 2
+    };
+
+    SensorAcquisition();
+
+    // Start the SPI bus and register the chip select for each channel
+    void begin(int8_t sclk, int8_t miso, int8_t firePotCs, int8_t smokeChamberCs);
+
+    // Read every channel immediately (waits for one conversion), used at startup
+    void prime();
+
+    // Service the bus; reads whichever channel is due, if any
+    void task();
+
+    // Latest published sample for a channel
+    ThermocoupleSample getSample(Channel channel) const;
+
+private:
+    SPIClass spi;
+    MAX6675 *sensors[ChannelCount];
+    ThermocoupleSample samples[ChannelCount];
+    unsigned long nextReadMs[ChannelCount];
+    mutable portMUX_TYPE sampleMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void readChannel(Channel channel, unsigned long now);
+};
+
+extern SensorAcquisition sensorAcquisition;
@@ -0,0 +1,99 @@
+#include "SensorHealth.h"
+
+SensorHealth::SensorHealth(const SensorHealthConfig &config)
+    : config(config),
+      state(State::NoData),
+      lastGoodValue(0.0f),
+      lastGoodMs(0),
+      lastSequence(0),
+      consecutiveRejects(0)
+{
+}
+
+void SensorHealth::update(const ThermocoupleSample &sample, unsigned long now)
+{
+    if (sample.sequence != 0 && sample.sequence != lastSequence)
+    {
+        lastSequence = sample.sequence;
+
+        if (sample.openCircuit)
+        {
+            // The chip is certain about this one, no point holding
+            openCircuitCount++;
+            consecutiveRejects = 0;
+            state = State::Faulted;
+            return;
+        }
+
+        if (sample.temperatureF < config.minValidTemp || sample.temperatureF > config.maxValidTemp)
+        {
+            rangeRejectCount++;
+            reject();
+        }
+        else if (state == State::NoData || state == State::Faulted || state == State::Stale)
+        {
+            // Nothing trustworthy to compare against, start over from this sample
+            accept(sample.temperatureF, sample.timestampMs);
+        }
+        else
+        {
+            float dtSeconds = (sample.timestampMs - lastGoodMs) / 1000.0f;
+            float maxChange = config.maxRateOfChange * max(dtSeconds, 0.001f);
+
+            if (fabsf(sample.temperatureF - lastGoodValue) <= maxChange ||
+                consecutiveRejects + 1 >= config.maxConsecutiveRejects)
+            {
+                // A real step shows up in consecutive samples, a spike does not
+                accept(sample.temperatureF, sample.timestampMs);
+            }
+            else
+            {
+                rateRejectCount++;
+                reject();
+            }
+        }
+    }
+
+    // Covers both rejected samples and the acquisition not producing any
+    if (isValid() && (now - lastGoodMs) >= config.holdTimeoutMs)
+    {
+        staleCount++;
+        state = State::Stale;
+    }
+}
+
+void SensorHealth::accept(float value, unsigned long timestampMs)
+{
+    lastGoodValue = value;
+    lastGoodMs = timestampMs;
+    consecutiveRejects = 0;
+    state = State::Ok;
+}
+
+void SensorHealth::reject()
+{
+    consecutiveRejects++;
+    if (state == State::Ok)
+    {
+        state = State::Holding;
+    }
+}
+
+const char *SensorHealth::GetStateName(State state)
+{
+    switch (state)
+    {
+    case State::NoData:
+        return "No Data";
+    case State::Ok:
+        return "OK";
+    case State::Holding:
+        return "Holding";
+    case State::Faulted:
+        return "Open Thermocouple";
+    case State::Stale:
+        return "Stale";
+    default:
+        return "Unknown";
+    }
+}
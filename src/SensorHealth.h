@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include "SensorAcquisition.h"
+
+// Plausibility limits for one thermocouple channel
+struct SensorHealthConfig
+{
+    float minValidTemp;             // Readings below this are rejected (F)
+    float maxValidTemp;             // Readings above this are rejected (F)
+    float maxRateOfChange;          // Largest believable change (F per second)
+    int maxConsecutiveRejects;      // Accept a rate outlier once it repeats this many times
+    unsigned long holdTimeoutMs;    // How long the last good value may be held before going stale
+};
+
+// Validates the samples of one thermocouple channel and holds the last good
+// value across rejected or missing samples. Open thermocouples invalidate the
+// channel on the first sample; out of range and rate outliers are held until
+// holdTimeoutMs passes without an accepted sample.
+class SensorHealth
+{
+public:
+    enum class State
+    {
+        NoData = 0,  // Nothing accepted yet
+        Ok = 1,      // Latest sample accepted
+        Holding = 2, // Latest sample rejected, last good value held
+        Faulted = 3, // Chip reports open thermocouple
+        Stale = 4    // No accepted sample within holdTimeoutMs
+    };
+
+    explicit SensorHealth(const SensorHealthConfig &config);
+
+    // Process the latest sample (ignored if it was already seen) and update staleness
+    void update(const ThermocoupleSample &sample, unsigned long now);
+
+    // Last accepted temperature (F)
+    float value() const { return lastGoodValue; }
+
+    // True while the held value can be used for control
+    bool isValid() const { return state == State::Ok || state == State::Holding; }
+
+    State getState() const { return state; }
+    static const char *GetStateName(State state);
+
+    unsigned long openCircuitCount = 0;
+    unsigned long rangeRejectCount = 0;
+    unsigned long rateRejectCount = 0;
+    unsigned long staleCount = 0;
+
+private:
+    SensorHealthConfig config;
+    State state;
+    float lastGoodValue;
+    unsigned long lastGoodMs;
+    uint32_t lastSequence;
+    int consecutiveRejects;
+
+    void accept(float value, unsigned long timestampMs);
+    void reject();
+};
+
+extern SensorHealth firePotHealth;
+extern SensorHealth smokeChamberHealth;
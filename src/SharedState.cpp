@@ -0,0 +1,28 @@
+#include "SharedState.h"
+
+SemaphoreHandle_t SharedStateLock::mutex = nullptr;
+
+void SharedStateLock::begin()
+{
+    // A mutex rather than a spinlock: priority inheritance lifts a comms task holding it above other work
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+}
+
+SharedStateLock::SharedStateLock()
+{
+    if (mutex)
+    {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+}
+
+SharedStateLock::~SharedStateLock()
+{
+    if (mutex)
+    {
+        xSemaphoreGive(mutex);
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Hand-off between the control task and the comms task (web, AC2, logging).
+// smokerData, smokerConfig, uiData and the control modules they drive are only
+// read or written while a SharedStateLock is alive. Hold it for short updates
+// or copies, never across network or file I/O that can block the control task.
+class SharedStateLock
+{
+public:
+    SharedStateLock();
+    ~SharedStateLock();
+
+    // Create the mutex; call once before either task starts
+    static void begin();
+
+private:
+    static SemaphoreHandle_t mutex;
+};
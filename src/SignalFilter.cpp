@@ -0,0 +1,137 @@
+#include "SignalFilter.h"
+
+FilterChain::FilterChain()
+    : params{.medianLength = 1, .emaAlpha = 1.0f, .lowpassCutoffHz = 0.0f, .slewRateLimit = 0.0f},
+      samplePeriodS(0.5f),
+      initialized(false),
+      windowIndex(0),
+      medianLength(1),
+      emaState(0.0f),
+      lowpassEnabled(false),
+      b0(1.0f), b1(0.0f), b2(0.0f), a1(0.0f), a2(0.0f),
+      z1(0.0f), z2(0.0f),
+      slewState(0.0f)
+{
+    for (int i = 0; i < MAX_MEDIAN_LENGTH; ++i)
+        window[i] = 0.0f;
+}
+
+void FilterChain::configure(const SmokerConfig::FilterParams &newParams, float newSamplePeriodS)
+{
+    params = newParams;
+    samplePeriodS = newSamplePeriodS;
+
+    // Odd lengths only so the median is an actual sample
+    medianLength = constrain(params.medianLength, 1, MAX_MEDIAN_LENGTH);
+    if ((medianLength & 1) == 0)
+        medianLength--;
+
+    params.emaAlpha = constrain(params.emaAlpha, 0.01f, 1.0f);
+
+    // RBJ cookbook low-pass, Q = 1/sqrt(2); cutoff must stay below Nyquist
+    float sampleRateHz = 1.0f / samplePeriodS;
+    lowpassEnabled = params.lowpassCutoffHz > 0.0f;
+    if (lowpassEnabled)
+    {
+        float cutoff = min(params.lowpassCutoffHz, 0.45f * sampleRateHz);
+        float w0 = 2.0f * PI * cutoff / sampleRateHz;
+        float cosw0 = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * 0.70710678f);
+        float a0 = 1.0f + alpha;
+
+        b0 = ((1.0f - cosw0) * 0.5f) / a0;
+        b1 = (1.0f - cosw0) / a0;
+        b2 = b0;
+        a1 = (-2.0f * cosw0) / a0;
+        a2 = (1.0f - alpha) / a0;
+    }
+
+    // Restart from the current output so a config change does not kick the control loop
+    if (initialized)
+        reset(slewState);
+}
+
+void FilterChain::saveParams(JsonObject obj, const SmokerConfig::FilterParams &params)
+{
+    obj["medianLength"] = params.medianLength;
+    obj["emaAlpha"] = params.emaAlpha;
+    obj["lowpassCutoffHz"] = params.lowpassCutoffHz;
+    obj["slewRateLimit"] = params.slewRateLimit;
+}
+
+void FilterChain::loadParams(JsonObject obj, SmokerConfig::FilterParams &params)
+{
+    params.medianLength = obj["medianLength"] | params.medianLength;
+    params.emaAlpha = obj["emaAlpha"] | params.emaAlpha;
+    params.lowpassCutoffHz = obj["lowpassCutoffHz"] | params.lowpassCutoffHz;
+    params.slewRateLimit = obj["slewRateLimit"] | params.slewRateLimit;
+}
+
+float FilterChain::reset(float value)
+{
+    for (int i = 0; i < MAX_MEDIAN_LENGTH; ++i)
+        window[i] = value;
+    windowIndex = 0;
+    emaState = value;
+    // Steady state of the transposed direct form for a constant input
+    z1 = value * (1.0f - b0);
+    z2 = value * (b2 - a2);
+    slewState = value;
+    initialized = true;
+    return value;
+}
+
+float FilterChain::update(float value)
+{
+    if (!initialized)
+        return reset(value);
+
+    float y = median(value);
+
+    emaState += params.emaAlpha * (y - emaState);
+    y = emaState;
+
+    if (lowpassEnabled)
+        y = lowpass(y);
+
+    if (params.slewRateLimit > 0.0f)
+    {
+        float maxStep = params.slewRateLimit * samplePeriodS;
+        y = slewState + constrain(y - slewState, -maxStep, maxStep);
+    }
+    slewState = y;
+
+    return y;
+}
+
+float FilterChain::median(float value)
+{
+    window[windowIndex] = value;
+    windowIndex = (windowIndex + 1) % medianLength;
+
+    if (medianLength == 1)
+        return value;
+
+    // Insertion sort of at most 5 values
+    float sorted[MAX_MEDIAN_LENGTH];
+    for (int i = 0; i < medianLength; ++i)
+    {
+        float v = window[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[medianLength / 2];
+}
+
+float FilterChain::lowpass(float value)
+{
+    float y = b0 * value + z1;
+    z1 = b1 * value - a1 * y + z2;
+    z2 = b2 * value - a2 * y;
+    return y;
+}
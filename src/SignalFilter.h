@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "SmokerControl.h"
+
+// Per-sensor conditioning: median-of-N -> EMA -> biquad low-pass -> slew limiter.
+// Every stage can be disabled from FilterParams and costs a fixed amount of
+// single-precision work per sample.
+class FilterChain
+{
+public:
+    static const int MAX_MEDIAN_LENGTH = 5;
+
+    FilterChain();
+
+    // Apply new parameters; samplePeriodS is the fixed rate update() is called at
+    void configure(const SmokerConfig::FilterParams &params, float samplePeriodS);
+
+    // Preload every stage so the output starts at value without a transient
+    float reset(float value);
+
+    // Filter one sample and return the conditioned value
+    float update(float value);
+
+    // FilterParams as stored in the config file and served by /api/tunable
+    static void saveParams(JsonObject obj, const SmokerConfig::FilterParams &params);
+    // Missing keys keep whatever is already in params
+    static void loadParams(JsonObject obj, SmokerConfig::FilterParams &params);
+
+private:
+    SmokerConfig::FilterParams params;
+    float samplePeriodS;
+    bool initialized;
+
+    // median
+    float window[MAX_MEDIAN_LENGTH];
+    int windowIndex;
+    int medianLength;
+
+    // EMA
+    float emaState;
+
+    // biquad (direct form II transposed)
+    bool lowpassEnabled;
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+
+    // slew limiter
+    float slewState;
+
+    float median(float value);
+    float lowpass(float value);
+};
+
+extern FilterChain smokeChamberFilter;
+extern FilterChain firePotFilter;
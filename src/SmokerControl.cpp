@@ -4,23 +4,50 @@
 #include "AC2.h"
 #include <WiFiClient.h>
 #include <SPI.h>
-#include "max6675.h"
+#include "SensorAcquisition.h"
+#include "SensorHealth.h"
+#include "SignalFilter.h"
+#include "TransferFunction.h"
+#include "RelayScheduler.h"
+#include "RelayDriver.h"
+#include "PelletFeed.h"
+#include "Autotuner.h"
+#include "FlameoutDetector.h"
 #include "SmokerControl.h"
 #include "SmokerOutputs.h"
 #include "SmokerStateMachine.h"
 #include "WebInterface.h"
 #include "DataLogger.h"
-
-unsigned long lastTime;
-unsigned long timeNow;
+#include "SharedState.h"
+#include "TaskScheduler.h"
+#include "Profiler.h"
+#include "TraceBuffer.h"
+#include "Telemetry.h"
 
 #define task500ms 500
 
+// Control runs on the application core from the task table, networking/logging on the protocol core
+#define sensorPeriodMs 50
+#define outputPeriodMs 50
+#define controlTaskCore 1
+#define controlTaskPriority 10
+#define commsTaskCore 0
+#define commsTaskPriority 1
+#define loggerTaskCore 0
+#define loggerTaskPriority tskIDLE_PRIORITY // below comms: flash stalls only use time nothing else wants
+TaskHandle_t controlTaskHandle = nullptr;
+TaskHandle_t commsTaskHandle = nullptr;
+TaskHandle_t loggerTaskHandle = nullptr;
+
 const char *CONFIG_FILE = "/smokerConfig.json";
 
 SmokerData smokerData = {
 	.filteredSmokeChamberTemp = 0.0f,
 	.filteredFirePotTemp = 0.0f,
+	.smokeChamberSensorValid = false,
+	.firePotSensorValid = false,
+	.flameoutConfidence = 0.0f,
+	.reigniteAttempts = 0,
 	.igniter = {.mode = IgniterControl::Mode::Off},
 	.auger = {.mode = AugerControl::Mode::Off, .dutyCycle = 0.0f, .frequency = 0.0f, .Mass = 0.0f},
 	.fan = {.mode = FanControl::Mode::Off, .dutyCycle = 0.0f, .frequency = 0.0f}};
@@ -63,7 +90,14 @@ SmokerConfig smokerConfig = {
 					{60.0f, 80.0f}, // 20% duty = 80% smoke
 					{55.0f, 90.0f}, // 10% duty = 90% smoke
 					{50.0f, 100.0f} // 0% duty = 100% smoke
-				}},
+				},
+		.augerKp = 2.0f,
+		.augerKi = 0.01f,
+		.augerKd = 0.0f,
+		.augerGramsPerSecond = 2.0f,
+		.smokeChamberFilter = {.medianLength = 1, .emaAlpha = 0.5f, .lowpassCutoffHz = 0.0f, .slewRateLimit = 0.0f},
+		.firePotFilter = {.medianLength = 1, .emaAlpha = 0.5f, .lowpassCutoffHz = 0.0f, .slewRateLimit = 0.0f},
+		.flameout = {.enabled = true, .slopeThreshold = 0.5f, .minFeedGrams = 2.0f, .confidence = 0.8f, .maxReigniteAttempts = 1}},
 	.recipe = {.recipeStepIndex = 0, .selectedRecipeIndex = -1},
 	.logging = {
 		.enabled = true,
@@ -75,24 +109,38 @@ UserInputs uiData = {
 	.btn_Startup = false,
 	.btn_Auto = false,
 	.btn_Shutdown = false,
-	.btn_Manual = false};
+	.btn_Manual = false,
+	.btn_Autotune = false};
 
+// Both thermocouples share the hardware SPI clock/data lines
 int thermoDO = 21;
 int thermoCLK = 19;
-int thermoCS = 5;
-MAX6675 firepotthermocouple(thermoCLK, thermoCS, thermoDO);
+int thermoCS = 5;  // fire pot
+int thermoCS2 = 4; // smoke chamber
+SensorAcquisition sensorAcquisition;
 static float firepotTemperature = 0;
-
-int thermoDO2 = 18;
-int thermoCLK2 = 17;
-int thermoCS2 = 4;
-MAX6675 smokechamberthermocouple(thermoCLK2, thermoCS2, thermoDO2);
 static float smokechamberTemperature = 0;
 
+// MAX6675 cannot report below 0C; the fire pot runs far hotter than the chamber
+SensorHealth firePotHealth({.minValidTemp = 32.0f,
+							.maxValidTemp = 1500.0f,
+							.maxRateOfChange = 100.0f,
+							.maxConsecutiveRejects = 3,
+							.holdTimeoutMs = 5000UL});
+SensorHealth smokeChamberHealth({.minValidTemp = 32.0f,
+								 .maxValidTemp = 700.0f,
+								 .maxRateOfChange = 20.0f,
+								 .maxConsecutiveRejects = 3,
+								 .holdTimeoutMs = 5000UL});
+
+FilterChain smokeChamberFilter;
+FilterChain firePotFilter;
+
 int augerPin = 32;	 // Relay 1
 int fanPin = 33;	 // Relay 2
 int igniterPin = 25; // Relay 3
 int sparePin = 26;	 // Relay 4
+RelayScheduler relayScheduler;
 
 constexpr auto ControllerName = "PelletSmoker32";
 char ssid[] = "Bulldog";
@@ -100,8 +148,15 @@ char pass[] = "6412108682";
 char APssid[] = "DBBSmoker";
 
 SmokerStateMachine smokerStateMachine;
+TaskScheduler controlScheduler;
+Autotuner autotuner;
+FlameoutDetector flameoutDetector;
 
+#ifdef SMOKER_ASYNC_WEB
+WebInterface webInterface(80);
+#else
 WebInterface webInterface(AC2.webserver);
+#endif
 
 // Initialize recipe defaults (clears names, disables steps/recipes)
 static void initRecipeDefaults()
@@ -161,6 +216,23 @@ bool SaveConfigToSPIFFS(const SmokerConfig &config)
 	doc["tunable"]["augerFrequency_Auto"] = config.tunable.augerFrequency;
 	doc["tunable"]["fanfrequency_Auto"] = config.tunable.fanFrequency;
 
+	// Save auger PID gains
+	doc["tunable"]["augerKp"] = config.tunable.augerKp;
+	doc["tunable"]["augerKi"] = config.tunable.augerKi;
+	doc["tunable"]["augerKd"] = config.tunable.augerKd;
+	doc["tunable"]["augerGramsPerSecond"] = config.tunable.augerGramsPerSecond;
+
+	// Save sensor filter settings
+	FilterChain::saveParams(doc["tunable"]["smokeChamberFilter"].to<JsonObject>(), config.tunable.smokeChamberFilter);
+	FilterChain::saveParams(doc["tunable"]["firePotFilter"].to<JsonObject>(), config.tunable.firePotFilter);
+
+	// Save flameout detection settings
+	doc["tunable"]["flameout"]["enabled"] = config.tunable.flameout.enabled;
+	doc["tunable"]["flameout"]["slopeThreshold"] = config.tunable.flameout.slopeThreshold;
+	doc["tunable"]["flameout"]["minFeedGrams"] = config.tunable.flameout.minFeedGrams;
+	doc["tunable"]["flameout"]["confidence"] = config.tunable.flameout.confidence;
+	doc["tunable"]["flameout"]["maxReigniteAttempts"] = config.tunable.flameout.maxReigniteAttempts;
+
 	doc["recipe"]["recipeStepIndex"] = config.recipe.recipeStepIndex;
 	doc["recipe"]["selectedRecipeIndex"] = config.recipe.selectedRecipeIndex;
 
@@ -192,6 +264,8 @@ bool SaveConfigToSPIFFS(const SmokerConfig &config)
 	doc["logging"]["logIntervalMs"] = config.logging.logIntervalMs;
 	doc["logging"]["maxLogFiles"] = config.logging.maxLogFiles;
 	doc["logging"]["maxLogFileSizeBytes"] = config.logging.maxLogFileSizeBytes;
+	doc["logging"]["flushRecords"] = config.logging.flushRecords;
+	doc["logging"]["flushIntervalMs"] = config.logging.flushIntervalMs;
 
 	File file = SPIFFS.open(CONFIG_FILE, "w");
 	if (!file)
@@ -287,6 +361,25 @@ bool LoadConfigFromSPIFFS(SmokerConfig &config)
 		}
 	}
 
+	// Load auger PID gains (older configs keep the compiled-in defaults)
+	config.tunable.augerKp = doc["tunable"]["augerKp"] | config.tunable.augerKp;
+	config.tunable.augerKi = doc["tunable"]["augerKi"] | config.tunable.augerKi;
+	config.tunable.augerKd = doc["tunable"]["augerKd"] | config.tunable.augerKd;
+	config.tunable.augerGramsPerSecond = doc["tunable"]["augerGramsPerSecond"] | config.tunable.augerGramsPerSecond;
+
+	// Load sensor filter settings (older configs keep the compiled-in defaults)
+	FilterChain::loadParams(doc["tunable"]["smokeChamberFilter"], config.tunable.smokeChamberFilter);
+	FilterChain::loadParams(doc["tunable"]["firePotFilter"], config.tunable.firePotFilter);
+
+	// Load flameout detection settings (older configs keep the compiled-in defaults)
+	config.tunable.flameout.enabled = doc["tunable"]["flameout"]["enabled"] | config.tunable.flameout.enabled;
+	config.tunable.flameout.slopeThreshold = doc["tunable"]["flameout"]["slopeThreshold"] | config.tunable.flameout.slopeThreshold;
+	config.tunable.flameout.minFeedGrams = doc["tunable"]["flameout"]["minFeedGrams"] | config.tunable.flameout.minFeedGrams;
+	config.tunable.flameout.confidence = doc["tunable"]["flameout"]["confidence"] | config.tunable.flameout.confidence;
+	config.tunable.flameout.maxReigniteAttempts = doc["tunable"]["flameout"]["maxReigniteAttempts"] | config.tunable.flameout.maxReigniteAttempts;
+
+	InvalidateTransferFunctions();
+
 	config.recipe.recipeStepIndex = doc["recipe"]["recipeStepIndex"];
 	config.recipe.selectedRecipeIndex = doc["recipe"]["selectedRecipeIndex"];
 
@@ -321,15 +414,184 @@ bool LoadConfigFromSPIFFS(SmokerConfig &config)
 	config.logging.logIntervalMs = doc["logging"]["logIntervalMs"] | 5000;
 	config.logging.maxLogFiles = doc["logging"]["maxLogFiles"] | 10;
 	config.logging.maxLogFileSizeBytes = doc["logging"]["maxLogFileSizeBytes"] | 100000;
+	config.logging.flushRecords = doc["logging"]["flushRecords"] | DEFAULT_LOG_CONFIG.flushRecords;
+	config.logging.flushIntervalMs = doc["logging"]["flushIntervalMs"] | DEFAULT_LOG_CONFIG.flushIntervalMs;
 
 	return true;
 }
 
+// Push the filter settings from smokerConfig into the running filters
+void ConfigureSensorFilters()
+{
+	smokeChamberFilter.configure(smokerConfig.tunable.smokeChamberFilter, task500ms / 1000.0f);
+	firePotFilter.configure(smokerConfig.tunable.firePotFilter, task500ms / 1000.0f);
+}
+
+// Control task table: rate-monotonic priorities (shorter period = higher priority).
+// Outputs are phased half a period after the sensors so a new duty from the
+// 500ms control step is applied within 25ms.
+static void sensorTask(unsigned long dtMs)
+{
+	PROFILE_SCOPE("control.sensors");
+	sensorAcquisition.task();
+}
+
+static TelemetrySnapshot::SensorStatus sensorStatus(const SensorHealth &health)
+{
+	return {.state = health.getState(),
+			.valid = health.isValid(),
+			.openCircuitCount = health.openCircuitCount,
+			.rangeRejectCount = health.rangeRejectCount,
+			.rateRejectCount = health.rateRejectCount,
+			.staleCount = health.staleCount};
+}
+
+// Copy this tick's values for the web, logger and network consumers (caller holds the shared-state lock)
+static void publishTelemetry()
+{
+	TelemetrySnapshot snapshot = {};
+	snapshot.timestampMs = millis();
+	snapshot.smokeChamberTemp = smokerData.filteredSmokeChamberTemp;
+	snapshot.firePotTemp = smokerData.filteredFirePotTemp;
+	snapshot.smokeChamberSensor = sensorStatus(smokeChamberHealth);
+	snapshot.firePotSensor = sensorStatus(firePotHealth);
+	snapshot.setpoint = smokerConfig.operating.setpoint;
+	snapshot.smokesetpoint = smokerConfig.operating.smokesetpoint;
+	memcpy(snapshot.activeState, smokerConfig.operating.activeState, sizeof(snapshot.activeState));
+	snapshot.activeStateId = (int)smokerStateMachine.GetActiveState();
+	snapshot.igniterMode = static_cast<int>(smokerData.igniter.mode);
+	snapshot.augerMode = static_cast<int>(smokerData.auger.mode);
+	snapshot.augerDutyCycle = smokerData.auger.dutyCycle;
+	snapshot.augerFrequency = smokerData.auger.frequency;
+	snapshot.fanMode = static_cast<int>(smokerData.fan.mode);
+	snapshot.fanDutyCycle = smokerData.fan.dutyCycle;
+	snapshot.fanFrequency = smokerData.fan.frequency;
+	snapshot.augerFeedRate = smokerData.auger.Mass;
+	snapshot.pelletsDeliveredGrams = PelletFeed::getDeliveredGrams();
+	snapshot.flameoutConfidence = smokerData.flameoutConfidence;
+	snapshot.reigniteAttempts = smokerData.reigniteAttempts;
+	Telemetry::publish(snapshot);
+}
+
+static void controlStepTask(unsigned long dtMs)
+{
+	PROFILE_SCOPE("control.step");
+	SharedStateLock lock;
+
+	unsigned long now = millis();
+	// Rejected samples are replaced by the last good value so they never reach the filter
+	smokeChamberHealth.update(sensorAcquisition.getSample(SensorAcquisition::SmokeChamber), now);
+	firePotHealth.update(sensorAcquisition.getSample(SensorAcquisition::FirePot), now);
+	smokechamberTemperature = smokeChamberHealth.value();
+	firepotTemperature = firePotHealth.value();
+	smokerData.smokeChamberSensorValid = smokeChamberHealth.isValid();
+	smokerData.firePotSensorValid = firePotHealth.isValid();
+
+	smokerData.filteredSmokeChamberTemp = smokeChamberFilter.update(smokechamberTemperature);
+	smokerData.filteredFirePotTemp = firePotFilter.update(firepotTemperature);
+
+	// Measured time since the last step, so state timers and the PID follow the real clock
+	smokerStateMachine.Run(dtMs);
+	AugerRegulatorTask(dtMs);
+	PelletFeed::task();
+
+	// Resolve this step's output modes now so the snapshot matches what the relays are driven with
+	IgniterControlTask();
+	AugerControlTask();
+	FanControlTask();
+	publishTelemetry();
+}
+
+static void outputTask(unsigned long dtMs)
+{
+	PROFILE_SCOPE("control.outputs");
+	SharedStateLock lock;
+	IgniterControlTask();
+	AugerControlTask();
+	FanControlTask();
+}
+
+static void controlTask(void *parameter)
+{
+	controlScheduler.start(esp_timer_get_time());
+	for (;;)
+	{
+		int64_t waitUs = controlScheduler.runPending(esp_timer_get_time());
+		TickType_t ticks = pdMS_TO_TICKS(waitUs / 1000);
+		vTaskDelay(ticks > 0 ? ticks : 1);
+	}
+}
+
+// AC2, web server and relay statistics. Anything here may block on flash or the network.
+static void commsTask(void *parameter)
+{
+	uint32_t loggedVersion = 0;
+	for (;;)
+	{
+		{
+			PROFILE_SCOPE("comms.ac2Task");
+			TRACE_SCOPE("AC2.task");
+			AC2.task();
+		}
+#ifdef SMOKER_ASYNC_WEB
+		{
+			// Handlers of the requests AsyncTCP has queued; they may block on locks and flash here
+			PROFILE_SCOPE("comms.web");
+			webInterface.handleClient();
+		}
+#endif
+		{
+			PROFILE_SCOPE("comms.events");
+			webInterface.pushEvents();
+		}
+		{
+			PROFILE_SCOPE("comms.relayPersist");
+			RelayDriver::persistTask();
+		}
+
+		// Queue a sample from the published snapshot, only when the control task produced a new one
+		uint32_t version = Telemetry::getVersion();
+		if (version != loggedVersion)
+		{
+			PROFILE_SCOPE("comms.logData");
+			TelemetrySnapshot snapshot;
+			loggedVersion = Telemetry::read(snapshot);
+			DataLogger::logData(
+				snapshot.smokeChamberTemp,
+				snapshot.firePotTemp,
+				snapshot.setpoint,
+				snapshot.smokesetpoint,
+				snapshot.activeStateId,
+				snapshot.igniterMode,
+				snapshot.augerMode,
+				snapshot.augerDutyCycle,
+				snapshot.augerFrequency,
+				snapshot.fanMode,
+				snapshot.fanDutyCycle,
+				snapshot.fanFrequency);
+		}
+
+		vTaskDelay(1);
+	}
+}
+
+// Drains the logging queue: record encoding, SPIFFS writes and file rotation, off the comms task
+static void loggerTask(void *parameter)
+{
+	for (;;)
+	{
+		{
+			PROFILE_SCOPE("logger.write");
+			DataLogger::writerTask();
+		}
+		// One period, or until DataLogger::flush() asks for the staged records
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DataLogger::WRITER_PERIOD_MS));
+	}
+}
+
 void setup()
 {
-	pinMode(igniterPin, OUTPUT);
-	pinMode(fanPin, OUTPUT);
-	pinMode(augerPin, OUTPUT);
+	relayScheduler.begin(augerPin, fanPin, igniterPin);
 
 	Serial.begin(115200);
 
@@ -338,6 +600,8 @@ void setup()
 		Serial.println("SPIFFS mount failed");
 		return;
 	}
+	RelayDriver::loadStats();
+	PelletFeed::resetDelivered();
 
 	WiFi.hostname(ControllerName);
 	WiFi.mode(WIFI_STA);
@@ -363,9 +627,16 @@ void setup()
 		Serial.println("ERROR: WiFi connection failed. Check SSID/password.");
 	}
 
+#ifdef SMOKER_ASYNC_WEB
+	// AC2 keeps its WebServer on port 80; close it so the async server can listen there
+	AC2.init(ControllerName, WiFi.localIP(), IPADDR_BROADCAST, 4020, 100);
+	AC2.webserver.stop();
+	webInterface.begin();
+#else
 	webInterface.begin();
 
 	AC2.init(ControllerName, WiFi.localIP(), IPADDR_BROADCAST, 4020, 100);
+#endif
 
 	if (!LoadConfigFromSPIFFS(smokerConfig))
 	{
@@ -387,50 +658,33 @@ void setup()
 		.enabled = smokerConfig.logging.enabled,
 		.logIntervalMs = smokerConfig.logging.logIntervalMs,
 		.maxLogFiles = smokerConfig.logging.maxLogFiles,
-		.maxLogFileSizeBytes = smokerConfig.logging.maxLogFileSizeBytes};
+		.maxLogFileSizeBytes = smokerConfig.logging.maxLogFileSizeBytes,
+		.flushRecords = smokerConfig.logging.flushRecords,
+		.flushIntervalMs = smokerConfig.logging.flushIntervalMs};
 	DataLogger::init(logConfig);
 
 	// initialize filtered temperatures to first read values
-	smokerData.filteredSmokeChamberTemp = smokechamberthermocouple.readFahrenheit();
-	smokerData.filteredFirePotTemp = firepotthermocouple.readFahrenheit();
-	timeNow = millis();
-	lastTime = timeNow;
+	sensorAcquisition.begin(thermoCLK, thermoDO, thermoCS, thermoCS2);
+	sensorAcquisition.prime();
+	smokeChamberHealth.update(sensorAcquisition.getSample(SensorAcquisition::SmokeChamber), millis());
+	firePotHealth.update(sensorAcquisition.getSample(SensorAcquisition::FirePot), millis());
+	ConfigureSensorFilters();
+	smokerData.filteredSmokeChamberTemp = smokeChamberFilter.reset(smokeChamberHealth.value());
+	smokerData.filteredFirePotTemp = firePotFilter.reset(firePotHealth.value());
+	smokerData.smokeChamberSensorValid = smokeChamberHealth.isValid();
+	smokerData.firePotSensorValid = firePotHealth.isValid();
+	controlScheduler.addTask("sensors", sensorTask, sensorPeriodMs, 0, 3, 2000);
+	controlScheduler.addTask("outputs", outputTask, outputPeriodMs, outputPeriodMs / 2, 2, 2000);
+	controlScheduler.addTask("control", controlStepTask, task500ms, 0, 1, 20000);
+
+	SharedStateLock::begin();
+	xTaskCreatePinnedToCore(controlTask, "control", 4096, nullptr, controlTaskPriority, &controlTaskHandle, controlTaskCore);
+	xTaskCreatePinnedToCore(commsTask, "comms", 8192, nullptr, commsTaskPriority, &commsTaskHandle, commsTaskCore);
+	xTaskCreatePinnedToCore(loggerTask, "logger", 4096, nullptr, loggerTaskPriority, &loggerTaskHandle, loggerTaskCore);
 }
 
 void loop()
 {
-	AC2.task();
-
-	timeNow = millis();
-	unsigned long elapsedTime = timeNow - lastTime;
-	if (elapsedTime >= task500ms)
-	{
-		lastTime = timeNow;
-		smokechamberTemperature = smokechamberthermocouple.readFahrenheit();
-		firepotTemperature = firepotthermocouple.readFahrenheit();
-
-		smokerData.filteredSmokeChamberTemp = ((smokechamberTemperature * 0.5) + (smokerData.filteredSmokeChamberTemp * 0.5));
-		smokerData.filteredFirePotTemp = ((firepotTemperature * 0.5) + (smokerData.filteredFirePotTemp * 0.5));
-
-		smokerStateMachine.Run(task500ms);
-	}
-
-	IgniterControlTask();
-	AugerControlTask();
-	FanControlTask();
-
-	// Log data if enabled
-	DataLogger::logData(
-		smokerData.filteredSmokeChamberTemp,
-		smokerData.filteredFirePotTemp,
-		smokerConfig.operating.setpoint,
-		smokerConfig.operating.smokesetpoint,
-		smokerConfig.operating.activeState,
-		static_cast<int>(smokerData.igniter.mode),
-		static_cast<int>(smokerData.auger.mode),
-		smokerData.auger.dutyCycle,
-		smokerData.auger.frequency,
-		static_cast<int>(smokerData.fan.mode),
-		smokerData.fan.dutyCycle,
-		smokerData.fan.frequency);
+	// All work runs in controlTask, commsTask and loggerTask
+	vTaskDelete(NULL);
 }
@@ -50,7 +50,7 @@ struct AugerControl
     Mode mode;
     float dutyCycle;
     float frequency;
-    float Mass;
+    float Mass; // Mass mode target feed rate (grams per minute)
 };
 
 struct FanControl
@@ -72,6 +72,10 @@ struct SmokerData
 {
     float filteredSmokeChamberTemp;
     float filteredFirePotTemp;
+    bool smokeChamberSensorValid; // false once the chamber reading can no longer be trusted
+    bool firePotSensorValid;
+    float flameoutConfidence; // fire-health detector output in Auto_Run, 0 = burning normally
+    int reigniteAttempts;     // flameout re-ignitions since the fire pot was last filled
     IgniterControl igniter;
     AugerControl auger;
     FanControl fan;
@@ -87,6 +91,25 @@ struct SmokerConfig
         char activeState[32]; // Alias for current state machine state
     };
 
+    // Signal conditioning for one temperature sensor (see SignalFilter.h)
+    struct FilterParams
+    {
+        int medianLength;      // Median-of-N window, 1 = off (odd, max 5)
+        float emaAlpha;        // Exponential average weight of the new sample, 1.0 = off
+        float lowpassCutoffHz; // Biquad low-pass cutoff, 0 = off
+        float slewRateLimit;   // Max change in F per second, 0 = off
+    };
+
+    // Flameout detection in Auto_Run (see FlameoutDetector.h)
+    struct FlameoutParams
+    {
+        bool enabled;
+        float slopeThreshold;    // Fire-pot cooling rate counted as evidence (F per second)
+        float minFeedGrams;      // Pellets fed over the 20 s window for full evidence
+        float confidence;        // Confidence needed to declare a flameout (0-1)
+        int maxReigniteAttempts; // Re-ignitions before giving up and shutting down
+    };
+
     struct TunableParams
     {
         float minAutoRestartTemp;
@@ -104,6 +127,15 @@ struct SmokerConfig
         // Fan transfer function: 11 points (duty cycle 0-100 in 10% steps)
         // [i][0] = duty cycle %, [i][1] = target temperature F
         float fanTransferFunc[11][2];
+        // Auger PID trim around the transfer function (duty % per F, per F*s, per F/s)
+        float augerKp;
+        float augerKi;
+        float augerKd;
+        // Auger delivery rate measured by the calibration routine (see PelletFeed.h)
+        float augerGramsPerSecond;
+        FilterParams smokeChamberFilter;
+        FilterParams firePotFilter;
+        FlameoutParams flameout;
     };
 
     struct RecipeState
@@ -119,6 +151,8 @@ struct SmokerConfig
         unsigned long logIntervalMs;
         int maxLogFiles;
         unsigned long maxLogFileSizeBytes;
+        int flushRecords;              // staged records that trigger a batch write
+        unsigned long flushIntervalMs; // max age of a staged record, the power-cut loss window
     };
 
     OperatingParams operating;
@@ -133,6 +167,7 @@ struct UserInputs
     bool btn_Auto;
     bool btn_Shutdown;
     bool btn_Manual;
+    bool btn_Autotune; // set by /api/autotune after the experiment is configured
 };
 
 // Pin state constants
@@ -144,4 +179,5 @@ extern SmokerConfig smokerConfig;
 extern UserInputs uiData;
 
 bool SaveConfigToSPIFFS(const SmokerConfig &config);
-bool LoadConfigFromSPIFFS(SmokerConfig &config);
\ No newline at end of file
+bool LoadConfigFromSPIFFS(SmokerConfig &config);
+void ConfigureSensorFilters();
\ No newline at end of file
@@ -1,90 +1,13 @@
 #include <Arduino.h>
 #include "SmokerOutputs.h"
 #include "SmokerControl.h"
+#include "PidController.h"
+#include "TransferFunction.h"
+#include "RelayScheduler.h"
+#include "PelletFeed.h"
 
-extern int augerPin;
-extern int fanPin;
-extern int igniterPin;
-
-bool augerPWM(int percent, float periodSeconds)
-{
-    static unsigned long cycleStartTime = 0;
-    static bool cycleInitialized = false;
-
-    if (!cycleInitialized)
-    {
-        cycleStartTime = millis();
-        cycleInitialized = true;
-    }
-
-    unsigned long periodMillis = (unsigned long)(periodSeconds * 1000.0);
-    unsigned long onTimeMillis = (unsigned long)((percent / 100.0) * periodMillis);
-    unsigned long elapsedTime = millis() - cycleStartTime;
-
-    // Reset cycle if period has elapsed
-    if (elapsedTime >= periodMillis)
-    {
-        cycleStartTime = millis();
-        elapsedTime = 0;
-    }
-
-    // Return true if within the on-time window, false otherwise
-    return (elapsedTime < onTimeMillis);
-}
-
-bool fanPWM(int percent, float periodSeconds)
-{
-    static unsigned long cycleStartTime = 0;
-    static bool cycleInitialized = false;
-
-    if (!cycleInitialized)
-    {
-        cycleStartTime = millis();
-        cycleInitialized = true;
-    }
-
-    unsigned long periodMillis = (unsigned long)(periodSeconds * 1000.0);
-    unsigned long onTimeMillis = (unsigned long)((percent / 100.0) * periodMillis);
-    unsigned long elapsedTime = millis() - cycleStartTime;
-
-    // Reset cycle if period has elapsed
-    if (elapsedTime >= periodMillis)
-    {
-        cycleStartTime = millis();
-        elapsedTime = 0;
-    }
-
-    // Return true if within the on-time window, false otherwise
-    return (elapsedTime < onTimeMillis);
-}
-
-float lookupTableInterpolate(float inputValue, const float *inputArray, const float *outputArray, int arraySize)
-{
-    if (arraySize <= 0)
-        return 0.0;
-    if (arraySize == 1)
-        return outputArray[0];
-
-    if (inputValue <= inputArray[0])
-        return outputArray[0];
-    if (inputValue >= inputArray[arraySize - 1])
-        return outputArray[arraySize - 1];
-
-    for (int i = 0; i < arraySize - 1; i++)
-    {
-        if (inputValue >= inputArray[i] && inputValue <= inputArray[i + 1])
-        {
-            float x1 = inputArray[i];
-            float x2 = inputArray[i + 1];
-            float y1 = outputArray[i];
-            float y2 = outputArray[i + 1];
-
-            return y1 + (inputValue - x1) * (y2 - y1) / (x2 - x1);
-        }
-    }
-
-    return outputArray[arraySize - 1];
-}
+static PidController augerPid;
+static bool augerPidActive = false;
 
 void IgniterControlTask()
 {
@@ -92,15 +15,15 @@ void IgniterControlTask()
     switch (smokerData.igniter.mode)
     {
     case IgniterControl::Mode::Off:
-        digitalWrite(igniterPin, Off);
+        relayScheduler.setOn(RelayScheduler::Igniter, false);
         break;
 
     case IgniterControl::Mode::On:
-        digitalWrite(igniterPin, On);
+        relayScheduler.setOn(RelayScheduler::Igniter, true);
         break;
 
     default:
-        digitalWrite(igniterPin, Off);
+        relayScheduler.setOn(RelayScheduler::Igniter, false);
         break;
     }
 }
@@ -119,48 +42,16 @@ void AugerControlTask()
         break;
 
     case AugerControl::Mode::Auto:
-    {
-        // Extract temperature and duty cycle arrays from transfer function
-        float tempArray[11];
-        float dutyCycleArray[11];
-        for (int i = 0; i < 11; i++)
-        {
-            dutyCycleArray[i] = smokerConfig.tunable.augerTransferFunc[i][0];
-            tempArray[i] = smokerConfig.tunable.augerTransferFunc[i][1];
-        }
-        
-        float dutyCycleOffset = 0.0f;
-        if (smokerData.filteredSmokeChamberTemp >= smokerConfig.operating.setpoint + 5.0f)
-        {
-            dutyCycleOffset = -10.0f;
-        }
-        else if (smokerData.filteredSmokeChamberTemp <= smokerConfig.operating.setpoint - 5.0f)
-        {
-            dutyCycleOffset = 10.0f; 
-        }
-        else
-        {
-            dutyCycleOffset = (smokerConfig.operating.setpoint - smokerData.filteredSmokeChamberTemp) * (10.0f / 5.0f); //bad proportional control, just for testing
-        }
-
-        if (abs(dutyCycleOffset) < 5.0f)
-        {
-            dutyCycleOffset = 0.0f; // add a deadband to prevent constant small adjustments
-        }
-
-        // Interpolate setpoint to get auto duty cycle
-        smokerData.auger.dutyCycle = lookupTableInterpolate(smokerConfig.operating.setpoint, tempArray, dutyCycleArray, 11);
-        smokerData.auger.dutyCycle += dutyCycleOffset; // apply offset based on current temp vs setpoint
-
+        // Duty cycle is computed at a fixed rate by AugerRegulatorTask()
         break;
-    }
 
     case AugerControl::Mode::Manual:
         // Manual mode: Use duty cycle from smokerData
         break;
 
     case AugerControl::Mode::Mass:
-        smokerData.auger.dutyCycle = 0.0f;
+        // Feed rate in g/min -> duty; independent of the PWM period
+        smokerData.auger.dutyCycle = PelletFeed::dutyForFeedRate(smokerData.auger.Mass);
         break;
 
     default:
@@ -169,14 +60,34 @@ void AugerControlTask()
     }
 
     smokerData.auger.frequency = smokerConfig.tunable.augerFrequency;
-    if (augerPWM(smokerData.auger.dutyCycle, smokerData.auger.frequency))
+    relayScheduler.setDuty(RelayScheduler::Auger, smokerData.auger.dutyCycle, smokerData.auger.frequency);
+}
+
+// Closed-loop chamber temperature control for Auto mode. The transfer function
+// gives the open-loop duty for the setpoint (feedforward), the PID trims it.
+void AugerRegulatorTask(unsigned long taskRateMs)
+{
+    if (smokerData.auger.mode != AugerControl::Mode::Auto)
     {
-        digitalWrite(augerPin, On);
+        augerPidActive = false;
+        return;
     }
-    else
+
+    float feedforward = EvaluateAugerTransferFunction(smokerConfig.operating.setpoint);
+
+    if (!augerPidActive)
     {
-        digitalWrite(augerPin, Off);
+        // Bumpless entry into Auto: start from the feedforward duty
+        augerPid.reset(smokerData.filteredSmokeChamberTemp);
+        augerPidActive = true;
     }
+
+    augerPid.setGains(smokerConfig.tunable.augerKp, smokerConfig.tunable.augerKi, smokerConfig.tunable.augerKd);
+    augerPid.setOutputLimits(0.0f, 100.0f);
+    smokerData.auger.dutyCycle = augerPid.update(smokerConfig.operating.setpoint,
+                                                 smokerData.filteredSmokeChamberTemp,
+                                                 feedforward,
+                                                 taskRateMs / 1000.0f);
 }
 
 void FanControlTask()
@@ -193,19 +104,9 @@ void FanControlTask()
         break;
 
     case FanControl::Mode::Auto:
-    {
-        // Extract smoke level and duty cycle arrays from transfer function
-        float smokeArray[11];
-        float dutyCycleArray[11];
-        for (int i = 0; i < 11; i++)
-        {
-            dutyCycleArray[i] = smokerConfig.tunable.fanTransferFunc[i][0];
-            smokeArray[i] = smokerConfig.tunable.fanTransferFunc[i][1];
-        }
         // Interpolate smoke setpoint to get auto duty cycle
-        smokerData.fan.dutyCycle = lookupTableInterpolate(smokerConfig.operating.smokesetpoint, smokeArray, dutyCycleArray, 11);
+        smokerData.fan.dutyCycle = EvaluateFanTransferFunction(smokerConfig.operating.smokesetpoint);
         break;
-    }
 
     case FanControl::Mode::Manual:
         // Manual mode: Use duty cycle from smokerData
@@ -225,12 +126,5 @@ void FanControlTask()
         smokerData.fan.frequency = smokerConfig.tunable.fanFrequency;
     }
 
-    if (fanPWM(smokerData.fan.dutyCycle, smokerData.fan.frequency))
-    {
-        digitalWrite(fanPin, On);
-    }
-    else
-    {
-        digitalWrite(fanPin, Off);
-    }
+    relayScheduler.setDuty(RelayScheduler::Fan, smokerData.fan.dutyCycle, smokerData.fan.frequency);
 }
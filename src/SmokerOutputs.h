@@ -3,3 +3,4 @@
 void IgniterControlTask();
 void AugerControlTask();
 void FanControlTask();
+void AugerRegulatorTask(unsigned long taskRateMs);
@@ -1,4 +1,7 @@
 #include "SmokerStateMachine.h"
+#include "PelletFeed.h"
+#include "Autotuner.h"
+#include "FlameoutDetector.h"
 #include <cstring>
 
 bool idleTempReached = false;
@@ -10,7 +13,8 @@ SmokerStateMachine::SmokerStateMachine()
       stateTimer(0),
       resetTimer(false),
       transitionRequested(false),
-      requestedState(State::InitialConditions)
+      requestedState(State::InitialConditions),
+      reigniting(false)
 {
 }
 
@@ -37,6 +41,19 @@ void SmokerStateMachine::ProcessButtonInputs()
         RequestStateTransition(State::Manual_Run);
         uiData.btn_Manual = false;
     }
+    else if (uiData.btn_Autotune)
+    {
+        // The relay experiment needs an established fire to oscillate around the target
+        if (activeState == State::Auto_Run)
+        {
+            RequestStateTransition(State::Autotune);
+        }
+        else
+        {
+            autotuner.cancel("autotune can only start from Running");
+        }
+        uiData.btn_Autotune = false;
+    }
 }
 
 const char *SmokerStateMachine::GetStateName(State state)
@@ -71,6 +88,8 @@ const char *SmokerStateMachine::GetStateName(State state)
         return "Off";
     case State::Manual_Run:
         return "Manual Mode";
+    case State::Autotune:
+        return "Autotuning";
     default:
         return "Unknown";
     }
@@ -145,6 +164,9 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
             smokerData.auger.mode = AugerControl::Mode::On;
             smokerData.fan.mode = FanControl::Mode::Off;
             smokerData.igniter.mode = IgniterControl::Mode::Off;
+            PelletFeed::resetDelivered(); // new cook, start counting pellets from zero
+            smokerData.reigniteAttempts = 0;
+            reigniting = false;
         }
 
         // exit (placeholder)
@@ -168,7 +190,8 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
         // entry
         if (firstEntry)
         {
-            smokerData.auger.mode = AugerControl::Mode::On;
+            // After a flameout the pot is already full of unburnt pellets, do not add more
+            smokerData.auger.mode = reigniting ? AugerControl::Mode::Off : AugerControl::Mode::On;
             smokerData.fan.mode = FanControl::Mode::Off;
             smokerData.igniter.mode = IgniterControl::Mode::On;
         }
@@ -178,8 +201,9 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
         {
             RequestStateTransition(State::Startup_PuffFan);
         }
-        else if (smokerData.filteredFirePotTemp >= smokerConfig.tunable.firePotBurningTemp) // 200 degrees F
+        else if (!reigniting && smokerData.filteredFirePotTemp >= smokerConfig.tunable.firePotBurningTemp) // 200 degrees F
         {
+            // A dying fire pot can still be above the burning temperature, so re-ignition always runs the full preheat
             RequestStateTransition(State::Startup_Stabilize);
         }
 
@@ -187,6 +211,7 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
         if (transitionRequested)
         {
             // cleanup ignition activities
+            reigniting = false;
         }
         break;
 
@@ -363,10 +388,40 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
             smokerData.auger.mode = AugerControl::Mode::Auto;
             smokerData.fan.mode = FanControl::Mode::Auto;
             smokerData.igniter.mode = IgniterControl::Mode::Off;
+            flameoutDetector.reset();
+            smokerData.flameoutConfidence = 0.0f;
         }
 
         // during
-        // consider adding logic to detect flameout here!!!
+        // A dead fire keeps getting pellets in Auto, watch the fire pot against the feed
+        if (smokerConfig.tunable.flameout.enabled && smokerData.firePotSensorValid)
+        {
+            FlameoutSettings flameoutSettings = {
+                .slopeThreshold = smokerConfig.tunable.flameout.slopeThreshold,
+                .minFeedGrams = smokerConfig.tunable.flameout.minFeedGrams,
+                .confidence = smokerConfig.tunable.flameout.confidence,
+                .burningTemp = smokerConfig.tunable.firePotBurningTemp};
+
+            bool flameout = flameoutDetector.update(smokerData.filteredFirePotTemp, PelletFeed::getDeliveredGrams(),
+                                                    taskRateMs / 1000.0f, flameoutSettings);
+            smokerData.flameoutConfidence = flameoutDetector.getConfidence();
+
+            if (flameout)
+            {
+                if (smokerData.reigniteAttempts < smokerConfig.tunable.flameout.maxReigniteAttempts)
+                {
+                    Serial.println("Flameout detected, re-igniting");
+                    smokerData.reigniteAttempts++;
+                    reigniting = true;
+                    RequestStateTransition(State::Startup_IgniterOn);
+                }
+                else
+                {
+                    Serial.println("Flameout detected, shutting down");
+                    RequestStateTransition(State::Shutdown_Cool);
+                }
+            }
+        }
         break;
 
     case State::Shutdown_Cool:
@@ -416,14 +471,70 @@ void SmokerStateMachine::Run(unsigned long taskRateMs)
 
         // during
         break;
+
+    case State::Autotune:
+        // entry
+        if (firstEntry)
+        {
+            // The autotuner drives the auger duty directly, the regulator stays out of the loop
+            smokerData.auger.mode = AugerControl::Mode::Manual;
+            smokerData.fan.mode = FanControl::Mode::Auto;
+            smokerData.igniter.mode = IgniterControl::Mode::Off;
+        }
+
+        // during
+        smokerData.auger.dutyCycle = autotuner.update(smokerData.filteredSmokeChamberTemp, stateTimer);
+
+        // exit
+        if (!smokerData.smokeChamberSensorValid)
+        {
+            autotuner.cancel("smoke chamber sensor fault");
+            RequestStateTransition(State::Shutdown_Cool);
+        }
+        else if (autotuner.getStatus() != Autotuner::Status::Running)
+        {
+            // Complete or failed, results stay available on /api/autotune for review
+            RequestStateTransition(State::Auto_Run);
+        }
+
+        // exit cleanup
+        if (transitionRequested)
+        {
+            // cleanup is applied with the transition below so button requests also stop the experiment
+        }
+        break;
     }
 
     // Process button inputs after state processing to ensure UI calls happen on the same cycle
     ProcessButtonInputs();
 
+    // Auto mode is blind without the chamber temperature, stop feeding rather than guess.
+    // Checked after the buttons so a press in the same cycle cannot override it.
+    if (!smokerData.smokeChamberSensorValid && smokerData.auger.mode == AugerControl::Mode::Auto)
+    {
+        if (activeState == State::Shutdown_Cool)
+        {
+            transitionRequested = false;
+        }
+        else
+        {
+            requestedState = State::Shutdown_Cool;
+            transitionRequested = true;
+        }
+    }
+
     // Apply any requested transition once, after state processing.
     if (transitionRequested)
     {
+        if (activeState == State::Autotune)
+        {
+            autotuner.cancel();
+        }
+        // A calibration run must not keep the auger once a state takes over the outputs
+        if (PelletFeed::getCalibrationState() == PelletFeed::CalibrationState::Running)
+        {
+            PelletFeed::cancelCalibration();
+        }
         firstEntry = true;
         activeState = requestedState;
         resetTimer = true;
@@ -19,13 +19,14 @@ public:
         Auto_Run,
         Shutdown_Cool,
         Shutdown_AllOff,
-        Manual_Run
+        Manual_Run,
+        Autotune
     };
 
     SmokerStateMachine();
     void Run(unsigned long taskRateMs);
     State GetActiveState() const;
-    const char *GetStateName(State state);
+    static const char *GetStateName(State state);
     void RequestStateTransition(State state);
     void ForceStateTransition(State state);
 
@@ -36,6 +37,9 @@ private:
     bool resetTimer;
     bool transitionRequested;
     State requestedState;
+    bool reigniting; // Startup_IgniterOn entered after a flameout rather than a cold start
 
     void ProcessButtonInputs();
 };
+
+extern SmokerStateMachine smokerStateMachine;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Bounded single-producer/single-consumer queue. push() is only called from
+// one task and pop() from one other task; neither blocks or takes a lock, the
+// indices are handed over with acquire/release ordering. Holds N - 1 items.
+// The producer also tracks the high-water mark and the pushes it had to drop,
+// so the capacity can be sized from field data.
+template <typename T, size_t N>
+class SpscQueue
+{
+public:
+    static_assert(N >= 2, "queue needs at least two slots");
+
+    // Producer only; false (and counted as dropped) when the queue is full
+    bool push(const T &item)
+    {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % N;
+        size_t head = this->head.load(std::memory_order_acquire);
+        if (next == head)
+        {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items[tail] = item;
+        this->tail.store(next, std::memory_order_release);
+
+        size_t depth = (next + N - head) % N;
+        if (depth > highWater.load(std::memory_order_relaxed))
+            highWater.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer only; false when the queue is empty
+    bool pop(T &item)
+    {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[head];
+        this->head.store((head + 1) % N, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when read from a third task
+    size_t size() const
+    {
+        return (tail.load(std::memory_order_acquire) + N - head.load(std::memory_order_acquire)) % N;
+    }
+    static constexpr size_t capacity() { return N - 1; }
+    size_t getHighWater() const { return highWater.load(std::memory_order_relaxed); }
+    unsigned long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    T items[N];
+    std::atomic<size_t> head{0}; // next slot to pop, written by the consumer
+    std::atomic<size_t> tail{0}; // next slot to fill, written by the producer
+    std::atomic<size_t> highWater{0};
+    std::atomic<unsigned long> dropped{0};
+};
@@ -0,0 +1,75 @@
+#include "StatusCache.h"
+#include <ArduinoJson.h>
+#include "SensorHealth.h"
+#include "Telemetry.h"
+
+StatusCache::Lock::Lock(StatusCache &cache)
+    : cache(cache)
+{
+    xSemaphoreTake(cache.mutex, portMAX_DELAY);
+}
+
+StatusCache::Lock::~Lock()
+{
+    xSemaphoreGive(cache.mutex);
+}
+
+void StatusCache::begin()
+{
+    mutex = xSemaphoreCreateMutex();
+}
+
+static void addSensorHealth(JsonObject sensor, const TelemetrySnapshot::SensorStatus &health)
+{
+    sensor["state"] = SensorHealth::GetStateName(health.state);
+    sensor["valid"] = health.valid;
+    sensor["openCircuitCount"] = health.openCircuitCount;
+    sensor["rangeRejectCount"] = health.rangeRejectCount;
+    sensor["rateRejectCount"] = health.rateRejectCount;
+    sensor["staleCount"] = health.staleCount;
+}
+
+// Serialize the latest snapshot once; every poll until the next control tick reuses the bytes
+void StatusCache::refresh()
+{
+    if (length > 0 && Telemetry::getVersion() == version)
+    {
+        return;
+    }
+
+    StaticJsonDocument<1024> doc;
+    TelemetrySnapshot snapshot;
+    Telemetry::read(snapshot);
+
+    doc["version"] = snapshot.version;
+    doc["smokeChamberTemp"] = snapshot.smokeChamberTemp;
+    doc["firePotTemp"] = snapshot.firePotTemp;
+
+    doc["operating"]["setpoint"] = snapshot.setpoint;
+    doc["operating"]["smokesetpoint"] = snapshot.smokesetpoint;
+    doc["operating"]["activeState"] = snapshot.activeState;
+
+    doc["igniterMode"] = snapshot.igniterMode;
+    doc["augerMode"] = snapshot.augerMode;
+    doc["augerDutyCycle"] = snapshot.augerDutyCycle;
+    doc["augerFrequency"] = snapshot.augerFrequency;
+    doc["fanMode"] = snapshot.fanMode;
+    doc["fanDutyCycle"] = snapshot.fanDutyCycle;
+    doc["fanFrequency"] = snapshot.fanFrequency;
+    doc["augerFeedRate"] = snapshot.augerFeedRate;
+    doc["pelletsDeliveredGrams"] = snapshot.pelletsDeliveredGrams;
+    doc["flameoutConfidence"] = snapshot.flameoutConfidence;
+    doc["reigniteAttempts"] = snapshot.reigniteAttempts;
+
+    addSensorHealth(doc["sensors"]["smokeChamber"].to<JsonObject>(), snapshot.smokeChamberSensor);
+    addSensorHealth(doc["sensors"]["firePot"].to<JsonObject>(), snapshot.firePotSensor);
+
+    length = serializeJson(doc, json, sizeof(json));
+    if (length >= sizeof(json) - 1)
+    {
+        Serial.println("Status JSON truncated, increase StatusCache::SIZE");
+    }
+    version = snapshot.version;
+    // The publish time keeps a tag from before a reboot from matching the same version number
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)snapshot.version, snapshot.timestampMs);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// /api/status body for the latest Telemetry snapshot. It is serialized into a
+// fixed buffer at most once per published version, then every poll and event
+// stream sends the same bytes until the next control tick. The ETag names the
+// version, so a poll that already has it can be answered with a 304.
+class StatusCache
+{
+public:
+    static const size_t SIZE = 1024;
+
+    // Holds the cache while it is refreshed and its bytes are sent
+    class Lock
+    {
+    public:
+        explicit Lock(StatusCache &cache);
+        ~Lock();
+
+    private:
+        StatusCache &cache;
+    };
+
+    // Create the mutex; call before the first Lock
+    void begin();
+
+    // Serialize the latest snapshot if a newer one was published (Lock held)
+    void refresh();
+
+    const char *getJson() const { return json; }
+    size_t getLength() const { return length; }
+    uint32_t getVersion() const { return version; }
+    const char *getETag() const { return etag; }
+
+    // True when an If-None-Match header names the cached version
+    bool matches(const String &ifNoneMatch) const { return length > 0 && ifNoneMatch == etag; }
+
+private:
+    char json[SIZE];
+    size_t length = 0;
+    uint32_t version = 0;
+    char etag[24] = "";
+    SemaphoreHandle_t mutex = nullptr; // the async server fills the cache from another task than pushEvents()
+};
@@ -0,0 +1,154 @@
+#include "TaskScheduler.h"
+#include "TraceBuffer.h"
+
+TaskScheduler::TaskScheduler()
+    : taskCount(0)
+{
+}
+
+bool TaskScheduler::addTask(const char *name, TaskFunction function, unsigned long periodMs, unsigned long phaseMs,
+                            uint8_t priority, uint32_t budgetUs)
+{
+    if (taskCount >= MAX_TASKS || function == nullptr || periodMs == 0)
+    {
+        return false;
+    }
+
+    TaskEntry &task = tasks[taskCount++];
+    task = {};
+    task.name = name;
+    task.function = function;
+    task.periodUs = (int64_t)periodMs * 1000;
+    task.phaseUs = (int64_t)phaseMs * 1000;
+    task.priority = priority;
+    task.budgetUs = budgetUs;
+    task.minExecUs = UINT32_MAX;
+    return true;
+}
+
+void TaskScheduler::start(int64_t nowUs)
+{
+    for (int i = 0; i < taskCount; ++i)
+    {
+        tasks[i].releaseUs = nowUs + tasks[i].phaseUs;
+        tasks[i].lastStartUs = 0;
+    }
+}
+
+int TaskScheduler::nextDueTask(int64_t nowUs) const
+{
+    int best = -1;
+    for (int i = 0; i < taskCount; ++i)
+    {
+        if (tasks[i].releaseUs <= nowUs && (best < 0 || tasks[i].priority > tasks[best].priority))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+int64_t TaskScheduler::runPending(int64_t nowUs)
+{
+    // Re-check after every run so a higher priority release that arrived meanwhile goes first
+    for (int index = nextDueTask(nowUs); index >= 0; index = nextDueTask(nowUs))
+    {
+        TaskEntry &task = tasks[index];
+
+        int64_t startUs = esp_timer_get_time();
+        // Whole milliseconds between starts; the floor telescopes, so summed dt never drifts from the clock
+        unsigned long dtMs = task.lastStartUs ? (unsigned long)(startUs / 1000 - task.lastStartUs / 1000)
+                                              : (unsigned long)(task.periodUs / 1000);
+        {
+            TRACE_SCOPE(task.name);
+            task.function(dtMs);
+        }
+        int64_t endUs = esp_timer_get_time();
+
+        uint32_t execUs = (uint32_t)(endUs - startUs);
+        uint32_t jitterUs = (uint32_t)(startUs - task.releaseUs);
+        int64_t deadlineUs = task.releaseUs + task.periodUs;
+
+        // Next release on the absolute grid; releases that already passed are skipped, not bunched up
+        unsigned long skipped = 0;
+        task.releaseUs += task.periodUs;
+        while (task.releaseUs <= endUs)
+        {
+            task.releaseUs += task.periodUs;
+            skipped++;
+        }
+
+        portENTER_CRITICAL(&mux);
+        task.lastStartUs = startUs;
+        task.lastDtMs = dtMs;
+        task.runs++;
+        bool missed = endUs > deadlineUs;
+        if (missed)
+            task.missedDeadlines += skipped ? skipped : 1;
+        if (task.budgetUs && execUs > task.budgetUs)
+            task.overruns++;
+        if (execUs < task.minExecUs)
+            task.minExecUs = execUs;
+        if (execUs > task.maxExecUs)
+            task.maxExecUs = execUs;
+        task.totalExecUs += execUs;
+        if (jitterUs > task.maxJitterUs)
+            task.maxJitterUs = jitterUs;
+        task.totalJitterUs += jitterUs;
+        portEXIT_CRITICAL(&mux);
+
+        if (missed)
+            TraceBuffer::checkMissedDeadline();
+        nowUs = endUs;
+    }
+
+    int64_t waitUs = INT64_MAX;
+    for (int i = 0; i < taskCount; ++i)
+    {
+        int64_t untilUs = tasks[i].releaseUs - nowUs;
+        if (untilUs < waitUs)
+            waitUs = untilUs;
+    }
+    return waitUs < 0 ? 0 : waitUs;
+}
+
+TaskScheduler::TaskStats TaskScheduler::getStats(int index) const
+{
+    TaskStats stats = {};
+    if (index < 0 || index >= taskCount)
+    {
+        return stats;
+    }
+
+    portENTER_CRITICAL(&mux);
+    const TaskEntry &task = tasks[index];
+    stats.runs = task.runs;
+    stats.missedDeadlines = task.missedDeadlines;
+    stats.overruns = task.overruns;
+    stats.minExecUs = task.runs ? task.minExecUs : 0;
+    stats.maxExecUs = task.maxExecUs;
+    stats.meanExecUs = task.runs ? (uint32_t)(task.totalExecUs / task.runs) : 0;
+    stats.maxJitterUs = task.maxJitterUs;
+    stats.meanJitterUs = task.runs ? (uint32_t)(task.totalJitterUs / task.runs) : 0;
+    stats.lastDtMs = task.lastDtMs;
+    portEXIT_CRITICAL(&mux);
+    return stats;
+}
+
+void TaskScheduler::resetStats()
+{
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < taskCount; ++i)
+    {
+        TaskEntry &task = tasks[i];
+        task.runs = 0;
+        task.missedDeadlines = 0;
+        task.overruns = 0;
+        task.minExecUs = UINT32_MAX;
+        task.maxExecUs = 0;
+        task.totalExecUs = 0;
+        task.maxJitterUs = 0;
+        task.totalJitterUs = 0;
+    }
+    portEXIT_CRITICAL(&mux);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Cooperative rate-monotonic scheduler for the control task. Each entry of
+// the task table is released on absolute times (phase + n * period), so a
+// late run never shifts later releases. Tasks that are due run highest
+// priority first and receive the measured time since their previous run.
+// Execution time, release jitter, budget overruns and missed deadlines
+// (a run that finishes after the next release) are tracked per task.
+class TaskScheduler
+{
+public:
+    typedef void (*TaskFunction)(unsigned long dtMs);
+
+    struct TaskStats
+    {
+        unsigned long runs;
+        unsigned long missedDeadlines; // finished after the next release, or releases skipped
+        unsigned long overruns;        // execution longer than the budget
+        uint32_t minExecUs;
+        uint32_t maxExecUs;
+        uint32_t meanExecUs;
+        uint32_t maxJitterUs;  // start time - release time
+        uint32_t meanJitterUs;
+        unsigned long lastDtMs;
+    };
+
+    static const int MAX_TASKS = 8;
+
+    TaskScheduler();
+
+    // Add a task to the table before start(); higher priority runs first when several are due
+    bool addTask(const char *name, TaskFunction function, unsigned long periodMs, unsigned long phaseMs,
+                 uint8_t priority, uint32_t budgetUs);
+
+    // Set the first release of every task relative to nowUs
+    void start(int64_t nowUs);
+
+    // Run every task released by nowUs; returns the time until the next release in microseconds
+    int64_t runPending(int64_t nowUs);
+
+    int getTaskCount() const { return taskCount; }
+    const char *getTaskName(int index) const { return tasks[index].name; }
+    unsigned long getPeriodMs(int index) const { return tasks[index].periodUs / 1000; }
+    uint8_t getPriority(int index) const { return tasks[index].priority; }
+    uint32_t getBudgetUs(int index) const { return tasks[index].budgetUs; }
+    TaskStats getStats(int index) const;
+    void resetStats();
+
+private:
+    struct TaskEntry
+    {
+        const char *name;
+        TaskFunction function;
+        int64_t periodUs;
+        int64_t phaseUs;
+        uint8_t priority;
+        uint32_t budgetUs;
+        int64_t releaseUs;   // absolute time of the pending release
+        int64_t lastStartUs; // previous start, 0 before the first run
+        unsigned long runs;
+        unsigned long missedDeadlines;
+        unsigned long overruns;
+        uint32_t minExecUs;
+        uint32_t maxExecUs;
+        uint64_t totalExecUs;
+        uint32_t maxJitterUs;
+        uint64_t totalJitterUs;
+        unsigned long lastDtMs;
+    };
+
+    TaskEntry tasks[MAX_TASKS];
+    int taskCount;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    int nextDueTask(int64_t nowUs) const;
+};
+
+extern TaskScheduler controlScheduler;
@@ -0,0 +1,36 @@
+#include "Telemetry.h"
+#include <string.h>
+
+TelemetrySnapshot Telemetry::current = {};
+std::atomic<uint32_t> Telemetry::sequence(0);
+std::atomic<uint32_t> Telemetry::version(0);
+
+void Telemetry::publish(const TelemetrySnapshot &snapshot)
+{
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t newVersion = version.load(std::memory_order_relaxed) + 1;
+    memcpy(&current, &snapshot, sizeof(current));
+    current.version = newVersion;
+
+    sequence.store(seq + 2, std::memory_order_release);
+    version.store(newVersion, std::memory_order_release);
+}
+
+uint32_t Telemetry::read(TelemetrySnapshot &snapshot)
+{
+    for (;;)
+    {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue; // publish in progress, it only takes a memcpy
+
+        memcpy(&snapshot, &current, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) == before)
+            return snapshot.version;
+    }
+}
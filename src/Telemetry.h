@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "SensorHealth.h"
+
+// One control tick's worth of values, copied out of smokerData/smokerConfig at
+// the end of the control step so every consumer sees a consistent set.
+struct TelemetrySnapshot
+{
+    struct SensorStatus
+    {
+        SensorHealth::State state;
+        bool valid;
+        unsigned long openCircuitCount;
+        unsigned long rangeRejectCount;
+        unsigned long rateRejectCount;
+        unsigned long staleCount;
+    };
+
+    uint32_t version; // increments on every publish, 0 = nothing published yet
+    unsigned long timestampMs;
+
+    float smokeChamberTemp;
+    float firePotTemp;
+    SensorStatus smokeChamberSensor;
+    SensorStatus firePotSensor;
+
+    float setpoint;
+    float smokesetpoint;
+    char activeState[32];
+    int activeStateId; // SmokerStateMachine::State
+
+    int igniterMode;
+    int augerMode;
+    float augerDutyCycle;
+    float augerFrequency;
+    int fanMode;
+    float fanDutyCycle;
+    float fanFrequency;
+    float augerFeedRate;
+    float pelletsDeliveredGrams;
+    float flameoutConfidence;
+    int reigniteAttempts;
+};
+
+// Seqlock around the latest snapshot. The control task is the only writer;
+// readers on any core copy it without locking and retry if a publish
+// overlapped the copy.
+class Telemetry
+{
+public:
+    // Control task only
+    static void publish(const TelemetrySnapshot &snapshot);
+
+    // Consistent copy of the latest snapshot; returns its version
+    static uint32_t read(TelemetrySnapshot &snapshot);
+
+    // Cheap check so consumers can skip work when nothing new was published
+    static uint32_t getVersion() { return version.load(std::memory_order_acquire); }
+
+private:
+    static TelemetrySnapshot current;
+    static std::atomic<uint32_t> sequence; // odd while a publish is in progress
+    static std::atomic<uint32_t> version;
+};
@@ -0,0 +1,223 @@
+#include "TraceBuffer.h"
+#include <esp_timer.h>
+#include <string.h>
+
+TraceBuffer::Event TraceBuffer::events[TraceBuffer::EVENT_CAPACITY];
+std::atomic<uint32_t> TraceBuffer::writeIndex(0);
+std::atomic<uint32_t> TraceBuffer::stopIndex(UINT32_MAX);
+std::atomic<TraceBuffer::State> TraceBuffer::state(TraceBuffer::State::Idle);
+TraceBuffer::TriggerConfig TraceBuffer::config = {.relayErrorUs = 0, .missedDeadline = false, .postTriggerEvents = EVENT_CAPACITY / 2};
+const char *volatile TraceBuffer::triggerReason = "";
+
+void TraceBuffer::arm(const TriggerConfig &newConfig)
+{
+    // Stop writers first so no slot is half written while the ring is cleared
+    state.store(State::Idle, std::memory_order_release);
+    config = newConfig;
+    if (config.postTriggerEvents > EVENT_CAPACITY - 1)
+        config.postTriggerEvents = EVENT_CAPACITY - 1;
+    for (uint32_t i = 0; i < EVENT_CAPACITY; ++i)
+        events[i].sequence.store(0, std::memory_order_relaxed);
+    writeIndex.store(0, std::memory_order_relaxed);
+    stopIndex.store(UINT32_MAX, std::memory_order_relaxed);
+    triggerReason = "";
+    state.store(State::Armed, std::memory_order_release);
+}
+
+void TraceBuffer::trigger(const char *reason)
+{
+    State expected = State::Armed;
+    if (state.compare_exchange_strong(expected, State::Triggered, std::memory_order_acq_rel))
+    {
+        triggerReason = reason;
+        stopIndex.store(writeIndex.load(std::memory_order_acquire) + config.postTriggerEvents, std::memory_order_release);
+        instant(reason);
+    }
+}
+
+void TraceBuffer::stop()
+{
+    State current = state.load(std::memory_order_acquire);
+    if (current == State::Armed || current == State::Triggered)
+    {
+        if (current == State::Armed)
+            triggerReason = "stopped";
+        state.store(State::Frozen, std::memory_order_release);
+    }
+}
+
+void TraceBuffer::record(const char *name, char phase)
+{
+    State current = state.load(std::memory_order_acquire);
+    if (current != State::Armed && current != State::Triggered)
+        return;
+
+    uint32_t index = writeIndex.fetch_add(1, std::memory_order_acq_rel);
+    if (index >= stopIndex.load(std::memory_order_acquire))
+    {
+        // Post-trigger window full: the first writer past the end freezes the capture
+        State triggered = State::Triggered;
+        state.compare_exchange_strong(triggered, State::Frozen, std::memory_order_acq_rel);
+        return;
+    }
+
+    Event &event = events[index & (EVENT_CAPACITY - 1)];
+    event.sequence.store(0, std::memory_order_release); // mark the slot as being rewritten
+    event.timestampUs = (uint32_t)esp_timer_get_time();
+    event.name = name;
+    event.phase = phase;
+    event.task = xTaskGetCurrentTaskHandle();
+    event.sequence.store(index + 1, std::memory_order_release);
+}
+
+void TraceBuffer::checkRelayError(long errorUs)
+{
+    if (config.relayErrorUs && getState() == State::Armed &&
+        (unsigned long)(errorUs < 0 ? -errorUs : errorUs) > config.relayErrorUs)
+    {
+        trigger("relay pulse late");
+    }
+}
+
+void TraceBuffer::checkMissedDeadline()
+{
+    if (config.missedDeadline && getState() == State::Armed)
+    {
+        trigger("missed deadline");
+    }
+}
+
+uint32_t TraceBuffer::getEventCount()
+{
+    uint32_t written = writeIndex.load(std::memory_order_acquire);
+    uint32_t stop = stopIndex.load(std::memory_order_acquire);
+    if (written > stop)
+        written = stop;
+    return written < EVENT_CAPACITY ? written : EVENT_CAPACITY;
+}
+
+const char *TraceBuffer::GetStateName(State state)
+{
+    switch (state)
+    {
+    case State::Idle:
+        return "Idle";
+    case State::Armed:
+        return "Armed";
+    case State::Triggered:
+        return "Triggered";
+    case State::Frozen:
+        return "Frozen";
+    default:
+        return "Unknown";
+    }
+}
+
+TraceExport::TraceExport()
+    : phase(Phase::Done),
+      index(0),
+      end(0),
+      origin(0),
+      haveOrigin(false),
+      first(true),
+      namedTaskCount(0),
+      pendingLength(0),
+      pendingPos(0)
+{
+    TraceBuffer::State current = TraceBuffer::getState();
+    if (current == TraceBuffer::State::Armed || current == TraceBuffer::State::Triggered)
+        return;
+
+    end = TraceBuffer::writeIndex.load(std::memory_order_acquire);
+    uint32_t stop = TraceBuffer::stopIndex.load(std::memory_order_acquire);
+    if (end > stop)
+        end = stop;
+    index = end > TraceBuffer::EVENT_CAPACITY ? end - TraceBuffer::EVENT_CAPACITY : 0;
+    phase = Phase::Open;
+}
+
+size_t TraceExport::read(uint8_t *buffer, size_t maxLength)
+{
+    size_t written = 0;
+    while (written < maxLength)
+    {
+        if (pendingPos < pendingLength)
+        {
+            size_t count = pendingLength - pendingPos;
+            if (count > maxLength - written)
+                count = maxLength - written;
+            memcpy(buffer + written, pending + pendingPos, count);
+            pendingPos += count;
+            written += count;
+            continue;
+        }
+
+        pendingLength = 0;
+        pendingPos = 0;
+        switch (phase)
+        {
+        case Phase::Open:
+            pendingLength = strlcpy(pending, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", sizeof(pending));
+            phase = Phase::Events;
+            break;
+        case Phase::Events:
+            if (index >= end)
+            {
+                phase = Phase::Close;
+                break;
+            }
+            {
+                const TraceBuffer::Event &event = TraceBuffer::events[index & (TraceBuffer::EVENT_CAPACITY - 1)];
+                // Skip slots overwritten or never completed
+                if (event.sequence.load(std::memory_order_acquire) == index + 1)
+                    formatEvent(event);
+                index++;
+            }
+            break;
+        case Phase::Close:
+            pendingLength = strlcpy(pending, "]}", sizeof(pending));
+            phase = Phase::Done;
+            break;
+        case Phase::Done:
+            return written;
+        }
+    }
+    return written;
+}
+
+// One event into pending[], after the thread_name metadata of its task the first time it appears
+void TraceExport::formatEvent(const TraceBuffer::Event &event)
+{
+    if (!haveOrigin)
+    {
+        origin = event.timestampUs;
+        haveOrigin = true;
+    }
+
+    unsigned long tid = (unsigned long)(uintptr_t)event.task;
+    bool named = false;
+    for (int i = 0; i < namedTaskCount && !named; ++i)
+        named = namedTasks[i] == event.task;
+
+    int length = 0;
+    if (!named && namedTaskCount < MAX_NAMED_TASKS)
+    {
+        namedTasks[namedTaskCount++] = event.task;
+        length = snprintf(pending, sizeof(pending), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                          first ? "" : ",", tid, pcTaskGetName(event.task));
+        first = false;
+    }
+    if (length < 0 || (size_t)length >= sizeof(pending))
+        length = 0;
+
+    int eventLength = snprintf(pending + length, sizeof(pending) - length, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%lu%s}",
+                               first ? "" : ",", event.name, event.phase, (unsigned long)(event.timestampUs - origin), tid,
+                               event.phase == 'i' ? ",\"s\":\"g\"" : "");
+    if (eventLength < 0 || (size_t)eventLength >= sizeof(pending) - length)
+    {
+        pendingLength = length; // a name too long for the buffer drops the event, not the JSON
+        return;
+    }
+    pendingLength = length + eventLength;
+    first = false;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Timeline trace of begin/end and instant events in a fixed RAM ring, exported
+// in Chrome trace-event format (open in Perfetto or chrome://tracing).
+//
+// - arm() starts recording; the ring keeps the newest EVENT_CAPACITY events.
+// - trigger() (manual, or a late relay pulse / missed control deadline when
+//   enabled) records postTriggerEvents more events and then freezes the ring,
+//   so the download shows what led up to the trigger.
+// - Recording is lock-free: each writer claims a slot with one atomic
+//   increment and publishes it with a sequence number, so it is safe from
+//   both cores and from the esp_timer callback. Event names must be string
+//   literals or otherwise outlive the capture.
+// - Each event carries the FreeRTOS task that recorded it; the export shows
+//   one track per task, named after it.
+class TraceBuffer
+{
+public:
+    enum class State
+    {
+        Idle = 0,
+        Armed = 1,
+        Triggered = 2, // recording the post-trigger events
+        Frozen = 3
+    };
+
+    struct TriggerConfig
+    {
+        unsigned long relayErrorUs; // trigger when a relay pulse misses its on-time by more, 0 = off
+        bool missedDeadline;        // trigger when a control task misses a deadline
+        uint32_t postTriggerEvents; // events kept after the trigger
+    };
+
+    static const uint32_t EVENT_CAPACITY = 1024; // power of two
+
+    static void arm(const TriggerConfig &config);
+    static void trigger(const char *reason);
+    static void stop();
+
+    static void begin(const char *name) { record(name, 'B'); }
+    static void end(const char *name) { record(name, 'E'); }
+    static void instant(const char *name) { record(name, 'i'); }
+
+    // Built-in trigger checks, cheap when not armed
+    static void checkRelayError(long errorUs);
+    static void checkMissedDeadline();
+
+    static State getState() { return state.load(std::memory_order_acquire); }
+    static const char *GetStateName(State state);
+    static const char *getTriggerReason() { return triggerReason; }
+    static uint32_t getEventCount();
+    static TriggerConfig getConfig() { return config; }
+
+private:
+    friend class TraceExport;
+
+    struct Event
+    {
+        std::atomic<uint32_t> sequence; // index + 1 once the slot is complete
+        uint32_t timestampUs;
+        const char *name;
+        TaskHandle_t task; // recording task, the Chrome trace tid
+        char phase;
+    };
+
+    static Event events[EVENT_CAPACITY];
+    static std::atomic<uint32_t> writeIndex;
+    static std::atomic<uint32_t> stopIndex;
+    static std::atomic<State> state;
+    static TriggerConfig config;
+    static const char *volatile triggerReason;
+
+    static void record(const char *name, char phase);
+};
+
+// The captured events as Chrome trace JSON, a piece at a time, so the
+// download can be sent with chunked transfer encoding. Events are formatted
+// as they are read from the ring through a small fixed buffer; memory use is
+// the object itself whatever the number of events. Only valid while the
+// buffer is not recording.
+class TraceExport
+{
+public:
+    TraceExport();
+
+    bool isValid() const { return phase != Phase::Done; }
+
+    // Copy up to maxLength bytes of the trace into buffer; 0 once it is complete
+    size_t read(uint8_t *buffer, size_t maxLength);
+
+private:
+    static const int MAX_NAMED_TASKS = 16;
+
+    enum class Phase
+    {
+        Open,
+        Events,
+        Close,
+        Done
+    };
+
+    Phase phase;
+    uint32_t index; // next ring index to read
+    uint32_t end;
+    uint32_t origin; // timestamps are the low 32 bits of esp_timer; offsets from the oldest event survive the wrap
+    bool haveOrigin;
+    bool first;
+
+    // Tasks already given a thread_name metadata event
+    TaskHandle_t namedTasks[MAX_NAMED_TASKS];
+    int namedTaskCount;
+
+    char pending[256]; // formatted output not yet handed out
+    size_t pendingLength;
+    size_t pendingPos;
+
+    void formatEvent(const TraceBuffer::Event &event);
+};
+
+// Begin/end pair around the enclosing block
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : name(name) { TraceBuffer::begin(name); }
+    ~TraceScope() { TraceBuffer::end(name); }
+
+private:
+    const char *name;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
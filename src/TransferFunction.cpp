@@ -0,0 +1,163 @@
+#include <Arduino.h>
+#include "TransferFunction.h"
+#include "SmokerControl.h"
+
+static CompiledCurve augerCurve;
+static CompiledCurve fanCurve;
+static volatile bool curvesStale = true;
+
+CompiledCurve::CompiledCurve()
+    : valid(false),
+      segmentCount(0),
+      cellCount(0),
+      inputMin(0.0f),
+      inputMax(0.0f),
+      invCellWidth(0.0f)
+{
+}
+
+bool CompiledCurve::compile(const float points[][2], int count, int inputColumn, int outputColumn)
+{
+    valid = false;
+    if (count < 2 || count > MAX_POINTS)
+        return false;
+
+    float minWidth = points[count - 1][inputColumn] - points[0][inputColumn];
+    for (int i = 0; i < count - 1; ++i)
+    {
+        float width = points[i + 1][inputColumn] - points[i][inputColumn];
+        if (!(width > 0.0f))
+        {
+            Serial.println("Transfer function inputs are not strictly increasing, using linear search");
+            return false;
+        }
+        if (width < minWidth)
+            minWidth = width;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        x[i] = points[i][inputColumn];
+        y[i] = points[i][outputColumn];
+    }
+    for (int i = 0; i < count - 1; ++i)
+    {
+        slope[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+    }
+    segmentCount = count - 1;
+    inputMin = x[0];
+    inputMax = x[count - 1];
+
+    // Cells no wider than the narrowest segment hold at most one breakpoint
+    float range = inputMax - inputMin;
+    cellCount = (int)ceilf(range / minWidth);
+    cellCount = constrain(cellCount, 1, MAX_CELLS);
+    invCellWidth = cellCount / range;
+
+    int segment = 0;
+    for (int c = 0; c < cellCount; ++c)
+    {
+        float cellStart = inputMin + c / invCellWidth;
+        while (segment < segmentCount - 1 && cellStart >= x[segment + 1])
+            segment++;
+        cellSegment[c] = (unsigned char)segment;
+    }
+
+    valid = true;
+    return true;
+}
+
+float CompiledCurve::evaluate(float input) const
+{
+    if (input <= inputMin)
+        return y[0];
+    if (input >= inputMax)
+        return y[segmentCount];
+
+    int cell = (int)((input - inputMin) * invCellWidth);
+    if (cell >= cellCount)
+        cell = cellCount - 1;
+
+    int segment = cellSegment[cell];
+    // Float rounding at a cell edge can land one segment late
+    if (segment > 0 && input < x[segment])
+        segment--;
+    // Normally runs at most once; only loops if MAX_CELLS capped the resolution
+    while (segment < segmentCount - 1 && input > x[segment + 1])
+        segment++;
+
+    return y[segment] + (input - x[segment]) * slope[segment];
+}
+
+void InvalidateTransferFunctions()
+{
+    curvesStale = true;
+}
+
+// Rebuild both curves from smokerConfig if something changed them.
+// Column 1 (temperature / smoke level) is the input, column 0 the duty cycle.
+static void compileIfStale()
+{
+    if (!curvesStale)
+        return;
+    curvesStale = false;
+
+    augerCurve.compile(smokerConfig.tunable.augerTransferFunc, 11, 1, 0);
+    fanCurve.compile(smokerConfig.tunable.fanTransferFunc, 11, 1, 0);
+}
+
+static float interpolateRaw(const float points[][2], float input)
+{
+    float inputArray[11];
+    float outputArray[11];
+    for (int i = 0; i < 11; i++)
+    {
+        outputArray[i] = points[i][0];
+        inputArray[i] = points[i][1];
+    }
+    return lookupTableInterpolate(input, inputArray, outputArray, 11);
+}
+
+float EvaluateAugerTransferFunction(float setpoint)
+{
+    compileIfStale();
+    if (!augerCurve.isValid())
+        return interpolateRaw(smokerConfig.tunable.augerTransferFunc, setpoint);
+    return augerCurve.evaluate(setpoint);
+}
+
+float EvaluateFanTransferFunction(float smokesetpoint)
+{
+    compileIfStale();
+    if (!fanCurve.isValid())
+        return interpolateRaw(smokerConfig.tunable.fanTransferFunc, smokesetpoint);
+    return fanCurve.evaluate(smokesetpoint);
+}
+
+float lookupTableInterpolate(float inputValue, const float *inputArray, const float *outputArray, int arraySize)
+{
+    if (arraySize <= 0)
+        return 0.0;
+    if (arraySize == 1)
+        return outputArray[0];
+
+    if (inputValue <= inputArray[0])
+        return outputArray[0];
+    if (inputValue >= inputArray[arraySize - 1])
+        return outputArray[arraySize - 1];
+
+    for (int i = 0; i < arraySize - 1; i++)
+    {
+        if (inputValue >= inputArray[i] && inputValue <= inputArray[i + 1])
+        {
+            float x1 = inputArray[i];
+            float x2 = inputArray[i + 1];
+            float y1 = outputArray[i];
+            float y2 = outputArray[i + 1];
+
+            return y1 + (inputValue - x1) * (y2 - y1) / (x2 - x1);
+        }
+    }
+
+    return outputArray[arraySize - 1];
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Piecewise-linear curve compiled from a transfer function table for
+// constant-time evaluation. The input axis is split into uniform cells no
+// wider than the narrowest segment, so a cell maps straight to its segment
+// and at most one breakpoint has to be checked per lookup.
+class CompiledCurve
+{
+public:
+    static const int MAX_POINTS = 11;
+    static const int MAX_CELLS = 128;
+
+    CompiledCurve();
+
+    // Compile points[i][inputColumn] -> points[i][outputColumn].
+    // Inputs must be strictly increasing; on failure the curve is left invalid.
+    bool compile(const float points[][2], int count, int inputColumn, int outputColumn);
+
+    // Interpolated output, clamped to the end points outside the table
+    float evaluate(float input) const;
+
+    bool isValid() const { return valid; }
+
+private:
+    bool valid;
+    int segmentCount;
+    int cellCount;
+    float inputMin;
+    float inputMax;
+    float invCellWidth;
+    float x[MAX_POINTS];
+    float y[MAX_POINTS];
+    float slope[MAX_POINTS];
+    unsigned char cellSegment[MAX_CELLS];
+};
+
+// Mark the compiled auger/fan curves stale; call after changing
+// smokerConfig.tunable.augerTransferFunc or fanTransferFunc
+void InvalidateTransferFunctions();
+
+// Auger duty % for a chamber temperature setpoint (F)
+float EvaluateAugerTransferFunction(float setpoint);
+
+// Fan duty % for a smoke setpoint (%)
+float EvaluateFanTransferFunction(float smokesetpoint);
+
+// Reference linear-scan interpolation, used when a table fails validation
+float lookupTableInterpolate(float inputValue, const float *inputArray, const float *outputArray, int arraySize);
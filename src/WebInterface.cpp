@@ -2,10 +2,27 @@
 #include <SPIFFS.h>
 #include <functional>
 #include "DataLogger.h"
-
-WebInterface::WebInterface(uint16_t port) : server(new WebServer(port)), ownsServer(true) {}
-
+#include "SensorHealth.h"
+#include "TransferFunction.h"
+#include "SignalFilter.h"
+#include "RelayScheduler.h"
+#include "RelayDriver.h"
+#include "PelletFeed.h"
+#include "Autotuner.h"
+#include "SharedState.h"
+#include "TaskScheduler.h"
+#include "Profiler.h"
+#include "TraceBuffer.h"
+#include "Telemetry.h"
+#include "LogDataStream.h"
+#include <memory>
+#include <limits.h>
+
+WebInterface::WebInterface(uint16_t port) : server(new HttpServer(port)), ownsServer(true) {}
+
+#ifndef SMOKER_ASYNC_WEB
 WebInterface::WebInterface(WebServer &existingServer) : server(&existingServer), ownsServer(false) {}
+#endif
 
 WebInterface::~WebInterface()
 {
@@ -17,34 +34,108 @@ WebInterface::~WebInterface()
     }
 }
 
+// Every handler is traced under its URI. Handlers that touch smokerData/smokerConfig
+// take the shared-state lock themselves, only around the reads and writes of that
+// state: parsing, SPIFFS and the reply happen after it is released.
+void WebInterface::route(const char *uri, HTTPMethod method, void (WebInterface::*handler)())
+{
+    server->on(uri, method, [this, uri, handler]()
+    {
+        TRACE_SCOPE(uri);
+        (this->*handler)();
+    });
+}
+
+// Save a copy of the config taken under the shared-state lock, so the control
+// task never waits for the flash write
+static void saveConfig()
+{
+    static SmokerConfig config; // handlers run one at a time, and it is too big for their stack
+    {
+        SharedStateLock lock;
+        config = smokerConfig;
+    }
+    SaveConfigToSPIFFS(config);
+}
+
+// 200 response with chunked transfer encoding, filled piece by piece until the filler returns 0
+void WebInterface::sendChunked(const char *contentType, ChunkFiller filler)
+{
+#ifdef SMOKER_ASYNC_WEB
+    server->sendChunked(200, contentType, filler);
+#else
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, contentType, "");
+    size_t length;
+    while ((length = filler(chunkBuffer, sizeof(chunkBuffer))) > 0)
+    {
+        server->sendContent((const char *)chunkBuffer, length);
+    }
+    server->sendContent("");
+#endif
+}
+
 void WebInterface::begin()
 {
-    server->on("/", HTTP_GET, std::bind(&WebInterface::handleRoot, this));
-    server->on("/api/status", HTTP_GET, std::bind(&WebInterface::handleGetStatus, this));
-    server->on("/api/operating/setpoint", HTTP_POST, std::bind(&WebInterface::handleSetSetpoint, this));
-    server->on("/api/operating/smokesetpoint", HTTP_POST, std::bind(&WebInterface::handleSetSmokeSetpoint, this));
-    server->on("/api/tunable", HTTP_GET, std::bind(&WebInterface::handleGetTunableParams, this));
-    server->on("/api/tunable", HTTP_POST, std::bind(&WebInterface::handleSetTunableParams, this));
-    server->on("/api/recipe", HTTP_GET, std::bind(&WebInterface::handleGetRecipeState, this));
-    server->on("/api/recipe", HTTP_POST, std::bind(&WebInterface::handleSetRecipeState, this));
-    server->on("/api/buttons", HTTP_GET, std::bind(&WebInterface::handleGetButtons, this));
-    server->on("/api/buttons", HTTP_POST, std::bind(&WebInterface::handleSetButton, this));
-    server->on("/api/actuators", HTTP_GET, std::bind(&WebInterface::handleGetActuatorValues, this));
-    server->on("/api/actuators", HTTP_POST, std::bind(&WebInterface::handleSetActuatorValues, this));
-    server->on("/api/config/download", HTTP_GET, std::bind(&WebInterface::handleDownloadConfig, this));
-    server->on("/api/config/upload", HTTP_POST, std::bind(&WebInterface::handleUploadConfig, this));
-    server->on("/api/reboot", HTTP_POST, std::bind(&WebInterface::handleReboot, this));
-    server->on("/api/spiffs/list", HTTP_GET, std::bind(&WebInterface::handleSPIFFSList, this));
-    server->on("/api/spiffs/download", HTTP_GET, std::bind(&WebInterface::handleSPIFFSDownload, this));
-    server->on("/api/spiffs/upload", HTTP_POST, std::bind(&WebInterface::handleSPIFFSUpload, this));
-    server->on("/api/spiffs/delete", HTTP_POST, std::bind(&WebInterface::handleSPIFFSDelete, this));
-    server->on("/api/logging/config", HTTP_GET, std::bind(&WebInterface::handleGetLoggingConfig, this));
-    server->on("/api/logging/config", HTTP_POST, std::bind(&WebInterface::handleSetLoggingConfig, this));
-    server->on("/api/logging/clear", HTTP_POST, std::bind(&WebInterface::handleClearLogs, this));
-    server->on("/api/logging/download", HTTP_GET, std::bind(&WebInterface::handleDownloadLog, this));
-    server->on("/api/logging/data", HTTP_GET, std::bind(&WebInterface::handleGetLogData, this));
+    statusCache.begin();
+
+    route("/", HTTP_GET, &WebInterface::handleRoot);
+    route("/api/status", HTTP_GET, &WebInterface::handleGetStatus);
+#ifndef SMOKER_ASYNC_WEB
+    route("/api/events", HTTP_GET, &WebInterface::handleEvents); // the async server has its own event source
+#endif
+    route("/api/operating/setpoint", HTTP_POST, &WebInterface::handleSetSetpoint);
+    route("/api/operating/smokesetpoint", HTTP_POST, &WebInterface::handleSetSmokeSetpoint);
+    route("/api/tunable", HTTP_GET, &WebInterface::handleGetTunableParams);
+    route("/api/tunable", HTTP_POST, &WebInterface::handleSetTunableParams);
+    route("/api/recipe", HTTP_GET, &WebInterface::handleGetRecipeState);
+    route("/api/recipe", HTTP_POST, &WebInterface::handleSetRecipeState);
+    route("/api/buttons", HTTP_GET, &WebInterface::handleGetButtons);
+    route("/api/buttons", HTTP_POST, &WebInterface::handleSetButton);
+    route("/api/actuators", HTTP_GET, &WebInterface::handleGetActuatorValues);
+    route("/api/actuators", HTTP_POST, &WebInterface::handleSetActuatorValues);
+    route("/api/outputs/timing", HTTP_GET, &WebInterface::handleGetOutputTiming);
+    route("/api/outputs/timing/reset", HTTP_POST, &WebInterface::handleResetOutputTiming);
+    route("/api/outputs/stats", HTTP_GET, &WebInterface::handleGetOutputStats);
+    route("/api/scheduler", HTTP_GET, &WebInterface::handleGetSchedulerStats);
+    route("/api/scheduler/reset", HTTP_POST, &WebInterface::handleResetSchedulerStats);
+    route("/api/profile", HTTP_GET, &WebInterface::handleGetProfile);
+    route("/api/profile/reset", HTTP_POST, &WebInterface::handleResetProfile);
+    route("/api/trace", HTTP_GET, &WebInterface::handleGetTrace);
+    route("/api/trace", HTTP_POST, &WebInterface::handleSetTrace);
+    route("/api/trace/download", HTTP_GET, &WebInterface::handleDownloadTrace);
+    route("/api/auger/feed", HTTP_GET, &WebInterface::handleGetPelletFeed);
+    route("/api/auger/feed", HTTP_POST, &WebInterface::handleSetPelletFeed);
+    route("/api/auger/calibrate", HTTP_POST, &WebInterface::handleAugerCalibration);
+    route("/api/autotune", HTTP_GET, &WebInterface::handleGetAutotune);
+    route("/api/autotune", HTTP_POST, &WebInterface::handleSetAutotune);
+    route("/api/config/download", HTTP_GET, &WebInterface::handleDownloadConfig);
+    route("/api/config/upload", HTTP_POST, &WebInterface::handleUploadConfig);
+    route("/api/reboot", HTTP_POST, &WebInterface::handleReboot);
+    route("/api/spiffs/list", HTTP_GET, &WebInterface::handleSPIFFSList);
+    route("/api/spiffs/download", HTTP_GET, &WebInterface::handleSPIFFSDownload);
+#ifdef SMOKER_ASYNC_WEB
+    // The body goes to the file as it arrives, however big (index.html is ~65 KB)
+    server->onUpload("/api/spiffs/upload", [this]()
+    {
+        TRACE_SCOPE("/api/spiffs/upload");
+        handleSPIFFSUpload();
+    });
+#else
+    route("/api/spiffs/upload", HTTP_POST, &WebInterface::handleSPIFFSUpload);
+#endif
+    route("/api/spiffs/delete", HTTP_POST, &WebInterface::handleSPIFFSDelete);
+    route("/api/logging/config", HTTP_GET, &WebInterface::handleGetLoggingConfig);
+    route("/api/logging/config", HTTP_POST, &WebInterface::handleSetLoggingConfig);
+    route("/api/logging/clear", HTTP_POST, &WebInterface::handleClearLogs);
+    route("/api/logging/download", HTTP_GET, &WebInterface::handleDownloadLog);
+    route("/api/logging/data", HTTP_GET, &WebInterface::handleGetLogData);
     server->onNotFound(std::bind(&WebInterface::handleNotFound, this));
 
+    // Needed for the /api/status ETag check
+    const char *headerKeys[] = {"If-None-Match"};
+    server->collectHeaders(headerKeys, 1);
+
     server->begin();
     Serial.println("Web server started");
 }
@@ -61,6 +152,7 @@ void WebInterface::stop()
 
 void WebInterface::handleRoot()
 {
+    PROFILE_SCOPE("web.root");
     if (SPIFFS.exists("/index.html"))
     {
         File file = SPIFFS.open("/index.html", "r");
@@ -73,32 +165,215 @@ void WebInterface::handleRoot()
     }
 }
 
+// Served from the cached serialization of the control task's published snapshot;
+// polls that already have the current version get a 304 without a body
 void WebInterface::handleGetStatus()
 {
-    StaticJsonDocument<512> doc;
+    PROFILE_SCOPE("web.status");
+    StatusCache::Lock lock(statusCache);
+    statusCache.refresh();
 
-    doc["smokeChamberTemp"] = smokerData.filteredSmokeChamberTemp;
-    doc["firePotTemp"] = smokerData.filteredFirePotTemp;
+    server->sendHeader("ETag", statusCache.getETag());
+    server->sendHeader("Cache-Control", "no-cache");
+    if (server->hasHeader("If-None-Match") && statusCache.matches(server->header("If-None-Match")))
+    {
+        server->send(304);
+        return;
+    }
+    server->send_P(200, "application/json", statusCache.getJson(), statusCache.getLength());
+}
 
-    doc["operating"]["setpoint"] = smokerConfig.operating.setpoint;
-    doc["operating"]["smokesetpoint"] = smokerConfig.operating.smokesetpoint;
-    doc["operating"]["activeState"] = smokerConfig.operating.activeState;
+#ifndef SMOKER_ASYNC_WEB
+// Open an event stream. The response headers are written straight to the socket and a
+// copy of the client is kept, so the connection outlives this request.
+void WebInterface::handleEvents()
+{
+    EventClient *slot = nullptr;
+    for (int i = 0; i < MAX_EVENT_CLIENTS; ++i)
+    {
+        if (!eventClients[i].active)
+        {
+            slot = &eventClients[i];
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        // EventSource gives up on a 503 and the UI falls back to polling
+        server->send(503, "application/json", "{\"status\":\"too many event clients\"}");
+        return;
+    }
 
-    doc["igniterMode"] = static_cast<int>(smokerData.igniter.mode);
-    doc["augerMode"] = static_cast<int>(smokerData.auger.mode);
-    doc["augerDutyCycle"] = smokerData.auger.dutyCycle;
-    doc["augerFrequency"] = smokerData.auger.frequency;
-    doc["fanMode"] = static_cast<int>(smokerData.fan.mode);
-    doc["fanDutyCycle"] = smokerData.fan.dutyCycle;
-    doc["fanFrequency"] = smokerData.fan.frequency;
+    unsigned long intervalMs = EVENT_DEFAULT_INTERVAL_MS;
+    if (server->hasArg("intervalMs"))
+    {
+        intervalMs = constrain(server->arg("intervalMs").toInt(), (long)EVENT_MIN_INTERVAL_MS, 60000L);
+    }
 
-    String response;
-    serializeJson(doc, response);
-    server->send(200, "application/json", response);
+    WiFiClient client = server->client();
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/event-stream\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\n"
+                 "\r\n"
+                 "retry: 3000\n\n");
+
+    slot->client = client;
+    slot->active = true;
+    slot->intervalMs = intervalMs;
+    slot->lastStatusMs = 0;
+    slot->lastWriteMs = millis();
+    slot->sentVersion = 0; // first status goes out on the next push
+}
+
+bool WebInterface::writeEvent(EventClient &subscriber, const char *event, const char *data, size_t length)
+{
+    String header = "event: ";
+    header += event;
+    header += "\ndata: ";
+    bool ok = subscriber.client.print(header) == header.length() &&
+              subscriber.client.write((const uint8_t *)data, length) == length &&
+              subscriber.client.print("\n\n") == 2;
+    if (!ok)
+    {
+        subscriber.client.stop();
+        subscriber.active = false;
+        return false;
+    }
+    subscriber.lastWriteMs = millis();
+    return true;
+}
+
+void WebInterface::broadcastEvent(const char *event, const char *data)
+{
+    size_t length = strlen(data);
+    for (int i = 0; i < MAX_EVENT_CLIENTS; ++i)
+    {
+        if (eventClients[i].active)
+        {
+            writeEvent(eventClients[i], event, data, length);
+        }
+    }
+}
+#else
+void WebInterface::broadcastEvent(const char *event, const char *data)
+{
+    // Queued per subscriber and sent by the AsyncTCP task
+    server->events().send(data, event, millis());
+}
+#endif
+
+void WebInterface::broadcastAlarm(const char *alarm, bool active)
+{
+    char data[64];
+    snprintf(data, sizeof(data), "{\"alarm\":\"%s\",\"active\":%s}", alarm, active ? "true" : "false");
+    broadcastEvent("alarm", data);
+}
+
+void WebInterface::pushEvents()
+{
+#ifndef SMOKER_ASYNC_WEB
+    bool anyClient = false;
+    for (int i = 0; i < MAX_EVENT_CLIENTS; ++i)
+    {
+        if (eventClients[i].active && !eventClients[i].client.connected())
+        {
+            eventClients[i].client.stop();
+            eventClients[i].active = false;
+        }
+        anyClient |= eventClients[i].active;
+    }
+#else
+    bool anyClient = server->events().count() > 0;
+#endif
+
+    // State transitions and alarms go out immediately, they are rare and not rate limited
+    uint32_t version = Telemetry::getVersion();
+    if (version != eventVersion)
+    {
+        eventVersion = version;
+        TelemetrySnapshot snapshot;
+        Telemetry::read(snapshot);
+
+        if (strcmp(snapshot.activeState, eventState) != 0)
+        {
+            strlcpy(eventState, snapshot.activeState, sizeof(eventState));
+            char data[64];
+            snprintf(data, sizeof(data), "{\"activeState\":\"%s\"}", eventState);
+            broadcastEvent("state", data);
+        }
+        if (snapshot.smokeChamberSensor.valid != eventSmokeChamberValid)
+        {
+            eventSmokeChamberValid = snapshot.smokeChamberSensor.valid;
+            broadcastAlarm("smokeChamberSensor", !eventSmokeChamberValid);
+        }
+        if (snapshot.firePotSensor.valid != eventFirePotValid)
+        {
+            eventFirePotValid = snapshot.firePotSensor.valid;
+            broadcastAlarm("firePotSensor", !eventFirePotValid);
+        }
+        if (snapshot.reigniteAttempts > eventReigniteAttempts)
+        {
+            broadcastAlarm("flameout", true);
+        }
+        eventReigniteAttempts = snapshot.reigniteAttempts;
+    }
+
+    if (!anyClient)
+    {
+        return;
+    }
+
+    unsigned long now = millis();
+#ifndef SMOKER_ASYNC_WEB
+    for (int i = 0; i < MAX_EVENT_CLIENTS; ++i)
+    {
+        EventClient &subscriber = eventClients[i];
+        if (!subscriber.active)
+        {
+            continue;
+        }
+
+        if (subscriber.sentVersion != version && now - subscriber.lastStatusMs >= subscriber.intervalMs)
+        {
+            StatusCache::Lock lock(statusCache);
+            statusCache.refresh();
+            if (writeEvent(subscriber, "status", statusCache.getJson(), statusCache.getLength()))
+            {
+                subscriber.sentVersion = statusCache.getVersion();
+                subscriber.lastStatusMs = now;
+            }
+        }
+        else if (now - subscriber.lastWriteMs >= EVENT_KEEPALIVE_MS)
+        {
+            // SSE comment line, keeps proxies from closing the stream and detects dead peers
+            if (subscriber.client.print(": keepalive\n\n") != 14)
+            {
+                subscriber.client.stop();
+                subscriber.active = false;
+            }
+            else
+            {
+                subscriber.lastWriteMs = now;
+            }
+        }
+    }
+#else
+    // One rate for all subscribers; the status JSON changes every tick, so no keepalive is needed
+    if (eventSentVersion != version && now - eventLastStatusMs >= EVENT_DEFAULT_INTERVAL_MS)
+    {
+        StatusCache::Lock lock(statusCache);
+        statusCache.refresh();
+        broadcastEvent("status", statusCache.getJson());
+        eventSentVersion = statusCache.getVersion();
+        eventLastStatusMs = now;
+    }
+#endif
 }
 
 void WebInterface::handleSetSetpoint()
 {
+    PROFILE_SCOPE("web.setSetpoint");
     if (server->hasArg("plain"))
     {
         StaticJsonDocument<256> doc;
@@ -109,8 +384,11 @@ void WebInterface::handleSetSetpoint()
                 float newSetpoint = doc["setpoint"].as<float>();
                 if (newSetpoint > 0)
                 {
-                    smokerConfig.operating.setpoint = newSetpoint;
-                    SaveConfigToSPIFFS(smokerConfig);
+                    {
+                        SharedStateLock lock;
+                        smokerConfig.operating.setpoint = newSetpoint;
+                    }
+                    saveConfig();
                     server->send(200, "application/json", "{\"status\":\"ok\"}");
                     return;
                 }
@@ -132,8 +410,11 @@ void WebInterface::handleSetSmokeSetpoint()
                 float newSmokeSetpoint = doc["smokesetpoint"].as<float>();
                 if (newSmokeSetpoint >= 0)
                 {
-                    smokerConfig.operating.smokesetpoint = newSmokeSetpoint;
-                    SaveConfigToSPIFFS(smokerConfig);
+                    {
+                        SharedStateLock lock;
+                        smokerConfig.operating.smokesetpoint = newSmokeSetpoint;
+                    }
+                    saveConfig();
                     server->send(200, "application/json", "{\"status\":\"ok\"}");
                     return;
                 }
@@ -145,33 +426,51 @@ void WebInterface::handleSetSmokeSetpoint()
 
 void WebInterface::handleGetTunableParams()
 {
+    PROFILE_SCOPE("web.getTunable");
     StaticJsonDocument<2048> doc;
+    {
+        SharedStateLock lock;
+        doc["minAutoRestartTemp"] = smokerConfig.tunable.minAutoRestartTemp;
+        doc["minIdleTemp"] = smokerConfig.tunable.minIdleTemp;
+        doc["firePotBurningTemp"] = smokerConfig.tunable.firePotBurningTemp;
+        doc["startupFillTime"] = smokerConfig.tunable.startupFillTime;
+        doc["igniterPreheatTime"] = smokerConfig.tunable.igniterPreheatTime;
+        doc["stabilizeTime"] = smokerConfig.tunable.stabilizeTime;
+        doc["augerFrequency_Auto"] = smokerConfig.tunable.augerFrequency;
+        doc["fanfrequency_Auto"] = smokerConfig.tunable.fanFrequency;
+        doc["augerKp"] = smokerConfig.tunable.augerKp;
+        doc["augerKi"] = smokerConfig.tunable.augerKi;
+        doc["augerKd"] = smokerConfig.tunable.augerKd;
+        doc["augerGramsPerSecond"] = smokerConfig.tunable.augerGramsPerSecond;
+
+        // Add auger transfer function
+        JsonArray augerTransfer = doc.createNestedArray("augerTransferFunc");
+        for (int i = 0; i < 11; ++i)
+        {
+            JsonArray point = augerTransfer.createNestedArray();
+            point.add(smokerConfig.tunable.augerTransferFunc[i][0]);
+            point.add(smokerConfig.tunable.augerTransferFunc[i][1]);
+        }
 
-    doc["minAutoRestartTemp"] = smokerConfig.tunable.minAutoRestartTemp;
-    doc["minIdleTemp"] = smokerConfig.tunable.minIdleTemp;
-    doc["firePotBurningTemp"] = smokerConfig.tunable.firePotBurningTemp;
-    doc["startupFillTime"] = smokerConfig.tunable.startupFillTime;
-    doc["igniterPreheatTime"] = smokerConfig.tunable.igniterPreheatTime;
-    doc["stabilizeTime"] = smokerConfig.tunable.stabilizeTime;
-    doc["augerFrequency_Auto"] = smokerConfig.tunable.augerFrequency;
-    doc["fanfrequency_Auto"] = smokerConfig.tunable.fanFrequency;
+        // Add fan transfer function
+        JsonArray fanTransfer = doc.createNestedArray("fanTransferFunc");
+        for (int i = 0; i < 11; ++i)
+        {
+            JsonArray point = fanTransfer.createNestedArray();
+            point.add(smokerConfig.tunable.fanTransferFunc[i][0]);
+            point.add(smokerConfig.tunable.fanTransferFunc[i][1]);
+        }
 
-    // Add auger transfer function
-    JsonArray augerTransfer = doc.createNestedArray("augerTransferFunc");
-    for (int i = 0; i < 11; ++i)
-    {
-        JsonArray point = augerTransfer.createNestedArray();
-        point.add(smokerConfig.tunable.augerTransferFunc[i][0]);
-        point.add(smokerConfig.tunable.augerTransferFunc[i][1]);
-    }
+        // Add sensor filter settings
+        FilterChain::saveParams(doc["smokeChamberFilter"].to<JsonObject>(), smokerConfig.tunable.smokeChamberFilter);
+        FilterChain::saveParams(doc["firePotFilter"].to<JsonObject>(), smokerConfig.tunable.firePotFilter);
 
-    // Add fan transfer function
-    JsonArray fanTransfer = doc.createNestedArray("fanTransferFunc");
-    for (int i = 0; i < 11; ++i)
-    {
-        JsonArray point = fanTransfer.createNestedArray();
-        point.add(smokerConfig.tunable.fanTransferFunc[i][0]);
-        point.add(smokerConfig.tunable.fanTransferFunc[i][1]);
+        // Add flameout detection settings
+        doc["flameout"]["enabled"] = smokerConfig.tunable.flameout.enabled;
+        doc["flameout"]["slopeThreshold"] = smokerConfig.tunable.flameout.slopeThreshold;
+        doc["flameout"]["minFeedGrams"] = smokerConfig.tunable.flameout.minFeedGrams;
+        doc["flameout"]["confidence"] = smokerConfig.tunable.flameout.confidence;
+        doc["flameout"]["maxReigniteAttempts"] = smokerConfig.tunable.flameout.maxReigniteAttempts;
     }
 
     String response;
@@ -181,59 +480,97 @@ void WebInterface::handleGetTunableParams()
 
 void WebInterface::handleSetTunableParams()
 {
+    PROFILE_SCOPE("web.setTunable");
     if (server->hasArg("plain"))
     {
         StaticJsonDocument<2048> doc;
         if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
         {
-            if (doc.containsKey("minAutoRestartTemp"))
-                smokerConfig.tunable.minAutoRestartTemp = doc["minAutoRestartTemp"];
-            if (doc.containsKey("minIdleTemp"))
-                smokerConfig.tunable.minIdleTemp = doc["minIdleTemp"];
-            if (doc.containsKey("firePotBurningTemp"))
-                smokerConfig.tunable.firePotBurningTemp = doc["firePotBurningTemp"];
-            if (doc.containsKey("startupFillTime"))
-                smokerConfig.tunable.startupFillTime = doc["startupFillTime"];
-            if (doc.containsKey("igniterPreheatTime"))
-                smokerConfig.tunable.igniterPreheatTime = doc["igniterPreheatTime"];
-            if (doc.containsKey("stabilizeTime"))
-                smokerConfig.tunable.stabilizeTime = doc["stabilizeTime"];
-            if (doc.containsKey("augerFrequency_Auto"))
-                smokerConfig.tunable.augerFrequency = doc["augerFrequency_Auto"];
-            if (doc.containsKey("fanfrequency_Auto"))
-                smokerConfig.tunable.fanFrequency = doc["fanfrequency_Auto"];
-
-            // Update auger transfer function if provided
-            if (doc.containsKey("augerTransferFunc") && doc["augerTransferFunc"].is<JsonArray>())
             {
-                JsonArray augerTransfer = doc["augerTransferFunc"].as<JsonArray>();
-                for (int i = 0; i < 11 && i < augerTransfer.size(); ++i)
+                SharedStateLock lock;
+                if (doc.containsKey("minAutoRestartTemp"))
+                    smokerConfig.tunable.minAutoRestartTemp = doc["minAutoRestartTemp"];
+                if (doc.containsKey("minIdleTemp"))
+                    smokerConfig.tunable.minIdleTemp = doc["minIdleTemp"];
+                if (doc.containsKey("firePotBurningTemp"))
+                    smokerConfig.tunable.firePotBurningTemp = doc["firePotBurningTemp"];
+                if (doc.containsKey("startupFillTime"))
+                    smokerConfig.tunable.startupFillTime = doc["startupFillTime"];
+                if (doc.containsKey("igniterPreheatTime"))
+                    smokerConfig.tunable.igniterPreheatTime = doc["igniterPreheatTime"];
+                if (doc.containsKey("stabilizeTime"))
+                    smokerConfig.tunable.stabilizeTime = doc["stabilizeTime"];
+                if (doc.containsKey("augerFrequency_Auto"))
+                    smokerConfig.tunable.augerFrequency = doc["augerFrequency_Auto"];
+                if (doc.containsKey("fanfrequency_Auto"))
+                    smokerConfig.tunable.fanFrequency = doc["fanfrequency_Auto"];
+                if (doc.containsKey("augerKp"))
+                    smokerConfig.tunable.augerKp = doc["augerKp"];
+                if (doc.containsKey("augerKi"))
+                    smokerConfig.tunable.augerKi = doc["augerKi"];
+                if (doc.containsKey("augerKd"))
+                    smokerConfig.tunable.augerKd = doc["augerKd"];
+                if (doc.containsKey("augerGramsPerSecond"))
+                    smokerConfig.tunable.augerGramsPerSecond = doc["augerGramsPerSecond"];
+
+                // Update auger transfer function if provided
+                if (doc.containsKey("augerTransferFunc") && doc["augerTransferFunc"].is<JsonArray>())
                 {
-                    if (augerTransfer[i].is<JsonArray>())
+                    JsonArray augerTransfer = doc["augerTransferFunc"].as<JsonArray>();
+                    for (int i = 0; i < 11 && i < augerTransfer.size(); ++i)
                     {
-                        JsonArray point = augerTransfer[i].as<JsonArray>();
-                        smokerConfig.tunable.augerTransferFunc[i][0] = point[0];
-                        smokerConfig.tunable.augerTransferFunc[i][1] = point[1];
+                        if (augerTransfer[i].is<JsonArray>())
+                        {
+                            JsonArray point = augerTransfer[i].as<JsonArray>();
+                            smokerConfig.tunable.augerTransferFunc[i][0] = point[0];
+                            smokerConfig.tunable.augerTransferFunc[i][1] = point[1];
+                        }
                     }
                 }
-            }
 
-            // Update fan transfer function if provided
-            if (doc.containsKey("fanTransferFunc") && doc["fanTransferFunc"].is<JsonArray>())
-            {
-                JsonArray fanTransfer = doc["fanTransferFunc"].as<JsonArray>();
-                for (int i = 0; i < 11 && i < fanTransfer.size(); ++i)
+                // Update fan transfer function if provided
+                if (doc.containsKey("fanTransferFunc") && doc["fanTransferFunc"].is<JsonArray>())
                 {
-                    if (fanTransfer[i].is<JsonArray>())
+                    JsonArray fanTransfer = doc["fanTransferFunc"].as<JsonArray>();
+                    for (int i = 0; i < 11 && i < fanTransfer.size(); ++i)
                     {
-                        JsonArray point = fanTransfer[i].as<JsonArray>();
-                        smokerConfig.tunable.fanTransferFunc[i][0] = point[0];
-                        smokerConfig.tunable.fanTransferFunc[i][1] = point[1];
+                        if (fanTransfer[i].is<JsonArray>())
+                        {
+                            JsonArray point = fanTransfer[i].as<JsonArray>();
+                            smokerConfig.tunable.fanTransferFunc[i][0] = point[0];
+                            smokerConfig.tunable.fanTransferFunc[i][1] = point[1];
+                        }
                     }
                 }
+
+                // Recompile the lookup tables before the next evaluation
+                InvalidateTransferFunctions();
+
+                // Update sensor filter settings if provided
+                if (doc["smokeChamberFilter"].is<JsonObject>())
+                    FilterChain::loadParams(doc["smokeChamberFilter"], smokerConfig.tunable.smokeChamberFilter);
+                if (doc["firePotFilter"].is<JsonObject>())
+                    FilterChain::loadParams(doc["firePotFilter"], smokerConfig.tunable.firePotFilter);
+                ConfigureSensorFilters();
+
+                // Update flameout detection settings if provided
+                if (doc["flameout"].is<JsonObject>())
+                {
+                    JsonObject flameout = doc["flameout"];
+                    if (flameout.containsKey("enabled"))
+                        smokerConfig.tunable.flameout.enabled = flameout["enabled"];
+                    if (flameout.containsKey("slopeThreshold"))
+                        smokerConfig.tunable.flameout.slopeThreshold = flameout["slopeThreshold"];
+                    if (flameout.containsKey("minFeedGrams"))
+                        smokerConfig.tunable.flameout.minFeedGrams = flameout["minFeedGrams"];
+                    if (flameout.containsKey("confidence"))
+                        smokerConfig.tunable.flameout.confidence = constrain(flameout["confidence"].as<float>(), 0.05f, 1.0f);
+                    if (flameout.containsKey("maxReigniteAttempts"))
+                        smokerConfig.tunable.flameout.maxReigniteAttempts = flameout["maxReigniteAttempts"];
+                }
             }
 
-            SaveConfigToSPIFFS(smokerConfig);
+            saveConfig();
             server->send(200, "application/json", "{\"status\":\"ok\"}");
             return;
         }
@@ -244,31 +581,33 @@ void WebInterface::handleSetTunableParams()
 void WebInterface::handleGetRecipeState()
 {
     StaticJsonDocument<2048> doc;
-
-    doc["recipeStepIndex"] = smokerConfig.recipe.recipeStepIndex;
-    doc["selectedRecipeIndex"] = smokerConfig.recipe.selectedRecipeIndex;
-
-    JsonArray recipes = doc["recipes"].to<JsonArray>();
-    for (int r = 0; r < MAX_RECIPES; ++r)
     {
-        JsonObject recipe = recipes.createNestedObject();
-        recipe["index"] = r;
-        recipe["name"] = smokerConfig.recipe.recipeData[r].name;
-        recipe["enabled"] = smokerConfig.recipe.recipeData[r].enabled;
-        recipe["stepCount"] = smokerConfig.recipe.recipeData[r].stepCount;
+        SharedStateLock lock;
+        doc["recipeStepIndex"] = smokerConfig.recipe.recipeStepIndex;
+        doc["selectedRecipeIndex"] = smokerConfig.recipe.selectedRecipeIndex;
 
-        JsonArray steps = recipe["steps"].to<JsonArray>();
-        for (int s = 0; s < smokerConfig.recipe.recipeData[r].stepCount && s < MAX_RECIPE_STEPS; ++s)
+        JsonArray recipes = doc["recipes"].to<JsonArray>();
+        for (int r = 0; r < MAX_RECIPES; ++r)
         {
-            JsonObject step = steps.createNestedObject();
-            step["name"] = smokerConfig.recipe.recipeData[r].steps[s].name;
-            step["enabled"] = smokerConfig.recipe.recipeData[r].steps[s].enabled;
-            step["startTempSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint;
-            step["endTempSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint;
-            step["startSmokeSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint;
-            step["endSmokeSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint;
-            step["stepDurationMs"] = smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs;
-            step["meatProbeExitTemp"] = smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp;
+            JsonObject recipe = recipes.createNestedObject();
+            recipe["index"] = r;
+            recipe["name"] = smokerConfig.recipe.recipeData[r].name;
+            recipe["enabled"] = smokerConfig.recipe.recipeData[r].enabled;
+            recipe["stepCount"] = smokerConfig.recipe.recipeData[r].stepCount;
+
+            JsonArray steps = recipe["steps"].to<JsonArray>();
+            for (int s = 0; s < smokerConfig.recipe.recipeData[r].stepCount && s < MAX_RECIPE_STEPS; ++s)
+            {
+                JsonObject step = steps.createNestedObject();
+                step["name"] = smokerConfig.recipe.recipeData[r].steps[s].name;
+                step["enabled"] = smokerConfig.recipe.recipeData[r].steps[s].enabled;
+                step["startTempSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint;
+                step["endTempSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint;
+                step["startSmokeSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint;
+                step["endSmokeSetpoint"] = smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint;
+                step["stepDurationMs"] = smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs;
+                step["meatProbeExitTemp"] = smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp;
+            }
         }
     }
 
@@ -284,44 +623,47 @@ void WebInterface::handleSetRecipeState()
         StaticJsonDocument<2048> doc;
         if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
         {
-            if (doc.containsKey("selectedRecipeIndex"))
-            {
-                smokerConfig.recipe.selectedRecipeIndex = doc["selectedRecipeIndex"];
-            }
-            if (doc.containsKey("recipeStepIndex"))
-            {
-                smokerConfig.recipe.recipeStepIndex = doc["recipeStepIndex"];
-            }
-            if (doc.containsKey("recipes"))
             {
-                JsonArray recipes = doc["recipes"].as<JsonArray>();
-                for (int r = 0; r < MAX_RECIPES && r < recipes.size(); ++r)
+                SharedStateLock lock;
+                if (doc.containsKey("selectedRecipeIndex"))
                 {
-                    JsonObject recipe = recipes[r];
-                    strlcpy(smokerConfig.recipe.recipeData[r].name, recipe["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].name));
-                    smokerConfig.recipe.recipeData[r].enabled = recipe["enabled"];
-                    smokerConfig.recipe.recipeData[r].stepCount = recipe["stepCount"];
-
-                    if (recipe.containsKey("steps"))
+                    smokerConfig.recipe.selectedRecipeIndex = doc["selectedRecipeIndex"];
+                }
+                if (doc.containsKey("recipeStepIndex"))
+                {
+                    smokerConfig.recipe.recipeStepIndex = doc["recipeStepIndex"];
+                }
+                if (doc.containsKey("recipes"))
+                {
+                    JsonArray recipes = doc["recipes"].as<JsonArray>();
+                    for (int r = 0; r < MAX_RECIPES && r < recipes.size(); ++r)
                     {
-                        JsonArray steps = recipe["steps"].as<JsonArray>();
-                        for (int s = 0; s < MAX_RECIPE_STEPS && s < steps.size(); ++s)
+                        JsonObject recipe = recipes[r];
+                        strlcpy(smokerConfig.recipe.recipeData[r].name, recipe["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].name));
+                        smokerConfig.recipe.recipeData[r].enabled = recipe["enabled"];
+                        smokerConfig.recipe.recipeData[r].stepCount = recipe["stepCount"];
+
+                        if (recipe.containsKey("steps"))
                         {
-                            JsonObject step = steps[s];
-                            strlcpy(smokerConfig.recipe.recipeData[r].steps[s].name, step["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].steps[s].name));
-                            smokerConfig.recipe.recipeData[r].steps[s].enabled = step["enabled"];
-                            smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint = step["startTempSetpoint"];
-                            smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint = step["endTempSetpoint"];
-                            smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint = step["startSmokeSetpoint"];
-                            smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint = step["endSmokeSetpoint"];
-                            smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs = step["stepDurationMs"];
-                            smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp = step["meatProbeExitTemp"];
+                            JsonArray steps = recipe["steps"].as<JsonArray>();
+                            for (int s = 0; s < MAX_RECIPE_STEPS && s < steps.size(); ++s)
+                            {
+                                JsonObject step = steps[s];
+                                strlcpy(smokerConfig.recipe.recipeData[r].steps[s].name, step["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].steps[s].name));
+                                smokerConfig.recipe.recipeData[r].steps[s].enabled = step["enabled"];
+                                smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint = step["startTempSetpoint"];
+                                smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint = step["endTempSetpoint"];
+                                smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint = step["startSmokeSetpoint"];
+                                smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint = step["endSmokeSetpoint"];
+                                smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs = step["stepDurationMs"];
+                                smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp = step["meatProbeExitTemp"];
+                            }
                         }
                     }
                 }
             }
 
-            SaveConfigToSPIFFS(smokerConfig);
+            saveConfig();
             server->send(200, "application/json", "{\"status\":\"ok\"}");
             return;
         }
@@ -352,49 +694,116 @@ void WebInterface::handleUploadConfig()
         {
             if (doc.containsKey("operating") && doc.containsKey("tunable") && doc.containsKey("recipe"))
             {
-                smokerConfig.operating.setpoint = doc["operating"]["setpoint"];
-                smokerConfig.operating.smokesetpoint = doc["operating"]["smokesetpoint"];
-
-                smokerConfig.tunable.minAutoRestartTemp = doc["tunable"]["minAutoRestartTemp"];
-                smokerConfig.tunable.minIdleTemp = doc["tunable"]["minIdleTemp"];
-                smokerConfig.tunable.firePotBurningTemp = doc["tunable"]["firePotBurningTemp"];
-                smokerConfig.tunable.startupFillTime = doc["tunable"]["startupFillTime"];
-                smokerConfig.tunable.igniterPreheatTime = doc["tunable"]["igniterPreheatTime"];
-                smokerConfig.tunable.stabilizeTime = doc["tunable"]["stabilizeTime"];
-
-                smokerConfig.recipe.recipeStepIndex = doc["recipe"]["recipeStepIndex"];
-                smokerConfig.recipe.selectedRecipeIndex = doc["recipe"]["selectedRecipeIndex"];
-
-                if (doc["recipe"].containsKey("recipeData"))
                 {
-                    JsonArray recipes = doc["recipe"]["recipeData"].as<JsonArray>();
-                    for (int r = 0; r < MAX_RECIPES && r < recipes.size(); ++r)
+                    SharedStateLock lock;
+                    smokerConfig.operating.setpoint = doc["operating"]["setpoint"];
+                    smokerConfig.operating.smokesetpoint = doc["operating"]["smokesetpoint"];
+
+                    smokerConfig.tunable.minAutoRestartTemp = doc["tunable"]["minAutoRestartTemp"];
+                    smokerConfig.tunable.minIdleTemp = doc["tunable"]["minIdleTemp"];
+                    smokerConfig.tunable.firePotBurningTemp = doc["tunable"]["firePotBurningTemp"];
+                    smokerConfig.tunable.startupFillTime = doc["tunable"]["startupFillTime"];
+                    smokerConfig.tunable.igniterPreheatTime = doc["tunable"]["igniterPreheatTime"];
+                    smokerConfig.tunable.stabilizeTime = doc["tunable"]["stabilizeTime"];
+
+                    // Sections added since the first config format; files without them keep the current values
+                    JsonObject tunable = doc["tunable"];
+                    if (tunable.containsKey("augerFrequency_Auto"))
+                        smokerConfig.tunable.augerFrequency = tunable["augerFrequency_Auto"];
+                    if (tunable.containsKey("fanfrequency_Auto"))
+                        smokerConfig.tunable.fanFrequency = tunable["fanfrequency_Auto"];
+                    if (tunable["augerTransferFunc"].is<JsonArray>())
                     {
-                        JsonObject recipe = recipes[r];
-                        strlcpy(smokerConfig.recipe.recipeData[r].name, recipe["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].name));
-                        smokerConfig.recipe.recipeData[r].stepCount = recipe["stepCount"];
-                        smokerConfig.recipe.recipeData[r].enabled = recipe["enabled"];
+                        JsonArray augerTransfer = tunable["augerTransferFunc"].as<JsonArray>();
+                        for (int i = 0; i < 11 && i < augerTransfer.size(); ++i)
+                        {
+                            if (augerTransfer[i].is<JsonArray>())
+                            {
+                                JsonArray point = augerTransfer[i].as<JsonArray>();
+                                smokerConfig.tunable.augerTransferFunc[i][0] = point[0];
+                                smokerConfig.tunable.augerTransferFunc[i][1] = point[1];
+                            }
+                        }
+                    }
+                    if (tunable["fanTransferFunc"].is<JsonArray>())
+                    {
+                        JsonArray fanTransfer = tunable["fanTransferFunc"].as<JsonArray>();
+                        for (int i = 0; i < 11 && i < fanTransfer.size(); ++i)
+                        {
+                            if (fanTransfer[i].is<JsonArray>())
+                            {
+                                JsonArray point = fanTransfer[i].as<JsonArray>();
+                                smokerConfig.tunable.fanTransferFunc[i][0] = point[0];
+                                smokerConfig.tunable.fanTransferFunc[i][1] = point[1];
+                            }
+                        }
+                    }
+                    InvalidateTransferFunctions();
+
+                    if (tunable.containsKey("augerKp"))
+                        smokerConfig.tunable.augerKp = tunable["augerKp"];
+                    if (tunable.containsKey("augerKi"))
+                        smokerConfig.tunable.augerKi = tunable["augerKi"];
+                    if (tunable.containsKey("augerKd"))
+                        smokerConfig.tunable.augerKd = tunable["augerKd"];
+                    if (tunable.containsKey("augerGramsPerSecond"))
+                        smokerConfig.tunable.augerGramsPerSecond = tunable["augerGramsPerSecond"];
+
+                    if (tunable["smokeChamberFilter"].is<JsonObject>())
+                        FilterChain::loadParams(tunable["smokeChamberFilter"], smokerConfig.tunable.smokeChamberFilter);
+                    if (tunable["firePotFilter"].is<JsonObject>())
+                        FilterChain::loadParams(tunable["firePotFilter"], smokerConfig.tunable.firePotFilter);
+                    ConfigureSensorFilters();
+
+                    if (tunable["flameout"].is<JsonObject>())
+                    {
+                        JsonObject flameout = tunable["flameout"];
+                        if (flameout.containsKey("enabled"))
+                            smokerConfig.tunable.flameout.enabled = flameout["enabled"];
+                        if (flameout.containsKey("slopeThreshold"))
+                            smokerConfig.tunable.flameout.slopeThreshold = flameout["slopeThreshold"];
+                        if (flameout.containsKey("minFeedGrams"))
+                            smokerConfig.tunable.flameout.minFeedGrams = flameout["minFeedGrams"];
+                        if (flameout.containsKey("confidence"))
+                            smokerConfig.tunable.flameout.confidence = constrain(flameout["confidence"].as<float>(), 0.05f, 1.0f);
+                        if (flameout.containsKey("maxReigniteAttempts"))
+                            smokerConfig.tunable.flameout.maxReigniteAttempts = flameout["maxReigniteAttempts"];
+                    }
 
-                        if (recipe.containsKey("steps"))
+                    smokerConfig.recipe.recipeStepIndex = doc["recipe"]["recipeStepIndex"];
+                    smokerConfig.recipe.selectedRecipeIndex = doc["recipe"]["selectedRecipeIndex"];
+
+                    if (doc["recipe"].containsKey("recipeData"))
+                    {
+                        JsonArray recipes = doc["recipe"]["recipeData"].as<JsonArray>();
+                        for (int r = 0; r < MAX_RECIPES && r < recipes.size(); ++r)
                         {
-                            JsonArray steps = recipe["steps"].as<JsonArray>();
-                            for (int s = 0; s < MAX_RECIPE_STEPS && s < steps.size(); ++s)
+                            JsonObject recipe = recipes[r];
+                            strlcpy(smokerConfig.recipe.recipeData[r].name, recipe["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].name));
+                            smokerConfig.recipe.recipeData[r].stepCount = recipe["stepCount"];
+                            smokerConfig.recipe.recipeData[r].enabled = recipe["enabled"];
+
+                            if (recipe.containsKey("steps"))
                             {
-                                JsonObject step = steps[s];
-                                strlcpy(smokerConfig.recipe.recipeData[r].steps[s].name, step["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].steps[s].name));
-                                smokerConfig.recipe.recipeData[r].steps[s].enabled = step["enabled"];
-                                smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint = step["startTempSetpoint"];
-                                smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint = step["endTempSetpoint"];
-                                smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint = step["startSmokeSetpoint"];
-                                smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint = step["endSmokeSetpoint"];
-                                smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs = step["stepDurationMs"];
-                                smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp = step["meatProbeExitTemp"];
+                                JsonArray steps = recipe["steps"].as<JsonArray>();
+                                for (int s = 0; s < MAX_RECIPE_STEPS && s < steps.size(); ++s)
+                                {
+                                    JsonObject step = steps[s];
+                                    strlcpy(smokerConfig.recipe.recipeData[r].steps[s].name, step["name"] | "", sizeof(smokerConfig.recipe.recipeData[r].steps[s].name));
+                                    smokerConfig.recipe.recipeData[r].steps[s].enabled = step["enabled"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].startTempSetpoint = step["startTempSetpoint"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].endTempSetpoint = step["endTempSetpoint"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].startSmokeSetpoint = step["startSmokeSetpoint"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].endSmokeSetpoint = step["endSmokeSetpoint"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].stepDurationMs = step["stepDurationMs"];
+                                    smokerConfig.recipe.recipeData[r].steps[s].meatProbeExitTemp = step["meatProbeExitTemp"];
+                                }
                             }
                         }
                     }
                 }
 
-                SaveConfigToSPIFFS(smokerConfig);
+                saveConfig();
                 server->send(200, "application/json", "{\"status\":\"ok\"}");
                 return;
             }
@@ -477,6 +886,14 @@ void WebInterface::handleSPIFFSUpload()
     if (!path.startsWith("/"))
         path = "/" + path;
 
+#ifdef SMOKER_ASYNC_WEB
+    // Already written by the adapter as the body arrived
+    if (server->uploadedBytes() < 0)
+    {
+        server->send(500, "application/json", "{\"status\":\"cannot write file\"}");
+        return;
+    }
+#else
     if (!server->hasArg("plain"))
     {
         server->send(400, "application/json", "{\"status\":\"missing body\"}");
@@ -492,6 +909,7 @@ void WebInterface::handleSPIFFSUpload()
     }
     file.write((const uint8_t *)body.c_str(), body.length());
     file.close();
+#endif
 
     server->send(200, "application/json", "{\"status\":\"ok\"}");
 }
@@ -526,11 +944,13 @@ void WebInterface::handleSPIFFSDelete()
 void WebInterface::handleGetButtons()
 {
     StaticJsonDocument<256> doc;
-
-    doc["btn_Startup"] = uiData.btn_Startup;
-    doc["btn_Auto"] = uiData.btn_Auto;
-    doc["btn_Shutdown"] = uiData.btn_Shutdown;
-    doc["btn_Manual"] = uiData.btn_Manual;
+    {
+        SharedStateLock lock;
+        doc["btn_Startup"] = uiData.btn_Startup;
+        doc["btn_Auto"] = uiData.btn_Auto;
+        doc["btn_Shutdown"] = uiData.btn_Shutdown;
+        doc["btn_Manual"] = uiData.btn_Manual;
+    }
 
     String response;
     serializeJson(doc, response);
@@ -539,6 +959,7 @@ void WebInterface::handleGetButtons()
 
 void WebInterface::handleSetButton()
 {
+    PROFILE_SCOPE("web.setButton");
     if (server->hasArg("plain"))
     {
         StaticJsonDocument<256> doc;
@@ -549,62 +970,498 @@ void WebInterface::handleSetButton()
                 String buttonName = doc["button"];
                 bool state = doc["state"];
 
-                if (buttonName == "btn_Startup")
                 {
-                    uiData.btn_Startup = state;
+                    SharedStateLock lock;
+                    if (buttonName == "btn_Startup")
+                    {
+                        uiData.btn_Startup = state;
+                    }
+                    else if (buttonName == "btn_Auto")
+                    {
+                        uiData.btn_Auto = state;
+                    }
+                    else if (buttonName == "btn_Shutdown")
+                    {
+                        uiData.btn_Shutdown = state;
+                    }
+                    else if (buttonName == "btn_Manual")
+                    {
+                        uiData.btn_Manual = state;
+                    }
+                }
+
+                server->send(200, "application/json", "{\"status\":\"ok\"}");
+                return;
+            }
+        }
+    }
+    server->send(400, "application/json", "{\"status\":\"error\"}");
+}
+
+void WebInterface::handleGetActuatorValues()
+{
+    StaticJsonDocument<256> doc;
+    {
+        SharedStateLock lock;
+        doc["augerDutyCycle"] = smokerData.auger.dutyCycle;
+        doc["augerFrequency"] = smokerData.auger.frequency;
+        doc["fanDutyCycle"] = smokerData.fan.dutyCycle;
+        doc["fanFrequency"] = smokerData.fan.frequency;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleSetActuatorValues()
+{
+    if (server->hasArg("plain"))
+    {
+        StaticJsonDocument<256> doc;
+        if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
+        {
+            {
+                SharedStateLock lock;
+                if (doc.containsKey("augerDutyCycle"))
+                    smokerData.auger.dutyCycle = doc["augerDutyCycle"];
+                if (doc.containsKey("augerFrequency"))
+                    smokerData.auger.frequency = doc["augerFrequency"];
+                if (doc.containsKey("fanDutyCycle"))
+                    smokerData.fan.dutyCycle = doc["fanDutyCycle"];
+                if (doc.containsKey("fanFrequency"))
+                    smokerData.fan.frequency = doc["fanFrequency"];
+            }
+
+            server->send(200, "application/json", "{\"status\":\"ok\"}");
+            return;
+        }
+    }
+    server->send(400, "application/json", "{\"status\":\"error\"}");
+}
+
+void WebInterface::handleGetOutputTiming()
+{
+    StaticJsonDocument<512> doc;
+    const char *names[] = {"auger", "fan", "igniter"};
+
+    for (int i = 0; i < RelayScheduler::ChannelCount; ++i)
+    {
+        RelayScheduler::CycleStats stats = relayScheduler.getStats(static_cast<RelayScheduler::Channel>(i));
+        JsonObject channel = doc[names[i]].to<JsonObject>();
+        channel["commandedOnUs"] = stats.commandedOnUs;
+        channel["achievedOnUs"] = stats.achievedOnUs;
+        channel["lastErrorUs"] = stats.lastErrorUs;
+        channel["maxErrorUs"] = stats.maxErrorUs;
+        channel["cycles"] = stats.cycles;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleResetOutputTiming()
+{
+    relayScheduler.resetStats();
+    server->send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+void WebInterface::handleGetSchedulerStats()
+{
+    StaticJsonDocument<1536> doc;
+    JsonArray tasks = doc.createNestedArray("tasks");
+
+    for (int i = 0; i < controlScheduler.getTaskCount(); ++i)
+    {
+        TaskScheduler::TaskStats stats = controlScheduler.getStats(i);
+        JsonObject task = tasks.createNestedObject();
+        task["name"] = controlScheduler.getTaskName(i);
+        task["periodMs"] = controlScheduler.getPeriodMs(i);
+        task["priority"] = controlScheduler.getPriority(i);
+        task["budgetUs"] = controlScheduler.getBudgetUs(i);
+        task["runs"] = stats.runs;
+        task["minExecUs"] = stats.minExecUs;
+        task["maxExecUs"] = stats.maxExecUs;
+        task["meanExecUs"] = stats.meanExecUs;
+        task["maxJitterUs"] = stats.maxJitterUs;
+        task["meanJitterUs"] = stats.meanJitterUs;
+        task["missedDeadlines"] = stats.missedDeadlines;
+        task["overruns"] = stats.overruns;
+        task["lastDtMs"] = stats.lastDtMs;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleResetSchedulerStats()
+{
+    controlScheduler.resetStats();
+    server->send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+void WebInterface::handleGetProfile()
+{
+    StaticJsonDocument<6144> doc;
+    uint32_t cyclesPerUs = Profiler::cyclesPerUs();
+
+    doc["enabled"] = Profiler::isEnabled();
+    JsonArray zones = doc.createNestedArray("zones");
+    for (int i = 0; i < Profiler::getZoneCount(); ++i)
+    {
+        ProfileZone *zone = Profiler::getZone(i);
+        JsonObject z = zones.createNestedObject();
+        z["name"] = zone->name;
+        z["count"] = zone->count;
+        z["meanUs"] = zone->count ? (float)(zone->totalCycles / zone->count) / cyclesPerUs : 0.0f;
+        z["maxUs"] = zone->maxCycles / cyclesPerUs;
+
+        // log2 buckets in us, trailing empty buckets omitted
+        int last = ProfileZone::BUCKETS - 1;
+        while (last > 0 && zone->histogram[last] == 0)
+            last--;
+        JsonArray histogram = z.createNestedArray("histogram");
+        for (int b = 0; b <= last; ++b)
+            histogram.add(zone->histogram[b]);
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleResetProfile()
+{
+    Profiler::reset();
+    server->send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+void WebInterface::handleGetTrace()
+{
+    StaticJsonDocument<256> doc;
+    TraceBuffer::TriggerConfig config = TraceBuffer::getConfig();
+
+    doc["state"] = TraceBuffer::GetStateName(TraceBuffer::getState());
+    doc["triggerReason"] = TraceBuffer::getTriggerReason();
+    doc["events"] = TraceBuffer::getEventCount();
+    doc["capacity"] = TraceBuffer::EVENT_CAPACITY;
+    doc["relayErrorUs"] = config.relayErrorUs;
+    doc["missedDeadline"] = config.missedDeadline;
+    doc["postTriggerEvents"] = config.postTriggerEvents;
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleSetTrace()
+{
+    if (server->hasArg("plain"))
+    {
+        StaticJsonDocument<256> doc;
+        if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
+        {
+            String action = doc["action"] | "";
+
+            if (action == "arm")
+            {
+                TraceBuffer::TriggerConfig config = TraceBuffer::getConfig();
+                config.relayErrorUs = doc["relayErrorUs"] | config.relayErrorUs;
+                config.missedDeadline = doc["missedDeadline"] | config.missedDeadline;
+                config.postTriggerEvents = doc["postTriggerEvents"] | config.postTriggerEvents;
+                TraceBuffer::arm(config);
+            }
+            else if (action == "trigger")
+            {
+                TraceBuffer::trigger("manual");
+            }
+            else if (action == "stop")
+            {
+                TraceBuffer::stop();
+            }
+            else
+            {
+                server->send(400, "application/json", "{\"status\":\"error\"}");
+                return;
+            }
+
+            server->send(200, "application/json", "{\"status\":\"ok\"}");
+            return;
+        }
+    }
+    server->send(400, "application/json", "{\"status\":\"error\"}");
+}
+
+void WebInterface::handleDownloadTrace()
+{
+    // Events are formatted as they are sent, so the 1024-event capture never has to fit in RAM as JSON
+    std::shared_ptr<TraceExport> trace = std::make_shared<TraceExport>();
+    if (!trace->isValid())
+    {
+        server->send(409, "application/json", "{\"status\":\"trace still recording, stop it first\"}");
+        return;
+    }
+
+    server->sendHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+    sendChunked("application/json", [trace](uint8_t *buffer, size_t maxLength)
+                { return trace->read(buffer, maxLength); });
+}
+
+void WebInterface::handleGetOutputStats()
+{
+    StaticJsonDocument<512> doc;
+    const char *names[] = {"auger", "fan", "igniter"};
+
+    for (int i = 0; i < RelayDriver::RelayCount; ++i)
+    {
+        RelayDriver::RelayStats stats = RelayDriver::getStats(static_cast<RelayDriver::Relay>(i));
+        JsonObject relay = doc[names[i]].to<JsonObject>();
+        relay["transitions"] = stats.transitions;
+        relay["onTimeMs"] = stats.onTimeMs;
+        relay["longestOnMs"] = stats.longestOnMs;
+        relay["energizedMinutes"] = stats.energizedMinutes;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleGetPelletFeed()
+{
+    StaticJsonDocument<256> doc;
+    {
+        SharedStateLock lock;
+        doc["calibration"] = PelletFeed::GetCalibrationStateName(PelletFeed::getCalibrationState());
+        doc["gramsPerSecond"] = smokerConfig.tunable.augerGramsPerSecond;
+        doc["targetGramsPerMinute"] = smokerData.auger.Mass;
+        doc["massModeDutyCycle"] = PelletFeed::dutyForFeedRate(smokerData.auger.Mass);
+        doc["deliveredGrams"] = PelletFeed::getDeliveredGrams();
+    }
+
+    String response;
+    serializeJson(doc, response);
+    server->send(200, "application/json", response);
+}
+
+void WebInterface::handleSetPelletFeed()
+{
+    if (server->hasArg("plain"))
+    {
+        StaticJsonDocument<256> doc;
+        if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
+        {
+            bool hasTarget = doc.containsKey("targetGramsPerMinute");
+            float target = doc["targetGramsPerMinute"] | 0.0f;
+            if (hasTarget && target < 0.0f)
+            {
+                server->send(400, "application/json", "{\"status\":\"error\"}");
+                return;
+            }
+
+            bool modeOk = true;
+            {
+                SharedStateLock lock;
+                if (hasTarget)
+                    smokerData.auger.Mass = target;
+
+                // Mass mode is a manual feed mode, the state machine owns the auger otherwise
+                if (doc["enable"] | false)
+                {
+                    modeOk = smokerData.auger.mode == AugerControl::Mode::Manual || smokerData.auger.mode == AugerControl::Mode::Mass;
+                    if (modeOk)
+                        smokerData.auger.mode = AugerControl::Mode::Mass;
                 }
-                else if (buttonName == "btn_Auto")
+
+                if (modeOk && (doc["resetDelivered"] | false))
+                    PelletFeed::resetDelivered();
+            }
+
+            if (!modeOk)
+            {
+                server->send(409, "application/json", "{\"status\":\"mass mode requires manual mode\"}");
+                return;
+            }
+            server->send(200, "application/json", "{\"status\":\"ok\"}");
+            return;
+        }
+    }
+    server->send(400, "application/json", "{\"status\":\"error\"}");
+}
+
+void WebInterface::handleAugerCalibration()
+{
+    if (server->hasArg("plain"))
+    {
+        StaticJsonDocument<256> doc;
+        if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
+        {
+            String action = doc["action"] | "";
+            bool ok = false;
+            bool save = false;
+
+            {
+                SharedStateLock lock;
+                if (action == "start")
                 {
-                    uiData.btn_Auto = state;
+                    unsigned long durationSec = doc["durationSec"] | 60UL;
+                    ok = PelletFeed::startCalibration(durationSec * 1000UL);
                 }
-                else if (buttonName == "btn_Shutdown")
+                else if (action == "finish")
                 {
-                    uiData.btn_Shutdown = state;
+                    ok = PelletFeed::finishCalibration(doc["grams"] | 0.0f);
+                    save = ok;
                 }
-                else if (buttonName == "btn_Manual")
+                else if (action == "cancel")
                 {
-                    uiData.btn_Manual = state;
+                    PelletFeed::cancelCalibration();
+                    ok = true;
                 }
+            }
 
+            if (save)
+                saveConfig();
+            if (ok)
+            {
                 server->send(200, "application/json", "{\"status\":\"ok\"}");
-                return;
             }
+            else
+            {
+                server->send(409, "application/json", "{\"status\":\"calibration not possible in current state\"}");
+            }
+            return;
         }
     }
     server->send(400, "application/json", "{\"status\":\"error\"}");
 }
 
-void WebInterface::handleGetActuatorValues()
+void WebInterface::handleGetAutotune()
 {
-    StaticJsonDocument<256> doc;
-
-    doc["augerDutyCycle"] = smokerData.auger.dutyCycle;
-    doc["augerFrequency"] = smokerData.auger.frequency;
-    doc["fanDutyCycle"] = smokerData.fan.dutyCycle;
-    doc["fanFrequency"] = smokerData.fan.frequency;
+    StaticJsonDocument<1024> doc;
+    {
+        SharedStateLock lock;
+        Autotuner::Status status = autotuner.getStatus();
+        const AutotuneSettings &settings = autotuner.getSettings();
+
+        doc["status"] = Autotuner::GetStatusName(status);
+        doc["failureReason"] = autotuner.getFailureReason();
+        doc["completedCycles"] = autotuner.getCompletedCycles();
+        doc["target"] = settings.target;
+        doc["bias"] = settings.bias;
+        doc["amplitude"] = settings.amplitude;
+        doc["hysteresis"] = settings.hysteresis;
+        doc["cycles"] = settings.cycles;
+
+        if (status == Autotuner::Status::Complete)
+        {
+            const AutotuneResult &result = autotuner.getResult();
+            JsonObject model = doc.createNestedObject("result");
+            model["ultimateGain"] = result.ultimateGain;
+            model["ultimatePeriodS"] = result.ultimatePeriodS;
+            model["amplitudeF"] = result.amplitudeF;
+            model["meanDuty"] = result.meanDuty;
+            model["processGain"] = result.processGain;
+            model["timeConstantS"] = result.timeConstantS;
+            model["deadTimeS"] = result.deadTimeS;
+            model["augerKp"] = result.kp;
+            model["augerKi"] = result.ki;
+            model["augerKd"] = result.kd;
+
+            JsonArray augerTransfer = model.createNestedArray("augerTransferFunc");
+            for (int i = 0; i < 11; i++)
+            {
+                JsonArray point = augerTransfer.createNestedArray();
+                point.add(result.augerTransferFunc[i][0]);
+                point.add(result.augerTransferFunc[i][1]);
+            }
+        }
+    }
 
     String response;
     serializeJson(doc, response);
     server->send(200, "application/json", response);
 }
 
-void WebInterface::handleSetActuatorValues()
+void WebInterface::handleSetAutotune()
 {
     if (server->hasArg("plain"))
     {
         StaticJsonDocument<256> doc;
         if (deserializeJson(doc, server->arg("plain")) == DeserializationError::Ok)
         {
-            if (doc.containsKey("augerDutyCycle"))
-                smokerData.auger.dutyCycle = doc["augerDutyCycle"];
-            if (doc.containsKey("augerFrequency"))
-                smokerData.auger.frequency = doc["augerFrequency"];
-            if (doc.containsKey("fanDutyCycle"))
-                smokerData.fan.dutyCycle = doc["fanDutyCycle"];
-            if (doc.containsKey("fanFrequency"))
-                smokerData.fan.frequency = doc["fanFrequency"];
+            String action = doc["action"] | "";
+            int code = 200;
+            const char *reply = "{\"status\":\"ok\"}";
+            bool save = false;
 
-            server->send(200, "application/json", "{\"status\":\"ok\"}");
+            {
+                SharedStateLock lock;
+                if (action == "start")
+                {
+                    AutotuneSettings settings;
+                    settings.target = doc["target"] | smokerConfig.operating.setpoint;
+                    settings.bias = EvaluateAugerTransferFunction(settings.target);
+                    settings.amplitude = doc["amplitude"] | 15.0f;
+                    settings.hysteresis = doc["hysteresis"] | 2.0f;
+                    settings.cycles = doc["cycles"] | 4;
+                    settings.maxDurationMs = (doc["maxDurationMin"] | 120UL) * 60UL * 1000UL;
+
+                    if (autotuner.getStatus() == Autotuner::Status::Running)
+                    {
+                        code = 409;
+                        reply = "{\"status\":\"autotune already running\"}";
+                    }
+                    // The relay experiment needs an established fire, the state machine would only cancel it
+                    else if (smokerStateMachine.GetActiveState() != SmokerStateMachine::State::Auto_Run)
+                    {
+                        code = 409;
+                        reply = "{\"status\":\"autotune can only start from Running\"}";
+                    }
+                    else if (settings.amplitude <= 0.0f || settings.hysteresis < 0.0f)
+                    {
+                        code = 400;
+                        reply = "{\"status\":\"error\"}";
+                    }
+                    else
+                    {
+                        autotuner.start(settings, smokerConfig.tunable.augerTransferFunc);
+                        uiData.btn_Autotune = true;
+                    }
+                }
+                else if (action == "apply")
+                {
+                    if (autotuner.getStatus() != Autotuner::Status::Complete)
+                    {
+                        code = 409;
+                        reply = "{\"status\":\"no autotune result to apply\"}";
+                    }
+                    else
+                    {
+                        const AutotuneResult &result = autotuner.getResult();
+                        smokerConfig.tunable.augerKp = result.kp;
+                        smokerConfig.tunable.augerKi = result.ki;
+                        smokerConfig.tunable.augerKd = result.kd;
+                        memcpy(smokerConfig.tunable.augerTransferFunc, result.augerTransferFunc, sizeof(smokerConfig.tunable.augerTransferFunc));
+                        InvalidateTransferFunctions();
+                        save = true;
+                    }
+                }
+                else if (action == "cancel")
+                {
+                    autotuner.cancel();
+                }
+                else
+                {
+                    code = 400;
+                    reply = "{\"status\":\"error\"}";
+                }
+            }
+
+            if (save)
+                saveConfig();
+            server->send(code, "application/json", reply);
             return;
         }
     }
@@ -613,20 +1470,40 @@ void WebInterface::handleSetActuatorValues()
 
 void WebInterface::handleReboot()
 {
+    // Keep the relay wear counters accumulated since the last periodic save
+    RelayDriver::persistTask(true);
+    // Close the open tier buckets too, they would not survive the restart
+    DataLogger::flush(true);
+#ifdef SMOKER_ASYNC_WEB
+    // The reply is only transmitted after this handler returns
+    server->onDisconnect([]() { ESP.restart(); });
+    server->send(200, "application/json", "{\"status\":\"rebooting\"}");
+#else
     server->send(200, "application/json", "{\"status\":\"rebooting\"}");
     delay(100);
     ESP.restart();
+#endif
 }
 
 void WebInterface::handleGetLoggingConfig()
 {
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<384> doc;
     LogConfig config = DataLogger::getConfig();
+    DataLogger::QueueStats queueStats = DataLogger::getQueueStats();
 
     doc["enabled"] = config.enabled;
     doc["logIntervalMs"] = config.logIntervalMs;
     doc["maxLogFiles"] = config.maxLogFiles;
     doc["maxLogFileSizeBytes"] = config.maxLogFileSizeBytes;
+    doc["flushRecords"] = config.flushRecords;
+    doc["flushIntervalMs"] = config.flushIntervalMs;
+    doc["lossWindowMs"] = DataLogger::getLossWindowMs();
+    doc["stagedBytes"] = DataLogger::getStagedBytes();
+    JsonObject queue = doc.createNestedObject("queue");
+    queue["depth"] = queueStats.depth;
+    queue["capacity"] = queueStats.capacity;
+    queue["highWater"] = queueStats.highWater;
+    queue["dropped"] = queueStats.dropped;
     doc["activeLogFile"] = DataLogger::getActiveLogFile();
 
     String response;
@@ -648,18 +1525,27 @@ void WebInterface::handleSetLoggingConfig()
             if (doc.containsKey("logIntervalMs"))
                 config.logIntervalMs = doc["logIntervalMs"];
             if (doc.containsKey("maxLogFiles"))
-                config.maxLogFiles = doc["maxLogFiles"];
+                config.maxLogFiles = constrain((int)doc["maxLogFiles"], 1, DataLogger::MAX_LOG_FILES);
             if (doc.containsKey("maxLogFileSizeBytes"))
                 config.maxLogFileSizeBytes = doc["maxLogFileSizeBytes"];
+            if (doc.containsKey("flushRecords"))
+                config.flushRecords = constrain((int)doc["flushRecords"], 1, 100);
+            if (doc.containsKey("flushIntervalMs"))
+                config.flushIntervalMs = doc["flushIntervalMs"];
 
             DataLogger::setConfig(config);
 
             // Update persistent config
-            smokerConfig.logging.enabled = config.enabled;
-            smokerConfig.logging.logIntervalMs = config.logIntervalMs;
-            smokerConfig.logging.maxLogFiles = config.maxLogFiles;
-            smokerConfig.logging.maxLogFileSizeBytes = config.maxLogFileSizeBytes;
-            SaveConfigToSPIFFS(smokerConfig);
+            {
+                SharedStateLock lock;
+                smokerConfig.logging.enabled = config.enabled;
+                smokerConfig.logging.logIntervalMs = config.logIntervalMs;
+                smokerConfig.logging.maxLogFiles = config.maxLogFiles;
+                smokerConfig.logging.maxLogFileSizeBytes = config.maxLogFileSizeBytes;
+                smokerConfig.logging.flushRecords = config.flushRecords;
+                smokerConfig.logging.flushIntervalMs = config.flushIntervalMs;
+            }
+            saveConfig();
 
             server->send(200, "application/json", "{\"status\":\"ok\"}");
             return;
@@ -674,148 +1560,94 @@ void WebInterface::handleClearLogs()
     server->send(200, "application/json", "{\"status\":\"ok\"}");
 }
 
+// Logs are stored as binary records and decoded back to the CSV columns while they are sent
 void WebInterface::handleDownloadLog()
 {
+    PROFILE_SCOPE("web.downloadLog");
+    DataLogger::flush(); // include the records still staged in RAM
+
+    // One file if asked for, otherwise every surviving file in time order as one CSV
+    std::shared_ptr<LogDataStream> stream;
     if (server->hasArg("file"))
     {
-        String filename = server->arg("file");
-        String filepath = "/logs/" + filename;
-
-        if (SPIFFS.exists(filepath))
+        String filepath = "/logs/" + server->arg("file");
+        if (!SPIFFS.exists(filepath))
         {
-            File file = SPIFFS.open(filepath, "r");
-            if (file)
-            {
-                server->streamFile(file, "text/csv");
-                file.close();
-                return;
-            }
+            server->send(404, "text/plain", "File not found");
+            return;
         }
-        server->send(404, "text/plain", "File not found");
+        String csvName = filepath.substring(filepath.lastIndexOf('/') + 1);
+        csvName.replace(".bin", ".csv");
+        server->sendHeader("Content-Disposition", "attachment; filename=\"" + csvName + "\"");
+        stream = std::make_shared<LogDataStream>(filepath, 0, ULONG_MAX, 0, LogDataStream::Format::Csv);
     }
     else
     {
-        // Download active log file if no file specified
-        String activeFile = DataLogger::getActiveLogFile();
-        if (SPIFFS.exists(activeFile))
+        LogFileSpan span;
+        if (!DataLogger::findLogFile(0, span))
         {
-            File file = SPIFFS.open(activeFile, "r");
-            if (file)
-            {
-                server->streamFile(file, "text/csv");
-                file.close();
-                return;
-            }
+            server->send(404, "text/plain", "No log files");
+            return;
         }
-        server->send(404, "text/plain", "No active log file");
+        server->sendHeader("Content-Disposition", "attachment; filename=\"smoker_log.csv\"");
+        stream = std::make_shared<LogDataStream>(0, ULONG_MAX, 0, LogDataStream::Format::Csv);
     }
+    sendChunked("text/csv", [stream](uint8_t *buffer, size_t maxLength)
+                { return stream->read(buffer, maxLength); });
 }
 
 void WebInterface::handleGetLogData()
 {
-    String activeFile = DataLogger::getActiveLogFile();
-    if (!SPIFFS.exists(activeFile))
+    PROFILE_SCOPE("web.logData");
+    // No flush: the chart refreshes often and may trail by getLossWindowMs()
+    LogFileSpan span;
+    if (!DataLogger::findLogFile(0, span))
     {
         server->send(404, "application/json", "{\"error\":\"No log file found\"}");
         return;
     }
 
-    File file = SPIFFS.open(activeFile, "r");
-    if (!file)
-    {
-        server->send(500, "application/json", "{\"error\":\"Could not open log file\"}");
-        return;
-    }
-
-    // Get parameters: duration in minutes (default 60), fields to include
-    int durationMinutes = 60;
-    if (server->hasArg("duration"))
+    // Get parameters: start/end in log timestamps (ms, as in the rows), or the
+    // trailing duration in minutes (default 60, 0 for everything); points to
+    // get at most about that many min/max/mean rows instead of every sample
+    unsigned long nowMs = DataLogger::now();
+    unsigned long startTime = 0;
+    unsigned long endTime = ULONG_MAX;
+    if (server->hasArg("start"))
     {
-        durationMinutes = server->arg("duration").toInt();
+        startTime = strtoul(server->arg("start").c_str(), nullptr, 10);
     }
-
-    unsigned long requestedMs = 0;
-    if (durationMinutes > 0)
+    else
     {
-        requestedMs = (unsigned long)durationMinutes * 60000UL;
-    }
+        int durationMinutes = 60;
+        if (server->hasArg("duration"))
+        {
+            durationMinutes = server->arg("duration").toInt();
+        }
 
-    unsigned long nowMs = millis();
-    unsigned long cutoffTime = 0;
-    if (requestedMs > 0 && requestedMs < nowMs)
-    {
-        cutoffTime = nowMs - requestedMs;
+        unsigned long requestedMs = 0;
+        if (durationMinutes > 0)
+        {
+            requestedMs = (unsigned long)durationMinutes * 60000UL;
+        }
+        if (requestedMs > 0 && requestedMs < nowMs)
+        {
+            startTime = nowMs - requestedMs;
+        }
     }
-
-    // Read and parse CSV
-    String response = "{\"data\":[";
-    bool firstEntry = true;
-    
-    // Skip header line
-    if (file.available())
+    if (server->hasArg("end"))
     {
-        file.readStringUntil('\n');
+        endTime = strtoul(server->arg("end").c_str(), nullptr, 10);
     }
-
-    while (file.available())
+    int points = 0;
+    if (server->hasArg("points"))
     {
-        String line = file.readStringUntil('\n');
-        line.trim();
-        if (line.length() == 0) continue;
-
-        // Parse CSV line
-        int idx = 0;
-        String timestamp = "";
-        int commaPos = line.indexOf(',');
-        if (commaPos > 0)
-        {
-            timestamp = line.substring(0, commaPos);
-            unsigned long ts = timestamp.toInt();
-            
-            // Filter by time range
-            if (ts < cutoffTime) continue;
-            
-            if (!firstEntry) response += ",";
-            firstEntry = false;
-            
-            // Convert line to JSON object
-            response += "{\"timestamp\":" + timestamp;
-            
-            String remainder = line.substring(commaPos + 1);
-            const char* fieldNames[] = {"smokeChamberTemp", "firePotTemp", "setpoint", "smokeSetpoint", 
-                                       "activeState", "igniterMode", "augerMode", "augerDutyCycle", 
-                                       "augerFrequency", "fanMode", "fanDutyCycle", "fanFrequency"};
-            
-            for (int i = 0; i < 12; i++)
-            {
-                commaPos = remainder.indexOf(',');
-                String value;
-                if (commaPos > 0)
-                {
-                    value = remainder.substring(0, commaPos);
-                    remainder = remainder.substring(commaPos + 1);
-                }
-                else
-                {
-                    value = remainder;
-                }
-                
-                // Add field to JSON
-                if (i == 4) // activeState is a string
-                {
-                    response += ",\"" + String(fieldNames[i]) + "\":\"" + value + "\"";
-                }
-                else
-                {
-                    response += ",\"" + String(fieldNames[i]) + "\":" + value;
-                }
-            }
-            response += "}";
-        }
+        points = server->arg("points").toInt();
     }
-    
-    response += "]}";
-    file.close();
 
-    server->send(200, "application/json", response);
+    // Rows are formatted as they are sent, across as many rotated files as the range covers,
+    // so the log never has to fit in RAM
+    std::shared_ptr<LogDataStream> stream = std::make_shared<LogDataStream>(startTime, endTime, points, LogDataStream::Format::Json);
+    sendChunked("application/json", [stream](uint8_t *buffer, size_t maxLength)
+                { return stream->read(buffer, maxLength); });
 }
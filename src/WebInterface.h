@@ -1,24 +1,81 @@
 #pragma once
 
 #include <WebServer.h>
+#include <functional>
 #include <ArduinoJson.h>
 #include "SmokerControl.h"
 #include "SmokerStateMachine.h"
+#include "StatusCache.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#ifdef SMOKER_ASYNC_WEB
+#include "AsyncWebAdapter.h"
+typedef AsyncWebAdapter HttpServer;
+#else
+typedef WebServer HttpServer;
+#endif
 
 class WebInterface
 {
 public:
     WebInterface(uint16_t port = 80);
+#ifndef SMOKER_ASYNC_WEB
     WebInterface(WebServer &existingServer);
+#endif
     ~WebInterface();
     void begin();
     void handleClient();
     void stop();
 
+    // Push status, state and alarm events to /api/events subscribers (call from the comms task)
+    void pushEvents();
+
 private:
-    WebServer *server;
+    HttpServer *server;
     bool ownsServer = false;
     void attachServer(WebServer &existingServer);
+    void route(const char *uri, HTTPMethod method, void (WebInterface::*handler)());
+
+    // Streams a response body produced piece by piece; returns 0 when done
+    typedef std::function<size_t(uint8_t *buffer, size_t maxLength)> ChunkFiller;
+    void sendChunked(const char *contentType, ChunkFiller filler);
+#ifndef SMOKER_ASYNC_WEB
+    uint8_t chunkBuffer[1024];
+#endif
+
+    StatusCache statusCache;
+
+#ifndef SMOKER_ASYNC_WEB
+    // Server-Sent Events subscribers; each keeps its own copy of the connection
+    struct EventClient
+    {
+        WiFiClient client;
+        bool active;
+        unsigned long intervalMs;   // per-client status rate limit
+        unsigned long lastStatusMs;
+        unsigned long lastWriteMs;
+        uint32_t sentVersion;
+    };
+    static const int MAX_EVENT_CLIENTS = 4;
+    EventClient eventClients[MAX_EVENT_CLIENTS];
+    bool writeEvent(EventClient &subscriber, const char *event, const char *data, size_t length);
+    void handleEvents();
+#else
+    // AsyncEventSource streams to all subscribers at the default rate
+    uint32_t eventSentVersion = 0;
+    unsigned long eventLastStatusMs = 0;
+#endif
+    static const unsigned long EVENT_DEFAULT_INTERVAL_MS = 500;
+    static const unsigned long EVENT_MIN_INTERVAL_MS = 250;
+    static const unsigned long EVENT_KEEPALIVE_MS = 15000;
+    uint32_t eventVersion = 0;
+    char eventState[32] = "";
+    bool eventSmokeChamberValid = true;
+    bool eventFirePotValid = true;
+    int eventReigniteAttempts = 0;
+    void broadcastEvent(const char *event, const char *data);
+    void broadcastAlarm(const char *alarm, bool active);
 
     void handleRoot();
     void handleGetStatus();
@@ -32,6 +89,21 @@ private:
     void handleSetButton();
     void handleGetActuatorValues();
     void handleSetActuatorValues();
+    void handleGetOutputTiming();
+    void handleResetOutputTiming();
+    void handleGetOutputStats();
+    void handleGetSchedulerStats();
+    void handleResetSchedulerStats();
+    void handleGetProfile();
+    void handleResetProfile();
+    void handleGetTrace();
+    void handleSetTrace();
+    void handleDownloadTrace();
+    void handleGetPelletFeed();
+    void handleSetPelletFeed();
+    void handleAugerCalibration();
+    void handleGetAutotune();
+    void handleSetAutotune();
     void handleDownloadConfig();
     void handleUploadConfig();
     void handleReboot();
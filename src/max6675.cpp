@@ -15,6 +15,7 @@ MAX6675::MAX6675(int8_t SCLK, int8_t CS, int8_t MISO) {
   sclk = SCLK;
   cs = CS;
   miso = MISO;
+  spi = nullptr;
 
   // define pin modes
   pinMode(cs, OUTPUT);
@@ -26,14 +27,44 @@ MAX6675::MAX6675(int8_t SCLK, int8_t CS, int8_t MISO) {
 
 /**************************************************************************/
 /*!
-    @brief  Read the Celsius temperature
-    @returns Temperature in C or NAN on failure!
+    @brief  Initialize a MAX6675 sensor on a hardware SPI bus. The bus must
+            already be started with spiBus->begin(); several sensors may
+            share it as long as each has its own chip select.
+    @param   spiBus The hardware SPI peripheral the sensor is wired to
+    @param   CS The Arduino pin connected to Chip Select
 */
 /**************************************************************************/
-float MAX6675::readCelsius(void) {
+MAX6675::MAX6675(SPIClass *spiBus, int8_t CS) {
+  sclk = -1;
+  cs = CS;
+  miso = -1;
+  spi = spiBus;
+
+  pinMode(cs, OUTPUT);
+  digitalWrite(cs, HIGH);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the raw 16 bit conversion register. Raising CS at the end
+            of the transfer starts the next conversion.
+    @returns Raw register value (bit 2 set = open thermocouple)
+*/
+/**************************************************************************/
+uint16_t MAX6675::readRaw(void) {
 
   uint16_t v;
 
+  if (spi) {
+    // 4MHz is inside the 4.3MHz limit of the MAX6675, 16 clocks = 4us
+    spi->beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+    v = spi->transfer16(0x0000);
+    digitalWrite(cs, HIGH);
+    spi->endTransaction();
+    return v;
+  }
+
   digitalWrite(cs, LOW);
   delayMicroseconds(10);
 
@@ -43,15 +74,44 @@ float MAX6675::readCelsius(void) {
 
   digitalWrite(cs, HIGH);
 
-  if (v & 0x4) {
+  return v;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check the open thermocouple flag of a raw reading
+    @param   raw Value returned by readRaw()
+    @returns true if no thermocouple is attached
+*/
+/**************************************************************************/
+bool MAX6675::isOpen(uint16_t raw) { return (raw & 0x4) != 0; }
+
+/**************************************************************************/
+/*!
+    @brief  Convert a raw reading to Celsius (0.25C per count)
+    @param   raw Value returned by readRaw()
+    @returns Temperature in C, ignoring the fault flag
+*/
+/**************************************************************************/
+float MAX6675::rawToCelsius(uint16_t raw) { return (raw >> 3) * 0.25f; }
+
+/**************************************************************************/
+/*!
+    @brief  Read the Celsius temperature
+    @returns Temperature in C or NAN on failure!
+*/
+/**************************************************************************/
+float MAX6675::readCelsius(void) {
+
+  uint16_t v = readRaw();
+
+  if (isOpen(v)) {
     // uh oh, no thermocouple attached!
     //return NAN;
     return 0.0f; // dont care why its not attached, just return 0 for now
   }
 
-  v >>= 3;
-
-  return v * 0.25;
+  return rawToCelsius(v);
 }
 
 /**************************************************************************/
@@ -5,6 +5,7 @@
 #define ADAFRUIT_MAX6675_H
 
 #include "Arduino.h"
+#include <SPI.h>
 
 /**************************************************************************/
 /*!
@@ -14,9 +15,17 @@
 class MAX6675 {
 public:
   MAX6675(int8_t SCLK, int8_t CS, int8_t MISO);
+  MAX6675(SPIClass *spiBus, int8_t CS);
 
   float readCelsius(void);
   float readFahrenheit(void);
+  uint16_t readRaw(void);
+
+  static bool isOpen(uint16_t raw);
+  static float rawToCelsius(uint16_t raw);
+
+  /*! Time the chip needs after CS rises before a new reading is valid (ms) */
+  static const unsigned long CONVERSION_TIME_MS = 220;
 
   /*!    @brief  For compatibility with older versions
          @returns Temperature in F or NAN on failure! */
@@ -24,6 +33,7 @@ public:
 
 private:
   int8_t sclk, miso, cs;
+  SPIClass *spi;
   uint8_t spiread(void);
 };
 
@@ -0,0 +1,158 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 core, enough to build the modules under
+// test in the native environment. Time comes from a simulated clock that
+// only moves when a test advances it (or a module calls delay()), so timing
+// behaviour is reproducible. Header only: every test suite is its own program.
+#include <climits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include "freertos/FreeRTOS.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define PI 3.1415926535897932384626433832795
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high)
+{
+    return value < (T)low ? (T)low : (value > (T)high ? (T)high : value);
+}
+
+class HostClock
+{
+public:
+    static uint64_t &micros()
+    {
+        static uint64_t now = 0;
+        return now;
+    }
+    static void advanceUs(uint64_t us) { micros() += us; }
+    static void advanceMs(unsigned long ms) { micros() += (uint64_t)ms * 1000; }
+    static void set(uint64_t us) { micros() = us; }
+};
+
+inline unsigned long millis() { return (unsigned long)(HostClock::micros() / 1000); }
+inline unsigned long micros() { return (unsigned long)HostClock::micros(); }
+inline void delay(unsigned long ms) { HostClock::advanceMs(ms); }
+inline void delayMicroseconds(unsigned int us) { HostClock::advanceUs(us); }
+
+// GPIO levels, so tests can see what a module drove
+class HostPins
+{
+public:
+    static int *levels()
+    {
+        static int pins[64] = {};
+        return pins;
+    }
+};
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int level) { HostPins::levels()[pin & 63] = level; }
+inline int digitalRead(int pin) { return HostPins::levels()[pin & 63]; }
+
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t length = strlen(src);
+    if (size)
+    {
+        size_t count = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, count);
+        dst[count] = '\0';
+    }
+    return length;
+}
+
+class String
+{
+public:
+    String() {}
+    String(const char *text) : text(text ? text : "") {}
+    String(const std::string &text) : text(text) {}
+    explicit String(char c) : text(1, c) {}
+    String(int value) : text(std::to_string(value)) {}
+    String(unsigned int value) : text(std::to_string(value)) {}
+    String(long value) : text(std::to_string(value)) {}
+    String(unsigned long value) : text(std::to_string(value)) {}
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    bool isEmpty() const { return text.empty(); }
+    String &operator+=(const String &other) { text += other.text; return *this; }
+    String &operator+=(const char *other) { text += other; return *this; }
+    String &operator+=(char c) { text += c; return *this; }
+    bool operator==(const String &other) const { return text == other.text; }
+    bool operator==(const char *other) const { return text == other; }
+    bool operator!=(const String &other) const { return text != other.text; }
+    bool operator<(const String &other) const { return text < other.text; }
+    char operator[](unsigned int index) const { return text[index]; }
+    int indexOf(char c) const { return find(text.find(c)); }
+    int lastIndexOf(char c) const { return find(text.rfind(c)); }
+    String substring(unsigned int from, unsigned int to) const { return text.substr(from, to > from ? to - from : 0); }
+    String substring(unsigned int from) const { return text.substr(std::min<size_t>(from, text.size())); }
+    bool startsWith(const String &prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+    long toInt() const { return strtol(text.c_str(), nullptr, 10); }
+
+    friend String operator+(const String &a, const String &b) { return a.text + b.text; }
+    friend String operator+(const String &a, const char *b) { return a.text + b; }
+    friend String operator+(const char *a, const String &b) { return a + b.text; }
+
+private:
+    std::string text;
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *, size_t length) { return length; }
+    size_t print(const String &) { return 0; }
+    size_t print(const char *) { return 0; }
+    size_t print(char) { return 0; }
+    size_t print(int, int = 10) { return 0; }
+    size_t print(unsigned int, int = 10) { return 0; }
+    size_t print(long, int = 10) { return 0; }
+    size_t print(unsigned long, int = 10) { return 0; }
+    size_t print(double, int = 2) { return 0; }
+    size_t println() { return 0; }
+    template <typename T>
+    size_t println(const T &) { return 0; }
+    template <typename T>
+    size_t println(const T &, int) { return 0; }
+    size_t printf(const char *, ...) { return 0; }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+// Quiet: module diagnostics are not part of the test output
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+};
+
+inline HardwareSerial Serial;
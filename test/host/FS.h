@@ -0,0 +1,131 @@
+#pragma once
+
+// Host stand-in for the Arduino FS API over an in-memory file table. Tests
+// can inspect and edit the files directly, count opens and bytes read, see
+// each remove, and cap the free space to get short writes as on a full
+// SPIFFS partition.
+#include <functional>
+#include <map>
+#include <string>
+#include "Arduino.h"
+
+class HostFs
+{
+public:
+    static std::map<std::string, std::string> &files()
+    {
+        static std::map<std::string, std::string> table;
+        return table;
+    }
+    static size_t &freeBytes() // space left for writes
+    {
+        static size_t bytes = SIZE_MAX;
+        return bytes;
+    }
+    static uint32_t &opens()
+    {
+        static uint32_t count = 0;
+        return count;
+    }
+    static size_t &bytesRead()
+    {
+        static size_t count = 0;
+        return count;
+    }
+    static std::function<void(const std::string &path)> &removeHook() // called before each remove
+    {
+        static std::function<void(const std::string &path)> hook;
+        return hook;
+    }
+    static void reset()
+    {
+        files().clear();
+        freeBytes() = SIZE_MAX;
+        opens() = 0;
+        bytesRead() = 0;
+        removeHook() = nullptr;
+    }
+};
+
+namespace fs
+{
+enum SeekMode
+{
+    SeekSet = 0
+};
+
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(const std::string &path) : path(path), open(true) { HostFs::opens()++; }
+
+    explicit operator bool() const { return open; }
+    size_t size() const { return open ? HostFs::files()[path].size() : 0; }
+    void close() { open = false; }
+    bool seek(uint32_t offset, SeekMode = SeekSet)
+    {
+        if (!open || offset > size())
+            return false;
+        position = offset;
+        return true;
+    }
+
+    using Print::write;
+    size_t write(const uint8_t *data, size_t length) override
+    {
+        if (!open)
+            return 0;
+        size_t count = std::min(length, HostFs::freeBytes());
+        HostFs::freeBytes() -= HostFs::freeBytes() == SIZE_MAX ? 0 : count;
+        HostFs::files()[path].append((const char *)data, count);
+        return count;
+    }
+    size_t read(uint8_t *buffer, size_t length)
+    {
+        if (!open)
+            return 0;
+        const std::string &data = HostFs::files()[path];
+        size_t count = position < data.size() ? std::min(length, data.size() - position) : 0;
+        memcpy(buffer, data.data() + position, count);
+        position += count;
+        HostFs::bytesRead() += count;
+        return count;
+    }
+    int read() override
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+private:
+    std::string path;
+    bool open = false;
+    size_t position = 0;
+};
+
+class FS
+{
+public:
+    File open(const String &path, const char *mode = "r")
+    {
+        std::string name = path.c_str();
+        if (mode[0] == 'r' && !HostFs::files().count(name))
+            return File();
+        if (mode[0] == 'w')
+            HostFs::files()[name].clear();
+        else
+            HostFs::files()[name];
+        return File(name);
+    }
+    bool exists(const String &path) { return HostFs::files().count(path.c_str()) > 0; }
+    bool remove(const String &path)
+    {
+        if (HostFs::removeHook())
+            HostFs::removeHook()(path.c_str());
+        return HostFs::files().erase(path.c_str()) > 0;
+    }
+};
+} // namespace fs
+
+using fs::File;
@@ -0,0 +1,26 @@
+#pragma once
+
+// The DataLogger writer task for host suites that include DataLogger.cpp:
+// loggerTask plays the firmware's logger task and runWriter() is one pass of
+// it. hostLogConfig() is the stock configuration with logging on; a suite
+// changes only the fields it tests.
+#include "freertos/FreeRTOS.h"
+#include "DataLogger.h"
+
+inline HostTask loggerTask = {"logger", 0};
+
+// One writer task pass, on the logger task as in the firmware
+inline void runWriter()
+{
+    TaskHandle_t caller = hostCurrentTask();
+    hostCurrentTask() = &loggerTask;
+    DataLogger::writerTask();
+    hostCurrentTask() = caller;
+}
+
+inline LogConfig hostLogConfig()
+{
+    LogConfig config = DEFAULT_LOG_CONFIG;
+    config.enabled = true;
+    return config;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+// Host mock of the ESP32 SPI peripheral with MAX6675 chips on it. Each chip
+// is attached by its chip select pin and returns the raw register a test set
+// for it. A transfer goes to the chip whose chip select is low, and the mock
+// counts reads that came before the chip finished its conversion (the chip
+// would abort the conversion and return the old value).
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define VSPI 3
+#define HSPI 2
+
+class SPISettings
+{
+public:
+    SPISettings() {}
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class MockSpiBus
+{
+public:
+    static const int MAX_CHIPS = 4;
+    static const uint64_t CONVERSION_US = 220000; // MAX6675 conversion time, typical
+
+    struct Chip
+    {
+        int csPin;
+        uint16_t raw;
+        uint32_t reads;
+        uint32_t earlyReads; // reads before the conversion finished
+        uint64_t lastReadUs;
+    };
+
+    static void reset()
+    {
+        chipCount() = 0;
+        transfers() = 0;
+        strayTransfers() = 0;
+    }
+
+    static Chip &attach(int csPin, uint16_t raw)
+    {
+        Chip &chip = chips()[chipCount()++];
+        chip = {csPin, raw, 0, 0, 0};
+        HostPins::levels()[csPin] = HIGH;
+        return chip;
+    }
+
+    static Chip *chip(int csPin)
+    {
+        for (int i = 0; i < chipCount(); i++)
+        {
+            if (chips()[i].csPin == csPin)
+                return &chips()[i];
+        }
+        return nullptr;
+    }
+
+    static uint16_t transfer16()
+    {
+        transfers()++;
+        Chip *selected = nullptr;
+        for (int i = 0; i < chipCount(); i++)
+        {
+            if (HostPins::levels()[chips()[i].csPin] == LOW)
+            {
+                if (selected)
+                {
+                    strayTransfers()++; // two chips driving MISO
+                    return 0xFFFF;
+                }
+                selected = &chips()[i];
+            }
+        }
+        if (!selected)
+        {
+            strayTransfers()++;
+            return 0xFFFF;
+        }
+        if (selected->reads > 0 && HostClock::micros() - selected->lastReadUs < CONVERSION_US)
+            selected->earlyReads++;
+        selected->reads++;
+        selected->lastReadUs = HostClock::micros();
+        return selected->raw;
+    }
+
+    static int &chipCount()
+    {
+        static int count = 0;
+        return count;
+    }
+    static uint32_t &transfers()
+    {
+        static uint32_t count = 0;
+        return count;
+    }
+    static uint32_t &strayTransfers()
+    {
+        static uint32_t count = 0;
+        return count;
+    }
+
+private:
+    static Chip *chips()
+    {
+        static Chip list[MAX_CHIPS];
+        return list;
+    }
+};
+
+class SPIClass
+{
+public:
+    SPIClass(uint8_t = VSPI) {}
+    void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint16_t transfer16(uint16_t) { return MockSpiBus::transfer16(); }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+// Host stand-in for esp_timer on the simulated clock of Arduino.h. Periodic
+// timers do not fire by themselves: HostTimer::run() advances the clock and
+// calls each callback when it is due, as the esp_timer task would.
+#include <cstdint>
+#include "Arduino.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum
+{
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t periodUs; // 0 when stopped
+    uint64_t nextUs;
+};
+typedef esp_timer *esp_timer_handle_t;
+
+class HostTimer
+{
+public:
+    static esp_timer_handle_t &last()
+    {
+        static esp_timer_handle_t timer = nullptr;
+        return timer;
+    }
+
+    // Advance the clock by us, firing the last created timer on its period
+    // (late by latencyUs, as when its task is held off)
+    static void run(uint64_t us, uint64_t latencyUs = 0)
+    {
+        esp_timer_handle_t timer = last();
+        uint64_t endUs = HostClock::micros() + us;
+        while (timer && timer->periodUs && timer->nextUs + latencyUs <= endUs)
+        {
+            HostClock::set(timer->nextUs + latencyUs);
+            timer->nextUs += timer->periodUs;
+            timer->callback(timer->arg);
+        }
+        HostClock::set(endUs);
+    }
+};
+
+inline int64_t esp_timer_get_time() { return (int64_t)HostClock::micros(); }
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    *handle = new esp_timer{args->callback, args->arg, 0, 0};
+    HostTimer::last() = *handle;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs)
+{
+    timer->periodUs = periodUs;
+    timer->nextUs = HostClock::micros() + periodUs;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer->periodUs = 0;
+    return ESP_OK;
+}
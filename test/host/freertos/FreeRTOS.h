@@ -0,0 +1,96 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS API used by the modules under test. Tests
+// run on one thread, so critical sections are no-ops and a mutex is always
+// free. A test plays other tasks by switching the current task handle, and
+// through a hook that runs when a take would block: what another task would
+// have done meanwhile. Without one the take returns at once as a timeout.
+#include <cstdint>
+#include <functional>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+
+typedef struct
+{
+    int owner;
+    int count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+
+struct HostTask
+{
+    const char *name;
+    uint32_t notifications;
+};
+typedef HostTask *TaskHandle_t;
+
+struct HostSemaphore
+{
+    bool mutex;
+    int count;
+};
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline TaskHandle_t &hostCurrentTask()
+{
+    static HostTask test = {"test", 0};
+    static TaskHandle_t current = &test;
+    return current;
+}
+inline std::function<void()> &hostBlockHook()
+{
+    static std::function<void()> hook;
+    return hook;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostCurrentTask(); }
+inline char *pcTaskGetName(TaskHandle_t task) { return (char *)(task ? task : xTaskGetCurrentTaskHandle())->name; }
+inline BaseType_t xPortGetCoreID() { return 0; }
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notifications++;
+    return pdPASS;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint32_t count = task->notifications;
+    if (count)
+        task->notifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore{true, 1}; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore{false, 0}; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    if (semaphore->mutex)
+        return pdTRUE;
+    if (semaphore->count == 0 && ticks > 0 && hostBlockHook())
+        hostBlockHook()();
+    if (semaphore->count == 0)
+        return pdFALSE;
+    semaphore->count--;
+    return pdTRUE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    if (!semaphore->mutex)
+        semaphore->count = 1;
+    return pdTRUE;
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <math.h>
+#include "Autotuner.cpp"
+#include "PidController.cpp"
+
+// Default augerTransferFunc
+static const float TRANSFER_FUNC[11][2] = {
+    {33.0f, 175.0f}, {37.0f, 200.0f}, {41.0f, 225.0f}, {47.0f, 250.0f}, {52.0f, 275.0f}, {58.0f, 300.0f},
+    {64.0f, 325.0f}, {72.0f, 350.0f}, {80.0f, 375.0f}, {90.0f, 400.0f}, {100.0f, 425.0f}};
+
+static constexpr float PLANT_GAIN = 5.0f;            // F per % duty
+static constexpr float PLANT_TIME_CONSTANT = 600.0f; // s
+static constexpr float PLANT_DEAD_TIME = 60.0f;      // s
+static constexpr float PLANT_HOLD_DUTY = 46.0f;      // duty that holds 225F, 5% above the table
+
+// First-order plus dead time chamber, stepped every 500 ms like AugerRegulatorTask
+class ChamberPlant
+{
+public:
+    static const int STEP_MS = 500;
+
+    explicit ChamberPlant(float startF) : temperature(startF), head(0)
+    {
+        for (float &duty : delayed)
+            duty = PLANT_HOLD_DUTY + (startF - 225.0f) / PLANT_GAIN;
+    }
+
+    float step(float duty)
+    {
+        float applied = delayed[head];
+        delayed[head] = duty;
+        head = (head + 1) % DELAY_STEPS;
+        float target = 225.0f + PLANT_GAIN * (applied - PLANT_HOLD_DUTY);
+        temperature += (target - temperature) * (STEP_MS / 1000.0f) / PLANT_TIME_CONSTANT;
+        return temperature;
+    }
+
+    float temperature;
+
+private:
+    static const int DELAY_STEPS = (int)(PLANT_DEAD_TIME * 1000) / STEP_MS;
+    float delayed[DELAY_STEPS];
+    int head;
+};
+
+static const AutotuneSettings SETTINGS = {225.0f, 41.0f, 10.0f, 2.0f, 4, 4UL * 60 * 60 * 1000};
+
+static Autotuner tuner;
+static unsigned long tuneMs;
+
+// Run the relay experiment on the plant until it completes or fails
+static void runExperiment(const AutotuneSettings &settings)
+{
+    ChamberPlant plant(settings.target);
+    tuner.start(settings, TRANSFER_FUNC);
+    float duty = settings.bias;
+    for (tuneMs = ChamberPlant::STEP_MS; tuner.getStatus() == Autotuner::Status::Running; tuneMs += ChamberPlant::STEP_MS)
+        duty = tuner.update(plant.step(duty), tuneMs);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_relay_experiment_completes()
+{
+    runExperiment(SETTINGS);
+    TEST_ASSERT_EQUAL_STRING("Complete", Autotuner::GetStatusName(tuner.getStatus()));
+    TEST_ASSERT_EQUAL(SETTINGS.cycles, tuner.getCompletedCycles());
+
+    const AutotuneResult &result = tuner.getResult();
+    char message[160];
+    snprintf(message, sizeof(message), "%lu s: Ku %.2f Tu %.0f s, K %.2f T %.0f s L %.0f s, Kp %.3f Ki %.5f Kd %.1f",
+             tuneMs / 1000, result.ultimateGain, result.ultimatePeriodS, result.processGain,
+             result.timeConstantS, result.deadTimeS, result.kp, result.ki, result.kd);
+    TEST_MESSAGE(message);
+}
+
+void test_mean_duty_finds_holding_duty()
+{
+    runExperiment(SETTINGS);
+    const AutotuneResult &result = tuner.getResult();
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, PLANT_HOLD_DUTY, result.meanDuty);
+
+    // The corrected table is the old one shifted to that duty
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, PLANT_HOLD_DUTY, result.augerTransferFunc[2][0]);
+    TEST_ASSERT_EQUAL_FLOAT(225.0f, result.augerTransferFunc[2][1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, result.augerTransferFunc[2][0] - 41.0f, result.augerTransferFunc[5][0] - 58.0f);
+}
+
+void test_identified_model_is_close_to_plant()
+{
+    runExperiment(SETTINGS);
+    const AutotuneResult &result = tuner.getResult();
+    // The describing function is an approximation and the gain comes from the
+    // table slope, not the plant: same order of magnitude is what it promises
+    TEST_ASSERT_FLOAT_WITHIN(PLANT_TIME_CONSTANT / 2, PLANT_TIME_CONSTANT, result.timeConstantS);
+    TEST_ASSERT_FLOAT_WITHIN(PLANT_DEAD_TIME, PLANT_DEAD_TIME, result.deadTimeS);
+    TEST_ASSERT_GREATER_THAN(0.0f, result.kp);
+    TEST_ASSERT_GREATER_THAN(0.0f, result.ki);
+    TEST_ASSERT_GREATER_OR_EQUAL(0.0f, result.kd);
+}
+
+// The suggested gains and table must hold a setpoint step on the plant they came from
+void test_suggested_gains_settle_setpoint_step()
+{
+    runExperiment(SETTINGS);
+    const AutotuneResult &result = tuner.getResult();
+
+    PidController pid;
+    pid.setGains(result.kp, result.ki, result.kd);
+    pid.setOutputLimits(0.0f, 100.0f);
+    pid.reset(225.0f);
+    ChamberPlant plant(225.0f);
+    // Feedforward from the corrected table between 225F and 250F
+    const float setpoint = 250.0f;
+    float feedforward = result.augerTransferFunc[3][0];
+
+    unsigned long settledAt = 0;
+    float overshootF = 0.0f;
+    const unsigned long runMs = 4UL * 60 * 60 * 1000;
+    for (unsigned long t = 0; t < runMs; t += ChamberPlant::STEP_MS)
+    {
+        float temperature = plant.step(pid.update(setpoint, plant.temperature, feedforward, ChamberPlant::STEP_MS / 1000.0f));
+        if (temperature - setpoint > overshootF)
+            overshootF = temperature - setpoint;
+        if (fabsf(temperature - setpoint) > 2.0f)
+            settledAt = t + ChamberPlant::STEP_MS;
+    }
+    char message[80];
+    snprintf(message, sizeof(message), "tuned PID: within 2 F after %lu s, overshoot %.1f F", settledAt / 1000, overshootF);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, setpoint, plant.temperature);
+    TEST_ASSERT_LESS_OR_EQUAL(60UL * 60 * 1000, settledAt);
+    TEST_ASSERT_LESS_OR_EQUAL(10.0f, overshootF);
+}
+
+void test_small_oscillation_fails()
+{
+    AutotuneSettings settings = SETTINGS;
+    settings.amplitude = 0.5f; // too small to leave a 2F hysteresis band
+    settings.maxDurationMs = 2UL * 60 * 60 * 1000;
+    runExperiment(settings);
+    TEST_ASSERT_EQUAL_STRING("Failed", Autotuner::GetStatusName(tuner.getStatus()));
+}
+
+void test_cancel_stops_experiment()
+{
+    ChamberPlant plant(225.0f);
+    tuner.start(SETTINGS, TRANSFER_FUNC);
+    tuner.update(plant.step(SETTINGS.bias), ChamberPlant::STEP_MS);
+    tuner.cancel();
+    TEST_ASSERT_EQUAL_STRING("Failed", Autotuner::GetStatusName(tuner.getStatus()));
+    TEST_ASSERT_EQUAL_STRING("cancelled", tuner.getFailureReason());
+    TEST_ASSERT_EQUAL_FLOAT(SETTINGS.bias, tuner.update(225.0f, 2 * ChamberPlant::STEP_MS));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_relay_experiment_completes);
+    RUN_TEST(test_mean_duty_finds_holding_duty);
+    RUN_TEST(test_identified_model_is_close_to_plant);
+    RUN_TEST(test_suggested_gains_settle_setpoint_step);
+    RUN_TEST(test_small_oscillation_fails);
+    RUN_TEST(test_cancel_stops_experiment);
+    return UNITY_END();
+}
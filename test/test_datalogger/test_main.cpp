@@ -0,0 +1,489 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "DataLogger.cpp"
+#include "LogDataStream.cpp"
+#include "LogFormat.cpp"
+#include "LogIndex.cpp"
+#include "TraceBuffer.cpp"
+#include "HostLogger.h"
+
+static const char *DATA_PATH = "/logs/data_0.bin";
+
+const char *SmokerStateMachine::GetStateName(State state)
+{
+    return "Running";
+}
+
+static LogConfig testConfig()
+{
+    LogConfig config = hostLogConfig();
+    config.logIntervalMs = 1000;
+    return config;
+}
+
+// One due sample in state 3 (or state), then a writer task pass
+static void logSample(float temperature, int state = 3)
+{
+    HostClock::advanceMs(1000);
+    DataLogger::logData(temperature, 400.0f, 225.0f, 180.0f, state, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+    runWriter();
+}
+
+static size_t fileSize(const char *path)
+{
+    return HostFs::files().count(path) ? HostFs::files()[path].size() : 0;
+}
+
+void setUp()
+{
+    HostFs::reset();
+    HostClock::set(0);
+    loggerTask.notifications = 0;
+    // The writer task answers flush() requests
+    hostBlockHook() = []()
+    {
+        loggerTask.notifications = 0;
+        runWriter();
+    };
+    DataLogger::init(testConfig());
+    logSample(225.0f); // state change: written at once, leaves nothing staged
+}
+
+void tearDown()
+{
+    hostBlockHook() = nullptr;
+}
+
+void test_count_flush_fills_whole_spiffs_data_pages()
+{
+    size_t flushed = fileSize(DATA_PATH);
+    for (int i = 0; i < 200; i++)
+    {
+        logSample(225.0f + i % 7);
+        size_t size = fileSize(DATA_PATH);
+        if (size != flushed)
+        {
+            // Up to the page boundary, less at most one record
+            size_t pageLeft = (DataLogger::SPIFFS_PAGE_DATA_SIZE - size % DataLogger::SPIFFS_PAGE_DATA_SIZE) % DataLogger::SPIFFS_PAGE_DATA_SIZE;
+            TEST_ASSERT_LESS_THAN(sizeof(LogRecord), pageLeft);
+            TEST_ASSERT_EQUAL(0, (size - sizeof(LogFileHeader)) % sizeof(LogRecord));
+            flushed = size;
+        }
+        TEST_ASSERT_LESS_OR_EQUAL(DataLogger::SPIFFS_PAGE_DATA_SIZE + (DEFAULT_LOG_CONFIG.flushRecords - 1) * sizeof(LogRecord),
+                                  DataLogger::getStagedBytes());
+    }
+    TEST_ASSERT_GREATER_THAN(4 * DataLogger::SPIFFS_PAGE_DATA_SIZE, flushed);
+}
+
+void test_default_flush_records_fit_a_data_page()
+{
+    TEST_ASSERT_LESS_OR_EQUAL(DataLogger::SPIFFS_PAGE_DATA_SIZE, DEFAULT_LOG_CONFIG.flushRecords * sizeof(LogRecord));
+    TEST_ASSERT_GREATER_THAN(DataLogger::SPIFFS_PAGE_DATA_SIZE, (DEFAULT_LOG_CONFIG.flushRecords + 1) * sizeof(LogRecord));
+}
+
+void test_age_flush_counts_time_in_queue()
+{
+    size_t size = fileSize(DATA_PATH);
+    HostClock::advanceMs(1000);
+    DataLogger::logData(226.0f, 400.0f, 225.0f, 180.0f, 3, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+    // The writer does not get to run until the sample is already flushIntervalMs old
+    HostClock::advanceMs(DEFAULT_LOG_CONFIG.flushIntervalMs);
+    runWriter();
+    TEST_ASSERT_EQUAL(0, DataLogger::getStagedBytes());
+    TEST_ASSERT_GREATER_THAN(size, fileSize(DATA_PATH));
+}
+
+static int countSamples(const std::string &data)
+{
+    int count = 0;
+    for (size_t pos = sizeof(LogFileHeader); pos + sizeof(LogRecord) <= data.size(); pos += sizeof(LogRecord))
+    {
+        LogRecord record;
+        memcpy(&record, data.data() + pos, sizeof(record));
+        uint16_t marker = LogFormat::marker(record);
+        if (marker != LOG_SYNC_MARKER && marker != LOG_SETTINGS_MARKER)
+            count++;
+    }
+    return count;
+}
+
+// After a count flush leaves records staged, their age is that of the oldest
+// of them, not a guess from the log interval
+void test_age_of_records_left_staged()
+{
+    LogConfig config = testConfig();
+    config.logIntervalMs = 100;
+    DataLogger::setConfig(config);
+    std::vector<unsigned long> sampleMs = {DataLogger::now()}; // the one from setUp()
+    size_t size = fileSize(DATA_PATH);
+    for (int i = 0; i < 40; i++)
+    {
+        // Irregular spacing, nothing like logIntervalMs
+        HostClock::advanceMs(i % 2 ? 4000 : 900);
+        sampleMs.push_back(DataLogger::now());
+        DataLogger::logData(225.0f, 400.0f, 225.0f, 180.0f, 3, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+        runWriter();
+    }
+    TEST_ASSERT_GREATER_THAN(size, fileSize(DATA_PATH));
+    TEST_ASSERT_GREATER_THAN(0, DataLogger::getStagedBytes());
+
+    // Step to just before the oldest staged sample reaches flushIntervalMs, then to it
+    unsigned long oldestMs = sampleMs[countSamples(HostFs::files()[DATA_PATH])];
+    unsigned long offsetMs = DataLogger::now() - millis();
+    HostClock::set((uint64_t)(oldestMs - offsetMs + DEFAULT_LOG_CONFIG.flushIntervalMs - 1) * 1000);
+    runWriter();
+    TEST_ASSERT_GREATER_THAN(0, DataLogger::getStagedBytes());
+    HostClock::advanceMs(1);
+    runWriter();
+    TEST_ASSERT_EQUAL(0, DataLogger::getStagedBytes());
+}
+
+void test_loss_window_includes_writer_period()
+{
+    TEST_ASSERT_EQUAL(DEFAULT_LOG_CONFIG.flushIntervalMs + DataLogger::WRITER_PERIOD_MS, DataLogger::getLossWindowMs());
+    LogConfig config = testConfig();
+    config.enabled = false;
+    DataLogger::setConfig(config);
+    TEST_ASSERT_EQUAL(0, DataLogger::getLossWindowMs());
+}
+
+// Partition full mid-record: the file keeps its whole records, logging
+// continues in the next file with exact timestamps once there is room
+void test_short_write_rotates_to_next_file()
+{
+    HostFs::freeBytes() = 3 * sizeof(LogRecord) + 4;
+    for (int i = 0; i < 30; i++)
+        logSample(225.0f);
+    DataLogger::flush();
+    std::string &first = HostFs::files()[DATA_PATH];
+    TEST_ASSERT_EQUAL(4, (first.size() - sizeof(LogFileHeader)) % sizeof(LogRecord));
+    TEST_ASSERT_EQUAL_STRING("/logs/data_1.bin", DataLogger::getActiveLogFile().c_str());
+    uint32_t lastMs;
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastMs));
+
+    // Space comes back: the next file gets its header, starting at a sync record for
+    // the oldest sample kept staged meanwhile, and the samples up to now follow it
+    HostFs::freeBytes() = SIZE_MAX;
+    logSample(226.0f);
+    DataLogger::flush();
+    std::string &next = HostFs::files()["/logs/data_1.bin"];
+    LogFileHeader header;
+    memcpy(&header, next.data(), sizeof(header));
+    TEST_ASSERT_TRUE(LogFormat::checkHeader(header));
+    LogSyncRecord sync;
+    memcpy(&sync, next.data() + sizeof(header), sizeof(sync));
+    TEST_ASSERT_EQUAL_UINT16(LOG_SYNC_MARKER, sync.marker);
+    TEST_ASSERT_EQUAL(header.baseTimestampMs, sync.timestampMs);
+    TEST_ASSERT_GREATER_THAN(lastMs, sync.timestampMs);
+    TEST_ASSERT_EQUAL(0, (next.size() - sizeof(header)) % sizeof(LogRecord));
+    LogRecord last;
+    memcpy(&last, next.data() + next.size() - sizeof(last), sizeof(last));
+    TEST_ASSERT_EQUAL(2260, last.smokeChamberTemp);
+}
+
+static void logQueued(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        HostClock::advanceMs(1000);
+        DataLogger::logData(225.0f, 400.0f, 225.0f, 180.0f, 3, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+    }
+}
+
+// A flush from the web task is done by the writer task, including what was
+// still queued, while the web task waits
+void test_flush_from_another_task_runs_on_writer()
+{
+    logQueued(5);
+    size_t size = fileSize(DATA_PATH);
+    bool writerRan = false;
+    hostBlockHook() = [&]()
+    {
+        // Nothing was written on the web task before it waited
+        TEST_ASSERT_EQUAL(size, fileSize(DATA_PATH));
+        TEST_ASSERT_EQUAL(1, loggerTask.notifications);
+        loggerTask.notifications = 0;
+        runWriter();
+        writerRan = true;
+    };
+    DataLogger::flush();
+    TEST_ASSERT_TRUE(writerRan);
+    TEST_ASSERT_EQUAL(0, DataLogger::getQueueStats().depth);
+    TEST_ASSERT_EQUAL(0, DataLogger::getStagedBytes());
+    TEST_ASSERT_GREATER_OR_EQUAL(size + 5 * sizeof(LogRecord), fileSize(DATA_PATH));
+}
+
+// A writer task that does not get to run costs the caller FLUSH_WAIT_MS, not flash I/O
+void test_flush_times_out_without_writer()
+{
+    hostBlockHook() = nullptr;
+    logSample(225.0f);
+    size_t size = fileSize(DATA_PATH);
+    TEST_ASSERT_GREATER_THAN(0, DataLogger::getStagedBytes());
+    DataLogger::flush();
+    TEST_ASSERT_EQUAL(size, fileSize(DATA_PATH));
+    TEST_ASSERT_GREATER_THAN(0, DataLogger::getStagedBytes());
+
+    // The request stands: the writer's next pass writes the records out
+    loggerTask.notifications = 0;
+    runWriter();
+    TEST_ASSERT_EQUAL(0, DataLogger::getStagedBytes());
+    TEST_ASSERT_GREATER_THAN(size, fileSize(DATA_PATH));
+}
+
+// Clearing the logs from the web task: every remove and the new file are done
+// by the writer task while the web task waits
+void test_clear_from_another_task_runs_on_writer()
+{
+    logQueued(5);
+    runWriter();
+    DataLogger::flush();
+    std::vector<std::string> removers;
+    HostFs::removeHook() = [&](const std::string &path)
+    { removers.push_back(pcTaskGetName(nullptr)); };
+
+    DataLogger::clearAllLogs();
+    TEST_ASSERT_GREATER_THAN(0, removers.size());
+    for (const std::string &task : removers)
+        TEST_ASSERT_EQUAL_STRING("logger", task.c_str());
+    TEST_ASSERT_EQUAL(sizeof(LogFileHeader), fileSize(DATA_PATH));
+    TEST_ASSERT_EQUAL(0, DataLogger::getStagedBytes());
+}
+
+// With the writer task held up, the web task gets its timeout and the files
+// are cleared on the writer's next pass
+void test_clear_times_out_without_writer()
+{
+    hostBlockHook() = nullptr;
+    logQueued(5);
+    runWriter();
+    DataLogger::flush();
+    size_t size = fileSize(DATA_PATH);
+    HostFs::removeHook() = [](const std::string &path)
+    { TEST_ASSERT_EQUAL_STRING("logger", pcTaskGetName(nullptr)); };
+
+    DataLogger::clearAllLogs();
+    TEST_ASSERT_EQUAL(size, fileSize(DATA_PATH));
+    loggerTask.notifications = 0;
+    runWriter();
+    TEST_ASSERT_EQUAL(sizeof(LogFileHeader), fileSize(DATA_PATH));
+}
+
+void test_full_queue_counts_dropped_samples()
+{
+    DataLogger::QueueStats before = DataLogger::getQueueStats();
+    logQueued(DataLogger::QUEUE_SIZE + 5);
+    DataLogger::QueueStats stats = DataLogger::getQueueStats();
+    TEST_ASSERT_EQUAL(stats.capacity, stats.depth);
+    TEST_ASSERT_EQUAL(stats.capacity, stats.highWater);
+    TEST_ASSERT_GREATER_OR_EQUAL(before.dropped + 5, stats.dropped);
+    runWriter();
+    TEST_ASSERT_EQUAL(0, DataLogger::getQueueStats().depth);
+}
+
+// Turning logging on with no file to append to leaves creating it to the writer task
+void test_enable_creates_file_on_writer()
+{
+    HostFs::reset();
+    LogConfig config = testConfig();
+    config.enabled = false;
+    DataLogger::init(config);
+    TEST_ASSERT_FALSE(HostFs::files().count(DATA_PATH));
+
+    config.enabled = true;
+    DataLogger::setConfig(config);
+    TEST_ASSERT_FALSE(HostFs::files().count(DATA_PATH));
+
+    unsigned long firstMs = DataLogger::now() + 1000;
+    logSample(225.0f, 4); // a state change, written at once
+    std::string &data = HostFs::files()[DATA_PATH];
+    LogFileHeader header;
+    LogSyncRecord sync;
+    memcpy(&header, data.data(), sizeof(header));
+    memcpy(&sync, data.data() + sizeof(header), sizeof(sync));
+    TEST_ASSERT_TRUE(LogFormat::checkHeader(header));
+    TEST_ASSERT_EQUAL_UINT16(LOG_SYNC_MARKER, sync.marker);
+    TEST_ASSERT_EQUAL(firstMs, sync.timestampMs);
+}
+
+// Samples every 5 s with a temperature that varies from one to the next
+static int logMinutes(int minutes)
+{
+    int count = 0;
+    for (unsigned long ms = 0; ms < minutes * 60000UL; ms += 5000, count++)
+    {
+        HostClock::advanceMs(5000);
+        float temperature = 200.0f + (HostClock::micros() / 1000000) % 50;
+        DataLogger::logData(temperature, 400.0f, 225.0f, 180.0f, 3, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+        runWriter();
+    }
+    return count;
+}
+
+static std::string tierFile(int tier)
+{
+    return HostFs::files()[DataLogger::getTierPath(DATA_PATH, tier).c_str()];
+}
+
+// Power cut after the samples reached flash but with buckets open or pending in
+// RAM: resuming the file at boot rolls them up again, to the same tier records
+void test_boot_rebuilds_buckets_lost_in_power_cut()
+{
+    logMinutes(97);
+    runWriter();
+    DataLogger::flush(true);
+    std::string expected[DataLogger::TIER_COUNT] = {tierFile(0), tierFile(1)};
+
+    HostFs::reset();
+    HostClock::set(0);
+    DataLogger::init(testConfig());
+    logSample(225.0f);
+    logMinutes(97);
+    DataLogger::flush(); // the samples, not the buckets
+    TEST_ASSERT_LESS_THAN(expected[0].size(), tierFile(0).size());
+    TEST_ASSERT_LESS_THAN(expected[1].size(), tierFile(1).size());
+
+    DataLogger::init(testConfig()); // power back on
+    DataLogger::flush(true);
+    for (int tier = 0; tier < DataLogger::TIER_COUNT; tier++)
+    {
+        TEST_ASSERT_EQUAL(expected[tier].size(), tierFile(tier).size());
+        TEST_ASSERT_TRUE(expected[tier] == tierFile(tier));
+    }
+}
+
+// Sum of the Count column of a bucketed CSV export of everything
+static unsigned long exportedCount(int points)
+{
+    LogDataStream stream(0, ULONG_MAX, points, LogDataStream::Format::Csv);
+    std::string csv;
+    uint8_t chunk[256];
+    size_t length;
+    while ((length = stream.read(chunk, sizeof(chunk))) > 0)
+        csv.append((const char *)chunk, length);
+    unsigned long count = 0;
+    for (size_t line = csv.find('\n'); line != std::string::npos && line + 1 < csv.size(); line = csv.find('\n', line + 1))
+        count += strtoul(csv.c_str() + csv.find(',', line) + 1, nullptr, 10);
+    return count;
+}
+
+// A reboot in the middle of buckets, with and without a power cut: bucketed
+// reads still count every sample exactly once
+void test_bucketed_read_across_reboots_counts_every_sample()
+{
+    int samples = 1 + logMinutes(23);
+    DataLogger::flush(true); // reboot from the web page
+    DataLogger::init(testConfig());
+    samples += logMinutes(31);
+    DataLogger::flush(); // power cut
+    DataLogger::init(testConfig());
+    samples += logMinutes(27);
+    runWriter();
+    DataLogger::flush();
+
+    TEST_ASSERT_EQUAL(samples, exportedCount(10)); // 10 minute tier
+    TEST_ASSERT_EQUAL(samples, exportedCount(60)); // 1 minute tier
+    TEST_ASSERT_EQUAL(samples, exportedCount(200)); // samples
+}
+
+// Timestamps of the rows of a CSV export of everything
+static std::vector<unsigned long> exportedTimes()
+{
+    LogDataStream stream(0, ULONG_MAX, 0, LogDataStream::Format::Csv);
+    std::string csv;
+    uint8_t chunk[256];
+    size_t length;
+    while ((length = stream.read(chunk, sizeof(chunk))) > 0)
+        csv.append((const char *)chunk, length);
+    std::vector<unsigned long> times;
+    for (size_t line = csv.find('\n'); line != std::string::npos && line + 1 < csv.size(); line = csv.find('\n', line + 1))
+        times.push_back(strtoul(csv.c_str() + line + 1, nullptr, 10));
+    return times;
+}
+
+// Boot with logging off, turn it on later: the newest file is appended to,
+// and its timeline carries on from before the reboot
+void test_boot_with_logging_off_resumes_newest_file()
+{
+    int samples = 1 + logMinutes(10);
+    DataLogger::flush(true);
+    unsigned long lastMs = DataLogger::now();
+
+    HostClock::set(0); // millis() restarts
+    LogConfig config = testConfig();
+    config.enabled = false;
+    DataLogger::init(config);
+    TEST_ASSERT_GREATER_THAN(lastMs, DataLogger::now());
+    HostClock::advanceMs(60000);
+    config.enabled = true;
+    DataLogger::setConfig(config);
+    samples += logMinutes(10);
+    DataLogger::flush();
+
+    TEST_ASSERT_EQUAL_STRING(DATA_PATH, DataLogger::getActiveLogFile().c_str());
+    std::vector<unsigned long> times = exportedTimes();
+    TEST_ASSERT_EQUAL(samples, times.size());
+    for (size_t i = 1; i < times.size(); i++)
+        TEST_ASSERT_GREATER_THAN(times[i - 1], times[i]);
+}
+
+// The ring wraps several times, then the device reboots: the surviving files
+// are found oldest first from their headers and walked in time order
+void test_ring_walk_after_wrap_and_reboot()
+{
+    LogConfig config = testConfig();
+    config.maxLogFiles = 3;
+    config.maxLogFileSizeBytes = 1000;
+    DataLogger::setConfig(config);
+    int samples = 1 + logMinutes(40); // about 500 records, 5 files' worth
+    DataLogger::flush(true);
+
+    HostClock::set(0);
+    DataLogger::init(config);
+    LogFileSpan span;
+    TEST_ASSERT_TRUE(DataLogger::findLogFile(0, span));
+    int files = 1;
+    unsigned long lastStartMs = span.startMs;
+    LogFileSpan next;
+    while (DataLogger::nextLogFile(span, next))
+    {
+        TEST_ASSERT_GREATER_THAN(lastStartMs, next.startMs);
+        TEST_ASSERT_EQUAL(next.startMs, span.endMs);
+        lastStartMs = next.startMs;
+        span = next;
+        files++;
+    }
+    TEST_ASSERT_EQUAL(3, files);
+    TEST_ASSERT_EQUAL_STRING(DataLogger::getLogFilePath(span.index).c_str(), DataLogger::getActiveLogFile().c_str());
+
+    // What survives is the newest samples, in order, up to the last one logged
+    std::vector<unsigned long> times = exportedTimes();
+    TEST_ASSERT_LESS_THAN(samples, times.size());
+    TEST_ASSERT_GREATER_THAN(0, times.size());
+    for (size_t i = 1; i < times.size(); i++)
+        TEST_ASSERT_GREATER_THAN(times[i - 1], times[i]);
+    TEST_ASSERT_LESS_THAN(DataLogger::now(), times.back());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_count_flush_fills_whole_spiffs_data_pages);
+    RUN_TEST(test_default_flush_records_fit_a_data_page);
+    RUN_TEST(test_age_flush_counts_time_in_queue);
+    RUN_TEST(test_age_of_records_left_staged);
+    RUN_TEST(test_loss_window_includes_writer_period);
+    RUN_TEST(test_short_write_rotates_to_next_file);
+    RUN_TEST(test_flush_from_another_task_runs_on_writer);
+    RUN_TEST(test_flush_times_out_without_writer);
+    RUN_TEST(test_clear_from_another_task_runs_on_writer);
+    RUN_TEST(test_clear_times_out_without_writer);
+    RUN_TEST(test_full_queue_counts_dropped_samples);
+    RUN_TEST(test_enable_creates_file_on_writer);
+    RUN_TEST(test_boot_rebuilds_buckets_lost_in_power_cut);
+    RUN_TEST(test_bucketed_read_across_reboots_counts_every_sample);
+    RUN_TEST(test_boot_with_logging_off_resumes_newest_file);
+    RUN_TEST(test_ring_walk_after_wrap_and_reboot);
+    return UNITY_END();
+}
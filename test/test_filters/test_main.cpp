@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "SignalFilter.cpp"
+
+static const float SAMPLE_PERIOD_S = 0.5f; // task500ms
+
+static SmokerConfig::FilterParams params(int medianLength, float emaAlpha, float lowpassCutoffHz, float slewRateLimit)
+{
+    return {.medianLength = medianLength, .emaAlpha = emaAlpha, .lowpassCutoffHz = lowpassCutoffHz, .slewRateLimit = slewRateLimit};
+}
+
+// A 225F chamber read through the MAX6675: 0.25C steps plus a little noise
+static float reading(int sample)
+{
+    uint32_t seed = sample * 2654435761u;
+    float noise = ((seed >> 16) % 1000) / 1000.0f - 0.5f;
+    float celsius = roundf(((225.0f - 32.0f) * 5.0f / 9.0f + noise) / 0.25f) * 0.25f;
+    return celsius * 9.0f / 5.0f + 32.0f;
+}
+
+// Seconds until the output covers 63% of a 100F step
+static float stepLagS(FilterChain &filter)
+{
+    filter.reset(200.0f);
+    for (int sample = 1; sample < 10000; sample++)
+    {
+        if (filter.update(300.0f) >= 263.2f)
+            return sample * SAMPLE_PERIOD_S;
+    }
+    return INFINITY;
+}
+
+static double nsPerSample(FilterChain &filter)
+{
+    const int samples = 1000000;
+    static float readings[1024];
+    for (int i = 0; i < 1024; i++)
+        readings[i] = reading(i);
+    volatile float sink = 0.0f;
+    filter.reset(readings[0]);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; i++)
+        sink = filter.update(readings[i & 1023]);
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// The stock config is the 0.5 EMA loop() used to apply inline
+void test_stock_chain_matches_legacy_ema()
+{
+    FilterChain filter;
+    filter.configure(params(1, 0.5f, 0.0f, 0.0f), SAMPLE_PERIOD_S);
+    float legacy = filter.update(reading(0));
+    for (int i = 1; i < 500; i++)
+    {
+        float raw = reading(i) + (i > 250 ? 40.0f : 0.0f);
+        legacy = raw * 0.5f + legacy * 0.5f;
+        TEST_ASSERT_EQUAL_FLOAT(legacy, filter.update(raw));
+    }
+}
+
+void test_median_rejects_a_single_glitch()
+{
+    FilterChain filter;
+    filter.configure(params(3, 1.0f, 0.0f, 0.0f), SAMPLE_PERIOD_S);
+    filter.reset(225.0f);
+    TEST_ASSERT_EQUAL_FLOAT(225.0f, filter.update(1800.0f));
+    TEST_ASSERT_EQUAL_FLOAT(226.0f, filter.update(226.0f));
+    TEST_ASSERT_EQUAL_FLOAT(227.0f, filter.update(227.0f));
+    TEST_ASSERT_EQUAL_FLOAT(227.0f, filter.update(228.0f));
+
+    // Even lengths drop to the odd one below: two glitches in a row get through a median of 3
+    filter.configure(params(4, 1.0f, 0.0f, 0.0f), SAMPLE_PERIOD_S);
+    filter.reset(225.0f);
+    TEST_ASSERT_EQUAL_FLOAT(225.0f, filter.update(1800.0f));
+    TEST_ASSERT_EQUAL_FLOAT(1800.0f, filter.update(1800.0f));
+}
+
+void test_lowpass_has_unity_gain_and_no_start_transient()
+{
+    FilterChain filter;
+    filter.configure(params(1, 1.0f, 0.05f, 0.0f), SAMPLE_PERIOD_S);
+    TEST_ASSERT_EQUAL_FLOAT(225.0f, filter.update(225.0f));
+    for (int i = 0; i < 50; i++)
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 225.0f, filter.update(225.0f));
+    for (int i = 0; i < 2000; i++)
+        filter.update(300.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 300.0f, filter.update(300.0f));
+}
+
+void test_slew_limiter_bounds_the_rate()
+{
+    FilterChain filter;
+    filter.configure(params(1, 1.0f, 0.0f, 4.0f), SAMPLE_PERIOD_S);
+    float previous = filter.reset(200.0f);
+    for (int i = 0; i < 20; i++)
+    {
+        float y = filter.update(i < 10 ? 400.0f : 0.0f);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, fabsf(y - previous));
+        previous = y;
+    }
+}
+
+// Retuning mid-cook restarts from the current output instead of kicking the PID
+void test_configure_keeps_the_output_continuous()
+{
+    FilterChain filter;
+    filter.configure(params(1, 0.5f, 0.0f, 0.0f), SAMPLE_PERIOD_S);
+    filter.reset(200.0f);
+    float y = 0.0f;
+    for (int i = 0; i < 3; i++)
+        y = filter.update(300.0f);
+    filter.configure(params(5, 0.2f, 0.1f, 10.0f), SAMPLE_PERIOD_S);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, y, filter.update(y));
+}
+
+void test_params_json_round_trip()
+{
+    JsonDocument doc;
+    FilterChain::saveParams(doc["filter"].to<JsonObject>(), params(5, 0.3f, 0.2f, 6.0f));
+    SmokerConfig::FilterParams loaded = params(1, 1.0f, 0.0f, 0.0f);
+    FilterChain::loadParams(doc["filter"], loaded);
+    TEST_ASSERT_EQUAL(5, loaded.medianLength);
+    TEST_ASSERT_EQUAL_FLOAT(0.3f, loaded.emaAlpha);
+    TEST_ASSERT_EQUAL_FLOAT(0.2f, loaded.lowpassCutoffHz);
+    TEST_ASSERT_EQUAL_FLOAT(6.0f, loaded.slewRateLimit);
+
+    // Missing keys keep what was there
+    JsonDocument partial;
+    partial["filter"]["emaAlpha"] = 0.7f;
+    FilterChain::loadParams(partial["filter"], loaded);
+    TEST_ASSERT_EQUAL(5, loaded.medianLength);
+    TEST_ASSERT_EQUAL_FLOAT(0.7f, loaded.emaAlpha);
+    TEST_ASSERT_EQUAL_FLOAT(6.0f, loaded.slewRateLimit);
+}
+
+// Host cost per sample, step-response lag and the quantization noise left at
+// 225F, for each stage on its own and the whole chain
+void test_benchmark_stages()
+{
+    struct Stage
+    {
+        const char *name;
+        SmokerConfig::FilterParams params;
+        float maxLagS;
+    } stages[] = {
+        {"none", params(1, 1.0f, 0.0f, 0.0f), 0.5f},
+        {"median 5", params(5, 1.0f, 0.0f, 0.0f), 1.5f},
+        {"ema 0.5", params(1, 0.5f, 0.0f, 0.0f), 1.0f},
+        {"lowpass 0.1Hz", params(1, 1.0f, 0.1f, 0.0f), 4.0f},
+        {"slew 4F/s", params(1, 1.0f, 0.0f, 4.0f), 16.0f},
+        {"full chain", params(5, 0.5f, 0.1f, 4.0f), 18.0f},
+    };
+    for (const Stage &stage : stages)
+    {
+        FilterChain filter;
+        filter.configure(stage.params, SAMPLE_PERIOD_S);
+        double ns = nsPerSample(filter);
+        float lagS = stepLagS(filter);
+
+        filter.reset(reading(0));
+        float sumSquares = 0.0f;
+        for (int i = 1; i <= 1000; i++)
+        {
+            float error = filter.update(reading(i)) - 225.0f;
+            sumSquares += error * error;
+        }
+
+        char message[120];
+        snprintf(message, sizeof(message), "%-14s %5.1f ns/sample, 63%% step lag %4.1f s, noise %.3f F rms",
+                 stage.name, ns, lagS, sqrtf(sumSquares / 1000.0f));
+        TEST_MESSAGE(message);
+        TEST_ASSERT_LESS_OR_EQUAL(stage.maxLagS, lagS);
+        TEST_ASSERT_LESS_THAN(1000.0, ns);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stock_chain_matches_legacy_ema);
+    RUN_TEST(test_median_rejects_a_single_glitch);
+    RUN_TEST(test_lowpass_has_unity_gain_and_no_start_transient);
+    RUN_TEST(test_slew_limiter_bounds_the_rate);
+    RUN_TEST(test_configure_keeps_the_output_continuous);
+    RUN_TEST(test_params_json_round_trip);
+    RUN_TEST(test_benchmark_stages);
+    return UNITY_END();
+}
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "FlameoutDetector.cpp"
+
+static const float DT_S = 0.5f; // Auto_Run task rate
+
+// Stock settings from SmokerControl.cpp
+static const FlameoutSettings SETTINGS = {.slopeThreshold = 0.5f, .minFeedGrams = 2.0f, .confidence = 0.8f, .burningTemp = 200.0f};
+
+// Fire pot of a pellet grill, simulated at the task rate. The auger feeds in
+// 10 s time-proportioned cycles, the pellets in the pot burn off with a time
+// constant and the heat they release sets the temperature the pot steel
+// settles to; a dead fire stops burning and the steel cools to ambient.
+// The reading has MAX6675 quantization and a little noise, and goes through
+// the stock 0.5 EMA like filteredFirePotTemp.
+class FirePot
+{
+public:
+    static constexpr float AMBIENT_F = 70.0f;
+    static constexpr float FEED_GRAMS_PER_S = 0.3f; // auger running
+    static constexpr float BURN_TAU_S = 60.0f;
+    static constexpr float STEEL_TAU_S = 90.0f;
+    static constexpr float HEAT_F_PER_GRAM_S = 4400.0f; // steady rise per g/s burned
+
+    explicit FirePot(uint32_t seed) : seed(seed) {}
+
+    // Start at the steady state of a duty cycle
+    void settle(float duty)
+    {
+        float feed = FEED_GRAMS_PER_S * duty / 100.0f;
+        potGrams = feed * BURN_TAU_S;
+        temp = AMBIENT_F + HEAT_F_PER_GRAM_S * feed;
+        filtered = temp;
+    }
+
+    void step(float duty)
+    {
+        bool augerOn = fmodf(timeS, 10.0f) < duty / 10.0f;
+        if (augerOn)
+        {
+            potGrams += FEED_GRAMS_PER_S * DT_S;
+            delivered += FEED_GRAMS_PER_S * DT_S;
+        }
+        float burned = burning ? potGrams * DT_S / BURN_TAU_S : 0.0f;
+        potGrams -= burned;
+        float target = AMBIENT_F + HEAT_F_PER_GRAM_S * burned / DT_S;
+        temp += (target - temp) * DT_S / STEEL_TAU_S;
+        timeS += DT_S;
+
+        seed = seed * 1103515245 + 12345;
+        float noise = ((seed >> 16) % 1000) / 1000.0f - 0.5f;
+        float reading = roundf((temp + noise - 32.0f) * 5.0f / 9.0f / 0.25f) * 0.25f * 9.0f / 5.0f + 32.0f;
+        filtered = reading * 0.5f + filtered * 0.5f;
+    }
+
+    bool burning = true;
+    float delivered = 0.0f;
+    float filtered = AMBIENT_F;
+    float timeS = 0.0f;
+
+private:
+    uint32_t seed;
+    float potGrams = 0.0f;
+    float temp = AMBIENT_F;
+};
+
+// Auger duty the stock auger table gives for a setpoint
+static float dutyFor(float setpoint)
+{
+    return 33.0f + (setpoint - 175.0f) * (67.0f / 250.0f);
+}
+
+// Seconds from the fire going out to the detector declaring it, or -1
+static float detectionLatencyS(float setpoint, float burnS, uint32_t seed)
+{
+    FirePot pot(seed);
+    FlameoutDetector detector;
+    float duty = dutyFor(setpoint);
+    pot.settle(duty);
+    for (float t = 0.0f; t < burnS + 600.0f; t += DT_S)
+    {
+        if (t >= burnS)
+            pot.burning = false;
+        pot.step(duty);
+        if (detector.update(pot.filtered, pot.delivered, DT_S, SETTINGS))
+            return t >= burnS ? t - burnS : -2.0f; // -2: tripped while still burning
+    }
+    return -1.0f;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_flameout_detected_within_a_minute()
+{
+    float worstS = 0.0f;
+    int runs = 0;
+    for (float setpoint = 180.0f; setpoint <= 400.0f; setpoint += 20.0f)
+    {
+        for (uint32_t seed = 1; seed <= 10; seed++)
+        {
+            float latencyS = detectionLatencyS(setpoint, 300.0f + seed * 37.0f, seed);
+            TEST_ASSERT_GREATER_OR_EQUAL(0.0f, latencyS);
+            worstS = max(worstS, latencyS);
+            runs++;
+        }
+    }
+    char message[100];
+    snprintf(message, sizeof(message), "flameout: worst detection latency %.1f s over %d runs", worstS, runs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(60.0f, worstS);
+}
+
+// A healthy fire through setpoint changes up and down, low-and-slow and a
+// hot sear: cooling with the feed reduced is not a flameout
+void test_no_false_positives_over_a_long_cook()
+{
+    const float profile[][2] = {{225.0f, 3600.0f}, {180.0f, 7200.0f}, {275.0f, 3600.0f}, {400.0f, 1800.0f},
+                                {225.0f, 3600.0f}, {180.0f, 3600.0f}, {350.0f, 1200.0f}, {200.0f, 3600.0f}};
+    int trips = 0;
+    float hours = 0.0f;
+    float highestConfidence = 0.0f;
+    for (uint32_t seed = 1; seed <= 5; seed++)
+    {
+        FirePot pot(seed);
+        FlameoutDetector detector;
+        pot.settle(dutyFor(profile[0][0]));
+        for (const auto &step : profile)
+        {
+            float duty = dutyFor(step[0]);
+            for (float t = 0.0f; t < step[1]; t += DT_S)
+            {
+                pot.step(duty);
+                if (detector.update(pot.filtered, pot.delivered, DT_S, SETTINGS))
+                {
+                    trips++;
+                    detector.reset();
+                }
+                highestConfidence = max(highestConfidence, detector.getConfidence());
+            }
+            hours += step[1] / 3600.0f;
+        }
+    }
+    char message[100];
+    snprintf(message, sizeof(message), "healthy fire: %d false flameouts in %.0f h, highest confidence %.2f",
+             trips, hours, highestConfidence);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(0, trips);
+}
+
+// The fire going out just after the setpoint was dropped: the cooling is
+// put down to the feed cut at first, but the auger keeps feeding at the new
+// rate and the pot keeps cooling, so it is still caught
+void test_flameout_after_a_feed_cut_is_caught()
+{
+    FirePot pot(7);
+    FlameoutDetector detector;
+    pot.settle(dutyFor(400.0f));
+    float outS = 660.0f;
+    float latencyS = -1.0f;
+    for (float t = 0.0f; t < 1800.0f && latencyS < 0.0f; t += DT_S)
+    {
+        pot.burning = t < outS;
+        pot.step(dutyFor(t < 600.0f ? 400.0f : 225.0f));
+        if (detector.update(pot.filtered, pot.delivered, DT_S, SETTINGS))
+        {
+            TEST_ASSERT_GREATER_OR_EQUAL(outS, t);
+            latencyS = t - outS;
+        }
+    }
+    char message[100];
+    snprintf(message, sizeof(message), "flameout 60 s after 400F -> 225F: detected after %.1f s", latencyS);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_OR_EQUAL(0.0f, latencyS);
+    TEST_ASSERT_LESS_THAN(300.0f, latencyS);
+}
+
+// A cooling fire pot with the auger stopped is the fire being starved, not a flameout
+void test_cooling_without_feed_is_not_evidence()
+{
+    FirePot pot(3);
+    FlameoutDetector detector;
+    pot.settle(dutyFor(300.0f));
+    for (float t = 0.0f; t < 300.0f; t += DT_S)
+    {
+        pot.step(0.0f);
+        TEST_ASSERT_FALSE(detector.update(pot.filtered, pot.delivered, DT_S, SETTINGS));
+        if (pot.filtered < SETTINGS.burningTemp + 50.0f)
+            break;
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, detector.getConfidence());
+}
+
+void test_below_burning_temperature_is_out()
+{
+    FlameoutDetector detector;
+    int samples = 0;
+    while (!detector.update(150.0f, 0.0f, DT_S, SETTINGS))
+        samples++;
+    // Full evidence every sample: the confidence level times the evidence time, after the window fills
+    TEST_ASSERT_INT_WITHIN(1, FlameoutDetector::WINDOW_SAMPLES - 1 + (int)(SETTINGS.confidence * FlameoutDetector::EVIDENCE_TIME_S / DT_S), samples);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flameout_detected_within_a_minute);
+    RUN_TEST(test_no_false_positives_over_a_long_cook);
+    RUN_TEST(test_flameout_after_a_feed_cut_is_caught);
+    RUN_TEST(test_cooling_without_feed_is_not_evidence);
+    RUN_TEST(test_below_burning_temperature_is_out);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <memory>
+#include <new>
+#include "DataLogger.cpp"
+#include "LogDataStream.cpp"
+#include "LogFormat.cpp"
+#include "LogIndex.cpp"
+#include "TraceBuffer.cpp"
+#include "HostLogger.h"
+
+static const char *DATA_PATH = "/logs/data_0.bin";
+static const size_t CHUNK_BYTES = 1024; // WebInterface::chunkBuffer
+
+// Heap use of everything the test allocates, live and the peak since the last mark
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+
+void *operator new(size_t size)
+{
+    size_t *block = (size_t *)malloc(sizeof(size_t) + size);
+    if (!block)
+        throw std::bad_alloc();
+    *block = size;
+    heapLive += size;
+    heapPeak = max(heapPeak, heapLive);
+    return block + 1;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (!pointer)
+        return;
+    size_t *block = (size_t *)pointer - 1;
+    heapLive -= *block;
+    free(block);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+const char *SmokerStateMachine::GetStateName(State state)
+{
+    return "Running";
+}
+
+static LogConfig testConfig()
+{
+    LogConfig config = hostLogConfig();
+    config.maxLogFiles = 20;
+    return config;
+}
+
+// One log file filled to the rotation size, a sample every 5 s; returns the sample count
+static int fillLogFile()
+{
+    int count = 0;
+    while (HostFs::files()[DATA_PATH].size() + 2 * DEFAULT_LOG_CONFIG.flushRecords * sizeof(LogRecord) <
+           DEFAULT_LOG_CONFIG.maxLogFileSizeBytes)
+    {
+        HostClock::advanceMs(DEFAULT_LOG_CONFIG.logIntervalMs);
+        float temperature = 200.0f + count % 50 + (count % 7) * 0.25f;
+        DataLogger::logData(temperature, 600.0f - count % 40, 225.0f, 180.0f, 3, 0, 2, 41.5f, 0.1f, 2, 55.0f, 0.1f);
+        runWriter();
+        count++;
+    }
+    runWriter();
+    DataLogger::flush();
+    return count;
+}
+
+struct Transfer
+{
+    size_t bytes;
+    size_t rows;
+    size_t peakHeap;    // above what was in use before the request
+    double firstByteMs; // request start to the first byte handed to the socket
+    double totalMs;
+    bool whole; // {"data":[ ... ]}
+};
+
+// Rows are flat objects, so each closing brace but the last ends one
+static size_t countBraces(const char *data, size_t length)
+{
+    size_t braces = 0;
+    for (size_t i = 0; i < length; i++)
+        braces += data[i] == '}';
+    return braces;
+}
+
+// handleGetLogData(): a LogDataStream on the heap, read chunk by chunk into
+// the buffer sendChunked() hands to the server
+static Transfer streamed(int points)
+{
+    static uint8_t socket[CHUNK_BYTES];
+    Transfer transfer = {};
+    heapPeak = heapLive;
+    size_t baseline = heapLive;
+    const char tail[] = "]}";
+    char last[2] = {};
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::shared_ptr<LogDataStream> stream = std::make_shared<LogDataStream>(0, ULONG_MAX, points, LogDataStream::Format::Json);
+        size_t length;
+        while ((length = stream->read(socket, sizeof(socket))) > 0)
+        {
+            if (transfer.bytes == 0)
+            {
+                transfer.firstByteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                transfer.whole = memcmp(socket, "{\"data\":[", 9) == 0;
+            }
+            transfer.rows += countBraces((const char *)socket, length);
+            transfer.bytes += length;
+            last[0] = length > 1 ? socket[length - 2] : last[1];
+            last[1] = socket[length - 1];
+        }
+    }
+    transfer.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    transfer.peakHeap = heapPeak - baseline;
+    transfer.whole = transfer.whole && memcmp(last, tail, 2) == 0;
+    transfer.rows--;
+    return transfer;
+}
+
+// What the handler did before: the whole response built in one String, then sent
+static Transfer buffered(int points)
+{
+    Transfer transfer = {};
+    heapPeak = heapLive;
+    size_t baseline = heapLive;
+    auto start = std::chrono::steady_clock::now();
+    {
+        LogDataStream stream(0, ULONG_MAX, points, LogDataStream::Format::Json);
+        String response;
+        uint8_t row[64];
+        size_t length;
+        while ((length = stream.read(row, sizeof(row))) > 0)
+            response += String(std::string((const char *)row, length));
+        transfer.firstByteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        transfer.bytes = response.length();
+        transfer.rows = countBraces(response.c_str(), response.length()) - 1;
+    }
+    transfer.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    transfer.peakHeap = heapPeak - baseline;
+    return transfer;
+}
+
+static void report(const char *name, const Transfer &transfer)
+{
+    char message[160];
+    snprintf(message, sizeof(message), "%-22s %7zu bytes, %5zu rows: peak heap %7zu bytes, first byte %7.3f ms, all %7.1f ms",
+             name, transfer.bytes, transfer.rows, transfer.peakHeap, transfer.firstByteMs, transfer.totalMs);
+    TEST_MESSAGE(message);
+}
+
+static int samples = 0;
+
+void setUp()
+{
+    if (samples > 0)
+        return;
+    HostFs::reset();
+    HostClock::set(0);
+    DataLogger::init(testConfig());
+    samples = fillLogFile();
+}
+
+void tearDown() {}
+
+// Every sample of a full-size log as JSON rows: the response is far bigger than
+// the heap of an ESP32, the stream never holds more than a few KB of it
+void test_full_log_streams_in_bounded_memory()
+{
+    Transfer transfer = streamed(0);
+    report("streamed", transfer);
+    TEST_ASSERT_TRUE(transfer.whole);
+    TEST_ASSERT_EQUAL(samples, transfer.rows);
+    TEST_ASSERT_GREATER_THAN(500000, transfer.bytes);
+    TEST_ASSERT_LESS_THAN(4096, transfer.peakHeap);
+    TEST_ASSERT_LESS_THAN(transfer.totalMs / 100.0, transfer.firstByteMs);
+}
+
+// A chart of the whole log at 200 points comes from the rolled-up tiers
+void test_bucketed_chart_streams_in_bounded_memory()
+{
+    Transfer transfer = streamed(200);
+    report("streamed, 200 points", transfer);
+    TEST_ASSERT_TRUE(transfer.whole);
+    TEST_ASSERT_GREATER_THAN(100, transfer.rows);
+    TEST_ASSERT_LESS_OR_EQUAL(201, transfer.rows);
+    TEST_ASSERT_LESS_THAN(4096, transfer.peakHeap);
+}
+
+// The same response built in one String first, as the handler used to: heap
+// grows with the log and nothing goes out until the last row is formatted
+void test_benchmark_against_one_response_string()
+{
+    Transfer stream = streamed(0);
+    Transfer legacy = buffered(0);
+    report("one response String", legacy);
+    report("streamed", stream);
+    TEST_ASSERT_EQUAL(legacy.bytes, stream.bytes);
+    TEST_ASSERT_GREATER_THAN(legacy.bytes, legacy.peakHeap + 1);
+    TEST_ASSERT_LESS_THAN(legacy.peakHeap / 100, stream.peakHeap);
+    TEST_ASSERT_LESS_THAN(legacy.firstByteMs, stream.firstByteMs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_log_streams_in_bounded_memory);
+    RUN_TEST(test_bucketed_chart_streams_in_bounded_memory);
+    RUN_TEST(test_benchmark_against_one_response_string);
+    return UNITY_END();
+}
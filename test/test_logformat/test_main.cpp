@@ -0,0 +1,215 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "DataLogger.cpp"
+#include "LogDataStream.cpp"
+#include "LogFormat.cpp"
+#include "LogIndex.cpp"
+#include "TraceBuffer.cpp"
+
+const char *SmokerStateMachine::GetStateName(State state)
+{
+    switch (state)
+    {
+    case State::Startup_IgniterOn:
+        return "Heating";
+    case State::Startup_Stabilize:
+        return "Stabilizing Burn";
+    case State::Auto_Run:
+        return "Running";
+    case State::Shutdown_Cool:
+        return "Cooldown";
+    default:
+        return "Unknown";
+    }
+}
+
+static const char *LEGACY_CSV_HEADER = "Timestamp,SmokeChamberTemp,FirePotTemp,Setpoint,SmokeSetpoint,ActiveState,"
+                                       "IgniterMode,AugerMode,AugerDutyCycle,AugerFrequency,"
+                                       "FanMode,FanDutyCycle,FanFrequency\n";
+
+// The line the CSV logger wrote for each sample before the binary format
+static std::string legacyLine(const LogSample &sample)
+{
+    char line[200];
+    snprintf(line, sizeof(line), "%lu,%.2f,%.2f,%.2f,%.2f,%s,%d,%d,%.2f,%.2f,%d,%.2f,%.2f\n",
+             sample.timestampMs, sample.smokeChamberTemp, sample.firePotTemp, sample.setpoint, sample.smokesetpoint,
+             SmokerStateMachine::GetStateName((SmokerStateMachine::State)sample.state), sample.igniterMode,
+             sample.augerMode, sample.augerDutyCycle, sample.augerFrequency, sample.fanMode, sample.fanDutyCycle,
+             sample.fanFrequency);
+    return line;
+}
+
+static float steps(float value, float step) { return roundf(value / step) * step; }
+
+// A four hour cook logged every 5 s: ignition, stabilize, three hours at 225F
+// with a setpoint change, cooldown. Values are on the record scales, so a
+// lossless round trip is expected. Returns the legacy CSV of the same samples.
+static std::string logCook()
+{
+    struct Phase
+    {
+        int state;
+        unsigned long minutes;
+    } phases[] = {{3, 10}, {5, 15}, {10, 190}, {11, 25}};
+
+    std::string legacy = LEGACY_CSV_HEADER;
+    float chamber = 70.0f;
+    int sample = 0;
+    for (const Phase &phase : phases)
+    {
+        for (unsigned long ms = 0; ms < phase.minutes * 60000; ms += 5000, sample++)
+        {
+            float setpoint = sample < 2000 ? 225.0f : 250.0f;
+            float target = phase.state == 11 ? 70.0f : (phase.state == 10 ? setpoint : 150.0f);
+            chamber += (target - chamber) * 0.01f + 1.5f * sinf(sample * 0.3f);
+            LogSample logged = {DataLogger::now(), steps(chamber, 0.1f), steps(chamber * 1.8f + 40.0f, 0.1f), setpoint,
+                                steps(50.0f + (sample / 500) * 2.5f, 0.5f), phase.state, phase.state == 3 ? 1 : 0,
+                                2, steps(41.0f + 10.0f * sinf(sample * 0.05f), 0.5f), 0.1f, 2,
+                                steps(50.0f + 5.0f * cosf(sample * 0.02f), 0.5f), steps(0.1f + (phase.state == 5) * 0.4f, 0.1f)};
+            DataLogger::logData(logged.smokeChamberTemp, logged.firePotTemp, logged.setpoint, logged.smokesetpoint,
+                                logged.state, logged.igniterMode, logged.augerMode, logged.augerDutyCycle,
+                                logged.augerFrequency, logged.fanMode, logged.fanDutyCycle, logged.fanFrequency);
+            DataLogger::writerTask();
+            legacy += legacyLine(logged);
+            HostClock::advanceMs(5000);
+        }
+    }
+    DataLogger::flush();
+    return legacy;
+}
+
+static std::string exportAll(LogDataStream::Format format)
+{
+    LogDataStream stream(0, ULONG_MAX, 0, format);
+    std::string out;
+    uint8_t chunk[512];
+    size_t count;
+    while ((count = stream.read(chunk, sizeof(chunk))) > 0)
+        out.append((const char *)chunk, count);
+    return out;
+}
+
+static size_t flashBytes(const char *suffix)
+{
+    size_t bytes = 0;
+    for (const auto &file : HostFs::files())
+    {
+        const std::string &path = file.first;
+        if (path.size() >= strlen(suffix) && path.compare(path.size() - strlen(suffix), std::string::npos, suffix) == 0)
+            bytes += file.second.size();
+    }
+    return bytes;
+}
+
+void setUp()
+{
+    HostFs::reset();
+    HostClock::set(1000000);
+    LogConfig config = DEFAULT_LOG_CONFIG;
+    config.enabled = true;
+    config.maxLogFiles = 20;
+    DataLogger::init(config);
+    HostClock::advanceMs(config.logIntervalMs); // first sample due
+}
+
+void tearDown() {}
+
+void test_csv_export_reproduces_legacy_log()
+{
+    std::string legacy = logCook();
+    std::string exported = exportAll(LogDataStream::Format::Csv);
+    TEST_ASSERT_EQUAL(legacy.size(), exported.size());
+    TEST_ASSERT_TRUE(legacy == exported);
+}
+
+// The same cook as the old CSV log and as binary records plus their index:
+// at least five times the history in the same flash
+void test_binary_log_holds_five_times_more_history()
+{
+    std::string legacy = logCook();
+    size_t binary = flashBytes(".bin") + flashBytes(".idx");
+    size_t tiers = flashBytes(".1m") + flashBytes(".10m");
+    char message[120];
+    snprintf(message, sizeof(message), "CSV %u bytes, binary %u bytes + tiers %u: %.1fx, %.1fx with tiers",
+             (unsigned)legacy.size(), (unsigned)binary, (unsigned)tiers, (double)legacy.size() / binary,
+             (double)legacy.size() / (binary + tiers));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_OR_EQUAL(5.0 * binary, legacy.size());
+}
+
+void test_record_round_trip()
+{
+    LogSample sample = {123456, 225.04f, -40.0f, 250.0f, 81.3f, 10, 1, 2, 41.26f, 0.1f, 3, 99.9f, 2.5f};
+    LogFileHeader header = LogFormat::makeHeader(0);
+    LogRecord record = LogFormat::encode(sample, 5000);
+    LogSettingsRecord settings = LogFormat::encodeSettings(sample);
+    LogSample decoded;
+    LogFormat::decode(header, settings, record, sample.timestampMs, decoded);
+
+    TEST_ASSERT_EQUAL(5000, record.deltaMs);
+    TEST_ASSERT_EQUAL(sample.timestampMs, decoded.timestampMs);
+    TEST_ASSERT_FLOAT_WITHIN(header.tempScale / 2, sample.smokeChamberTemp, decoded.smokeChamberTemp);
+    TEST_ASSERT_FLOAT_WITHIN(header.tempScale / 2, sample.firePotTemp, decoded.firePotTemp);
+    TEST_ASSERT_FLOAT_WITHIN(header.tempScale / 2, sample.setpoint, decoded.setpoint);
+    TEST_ASSERT_FLOAT_WITHIN(header.smokeSetpointScale / 2, sample.smokesetpoint, decoded.smokesetpoint);
+    TEST_ASSERT_EQUAL(sample.state, decoded.state);
+    TEST_ASSERT_EQUAL(sample.igniterMode, decoded.igniterMode);
+    TEST_ASSERT_EQUAL(sample.augerMode, decoded.augerMode);
+    TEST_ASSERT_EQUAL(sample.fanMode, decoded.fanMode);
+    TEST_ASSERT_FLOAT_WITHIN(header.dutyScale / 2, sample.augerDutyCycle, decoded.augerDutyCycle);
+    TEST_ASSERT_FLOAT_WITHIN(header.dutyScale / 2, sample.fanDutyCycle, decoded.fanDutyCycle);
+    TEST_ASSERT_FLOAT_WITHIN(header.frequencyScale / 2, sample.augerFrequency, decoded.augerFrequency);
+    TEST_ASSERT_FLOAT_WITHIN(header.frequencyScale / 2, sample.fanFrequency, decoded.fanFrequency);
+}
+
+void test_invalid_temperature_round_trips_as_nan()
+{
+    LogSample sample = {0, NAN, 1.0e6f, 225.0f, 180.0f, 10, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f};
+    LogRecord record = LogFormat::encode(sample, 0);
+    TEST_ASSERT_EQUAL(LOG_INVALID_TEMP, record.smokeChamberTemp);
+    TEST_ASSERT_EQUAL(LOG_INVALID_TEMP, record.firePotTemp);
+    LogSample decoded;
+    LogFormat::decode(LogFormat::makeHeader(0), LogFormat::encodeSettings(sample), record, 0, decoded);
+    TEST_ASSERT_FLOAT_IS_NAN(decoded.smokeChamberTemp);
+    TEST_ASSERT_FLOAT_IS_NAN(decoded.firePotTemp);
+}
+
+// A gap longer than a 16-bit delta (logging paused) goes through a sync record
+void test_long_gap_keeps_exact_timestamps()
+{
+    unsigned long firstMs = DataLogger::now();
+    DataLogger::logData(225.0f, 400.0f, 225.0f, 180.0f, 10, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+    DataLogger::writerTask();
+    HostClock::advanceMs(10UL * 60 * 1000);
+    unsigned long secondMs = DataLogger::now();
+    DataLogger::logData(226.0f, 400.0f, 225.0f, 180.0f, 10, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+    DataLogger::writerTask();
+    DataLogger::flush();
+
+    std::string csv = exportAll(LogDataStream::Format::Csv);
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, csv.find("\n" + std::to_string(firstMs) + ",225.00,"));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, csv.find("\n" + std::to_string(secondMs) + ",226.00,"));
+}
+
+// A file cut short in the middle of a record (partition full) still decodes up to it
+void test_partial_record_at_end_is_ignored()
+{
+    logCook();
+    std::string before = exportAll(LogDataStream::Format::Csv);
+    std::string &active = HostFs::files()[DataLogger::getActiveLogFile().c_str()];
+    active.append("\x10\x27\x01", 3);
+    TEST_ASSERT_TRUE(before == exportAll(LogDataStream::Format::Csv));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_csv_export_reproduces_legacy_log);
+    RUN_TEST(test_binary_log_holds_five_times_more_history);
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_invalid_temperature_round_trips_as_nan);
+    RUN_TEST(test_long_gap_keeps_exact_timestamps);
+    RUN_TEST(test_partial_record_at_end_is_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,277 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "DataLogger.cpp"
+#include "LogDataStream.cpp"
+#include "LogFormat.cpp"
+#include "LogIndex.cpp"
+#include "TraceBuffer.cpp"
+#include "HostLogger.h"
+
+static const char *DATA_PATH = "/logs/data_0.bin";
+static const char *INDEX_PATH = "/logs/data_0.idx";
+
+const char *SmokerStateMachine::GetStateName(State state)
+{
+    return "Running";
+}
+
+static LogConfig testConfig()
+{
+    LogConfig config = hostLogConfig();
+    config.logIntervalMs = 1000;
+    config.maxLogFiles = 20;
+    return config;
+}
+
+static std::vector<unsigned long> loggedMs; // log time of every sample, in order
+
+// count samples a second apart in Auto_Run, then everything flushed
+static void logSamples(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        HostClock::advanceMs(1000);
+        loggedMs.push_back(DataLogger::now());
+        DataLogger::logData(225.0f + i % 9, 400.0f, 225.0f, 180.0f, 10, 0, 2, 41.0f, 0.1f, 2, 50.0f, 0.1f);
+        runWriter();
+    }
+    DataLogger::flush();
+}
+
+// What the index should hold: every sync record of the data file, by a full scan
+static std::vector<LogIndexEntry> scanSyncs()
+{
+    const std::string &data = HostFs::files()[DATA_PATH];
+    std::vector<LogIndexEntry> syncs;
+    for (size_t offset = sizeof(LogFileHeader); offset + sizeof(LogRecord) <= data.size(); offset += sizeof(LogRecord))
+    {
+        LogSyncRecord sync;
+        memcpy(&sync, data.data() + offset, sizeof(sync));
+        if (sync.marker == LOG_SYNC_MARKER)
+            syncs.push_back({sync.timestampMs, (uint32_t)offset});
+    }
+    return syncs;
+}
+
+static std::vector<LogIndexEntry> indexEntries()
+{
+    const std::string &index = HostFs::files()[INDEX_PATH];
+    std::vector<LogIndexEntry> entries(index.size() / sizeof(LogIndexEntry));
+    memcpy(entries.data(), index.data(), entries.size() * sizeof(LogIndexEntry));
+    return entries;
+}
+
+static void assertIndexMatchesData()
+{
+    std::vector<LogIndexEntry> expected = scanSyncs();
+    std::vector<LogIndexEntry> entries = indexEntries();
+    TEST_ASSERT_EQUAL(0, HostFs::files()[INDEX_PATH].size() % sizeof(LogIndexEntry));
+    TEST_ASSERT_EQUAL(expected.size(), entries.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].timestampMs, entries[i].timestampMs);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].offset, entries[i].offset);
+    }
+}
+
+static size_t csvRows(unsigned long startMs, unsigned long endMs)
+{
+    LogDataStream stream(startMs, endMs, 0, LogDataStream::Format::Csv);
+    size_t rows = 0;
+    uint8_t chunk[512];
+    size_t count;
+    while ((count = stream.read(chunk, sizeof(chunk))) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+            rows += chunk[i] == '\n';
+    }
+    return rows - 1; // less the column names
+}
+
+void setUp()
+{
+    HostFs::reset();
+    HostClock::set(0);
+    loggedMs.clear();
+    loggerTask.notifications = 0;
+    hostBlockHook() = []()
+    {
+        loggerTask.notifications = 0;
+        runWriter();
+    };
+    DataLogger::init(testConfig());
+}
+
+void tearDown()
+{
+    hostBlockHook() = nullptr;
+}
+
+void test_index_has_a_block_every_block_records_samples()
+{
+    logSamples(2000);
+    assertIndexMatchesData();
+    std::vector<LogIndexEntry> entries = indexEntries();
+    TEST_ASSERT_GREATER_OR_EQUAL(2000 / LogIndex::BLOCK_RECORDS, entries.size());
+    size_t blockBytes = (LogIndex::BLOCK_RECORDS + 2) * sizeof(LogRecord); // sync, settings, samples
+    for (size_t i = 1; i < entries.size(); i++)
+    {
+        TEST_ASSERT_TRUE(entries[i].timestampMs >= entries[i - 1].timestampMs);
+        TEST_ASSERT_LESS_OR_EQUAL(blockBytes, entries[i].offset - entries[i - 1].offset);
+    }
+}
+
+// find() gives the last block starting before the time asked for, by binary search
+void test_find_seeks_to_the_block_holding_the_start()
+{
+    logSamples(2000);
+    std::vector<LogIndexEntry> syncs = scanSyncs();
+    for (size_t i = 0; i < loggedMs.size(); i += 7)
+    {
+        uint32_t startMs = loggedMs[i];
+        size_t bytesBefore = HostFs::bytesRead();
+        uint32_t offset = LogIndex::find(DATA_PATH, startMs);
+        // log2(31 entries) probes plus the entry read back
+        TEST_ASSERT_LESS_OR_EQUAL(7 * sizeof(LogIndexEntry), HostFs::bytesRead() - bytesBefore);
+
+        size_t block = 0;
+        while (block < syncs.size() && syncs[block].timestampMs < startMs)
+            block++;
+        uint32_t expected = block > 0 ? syncs[block - 1].offset : sizeof(LogFileHeader);
+        TEST_ASSERT_EQUAL_UINT32(expected, offset);
+    }
+    TEST_ASSERT_EQUAL_UINT32(sizeof(LogFileHeader), LogIndex::find(DATA_PATH, 0));
+    TEST_ASSERT_EQUAL_UINT32(syncs.back().offset, LogIndex::find(DATA_PATH, UINT32_MAX));
+}
+
+void test_range_query_reads_only_the_blocks_it_needs()
+{
+    logSamples(2000);
+    size_t dataSize = HostFs::files()[DATA_PATH].size();
+
+    // The last 10 minutes of a 33 minute log
+    unsigned long startMs = loggedMs.back() - 600000;
+    size_t bytesBefore = HostFs::bytesRead();
+    TEST_ASSERT_EQUAL(601, csvRows(startMs, ULONG_MAX));
+    size_t bytesRead = HostFs::bytesRead() - bytesBefore;
+    char message[80];
+    snprintf(message, sizeof(message), "last 10 min: read %u of %u bytes", (unsigned)bytesRead, (unsigned)dataSize);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(dataSize / 2, bytesRead);
+
+    // A window in the middle, both ends inclusive
+    TEST_ASSERT_EQUAL(301, csvRows(loggedMs[500], loggedMs[800]));
+    TEST_ASSERT_EQUAL(1, csvRows(loggedMs[1234], loggedMs[1234]));
+    TEST_ASSERT_EQUAL(loggedMs.size(), csvRows(0, ULONG_MAX));
+}
+
+void test_missing_index_is_rebuilt_at_boot()
+{
+    logSamples(1000);
+    std::vector<LogIndexEntry> before = indexEntries();
+    HostFs::files().erase(INDEX_PATH);
+
+    DataLogger::init(testConfig());
+    assertIndexMatchesData();
+    TEST_ASSERT_EQUAL(before.size(), indexEntries().size());
+}
+
+void test_index_survives_reboot_and_keeps_growing()
+{
+    logSamples(1000);
+    std::string before = HostFs::files()[INDEX_PATH];
+
+    HostClock::set(0); // millis() restarts
+    DataLogger::init(testConfig());
+    TEST_ASSERT_TRUE(before == HostFs::files()[INDEX_PATH]);
+
+    logSamples(500);
+    assertIndexMatchesData();
+    TEST_ASSERT_EQUAL(500, csvRows(loggedMs[1000] - 1, ULONG_MAX));
+}
+
+// Entries are appended after their records reach flash: a power cut in between
+// loses the tail of the index, which update() adds back without a full rescan
+void test_entries_lost_to_a_power_cut_are_added_back()
+{
+    logSamples(2000);
+    std::string &index = HostFs::files()[INDEX_PATH];
+    index.resize(index.size() - 3 * sizeof(LogIndexEntry));
+
+    size_t bytesBefore = HostFs::bytesRead();
+    uint32_t lastTimestampMs;
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastTimestampMs));
+    TEST_ASSERT_EQUAL_UINT32(loggedMs.back(), lastTimestampMs);
+    assertIndexMatchesData();
+    TEST_ASSERT_LESS_THAN(HostFs::files()[DATA_PATH].size() / 4, HostFs::bytesRead() - bytesBefore);
+}
+
+void test_damaged_index_is_rebuilt()
+{
+    logSamples(2000);
+    uint32_t lastTimestampMs;
+
+    // Cut mid-entry
+    HostFs::files()[INDEX_PATH].resize(HostFs::files()[INDEX_PATH].size() - 3);
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastTimestampMs));
+    assertIndexMatchesData();
+
+    // Last entry past the end of the data
+    LogIndexEntry bogus = {(uint32_t)loggedMs.back(), (uint32_t)HostFs::files()[DATA_PATH].size()};
+    HostFs::files()[INDEX_PATH].append((const char *)&bogus, sizeof(bogus));
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastTimestampMs));
+    assertIndexMatchesData();
+
+    // Last entry not pointing at a sync record
+    std::vector<LogIndexEntry> entries = indexEntries();
+    entries.back().offset += sizeof(LogRecord);
+    HostFs::files()[INDEX_PATH].assign((const char *)entries.data(), entries.size() * sizeof(LogIndexEntry));
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastTimestampMs));
+    assertIndexMatchesData();
+    TEST_ASSERT_EQUAL_UINT32(loggedMs.back(), lastTimestampMs);
+}
+
+// An index left from an older file in the same slot points at sync records
+// that are no longer there, or carry another time
+void test_stale_index_from_an_older_file_is_rebuilt()
+{
+    logSamples(2000);
+    std::string stale = HostFs::files()[INDEX_PATH];
+
+    HostFs::reset();
+    loggedMs.clear();
+    HostClock::set(5000000);
+    DataLogger::init(testConfig());
+    logSamples(2000);
+    HostFs::files()[INDEX_PATH] = stale;
+
+    uint32_t lastTimestampMs;
+    TEST_ASSERT_TRUE(LogIndex::update(DATA_PATH, lastTimestampMs));
+    assertIndexMatchesData();
+    TEST_ASSERT_EQUAL_UINT32(loggedMs.back(), lastTimestampMs);
+}
+
+void test_update_rejects_a_file_without_a_header()
+{
+    uint32_t lastTimestampMs = 0;
+    HostFs::files()["/logs/data_7.bin"] = "SLO";
+    TEST_ASSERT_FALSE(LogIndex::update("/logs/data_7.bin", lastTimestampMs));
+    TEST_ASSERT_FALSE(LogIndex::update("/logs/data_8.bin", lastTimestampMs));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(LogFileHeader), LogIndex::find("/logs/data_8.bin", 1000));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_index_has_a_block_every_block_records_samples);
+    RUN_TEST(test_find_seeks_to_the_block_holding_the_start);
+    RUN_TEST(test_range_query_reads_only_the_blocks_it_needs);
+    RUN_TEST(test_missing_index_is_rebuilt_at_boot);
+    RUN_TEST(test_index_survives_reboot_and_keeps_growing);
+    RUN_TEST(test_entries_lost_to_a_power_cut_are_added_back);
+    RUN_TEST(test_damaged_index_is_rebuilt);
+    RUN_TEST(test_stale_index_from_an_older_file_is_rebuilt);
+    RUN_TEST(test_update_rejects_a_file_without_a_header);
+    return UNITY_END();
+}
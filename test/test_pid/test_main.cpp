@@ -0,0 +1,172 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "PidController.cpp"
+
+// Chamber temperature against auger duty as a first-order plus dead time
+// plant: 5 F per % duty, 600 s time constant, 60 s transport delay. It needs
+// 5% more duty than the default transfer function says for any temperature,
+// so holding the setpoint takes more than feedforward.
+class ChamberPlant
+{
+public:
+    static const int STEP_MS = 500;
+
+    explicit ChamberPlant(float startF) : temperature(startF), head(0)
+    {
+        for (float &duty : delayed)
+            duty = dutyFor(startF);
+    }
+
+    static float dutyFor(float temperatureF) { return 46.0f + (temperatureF - 225.0f) / 5.0f; }
+
+    float step(float duty)
+    {
+        float applied = delayed[head];
+        delayed[head] = duty;
+        head = (head + 1) % DELAY_STEPS;
+        float target = 225.0f + 5.0f * (applied - 46.0f);
+        temperature += (target - temperature) * (STEP_MS / 1000.0f) / 600.0f;
+        return temperature;
+    }
+
+    float temperature;
+
+private:
+    static const int DELAY_STEPS = 60 * 1000 / STEP_MS;
+    float delayed[DELAY_STEPS];
+    int head;
+};
+
+// Default augerTransferFunc between 225F and 275F
+static float feedforward(float setpointF)
+{
+    if (setpointF <= 250.0f)
+        return 41.0f + (setpointF - 225.0f) * (47.0f - 41.0f) / 25.0f;
+    return 47.0f + (setpointF - 250.0f) * (52.0f - 47.0f) / 25.0f;
+}
+
+// The Auto mode regulation the PID replaced: feedforward +-10% past 5F of
+// error, 2%/F inside it, nothing under 5%
+static float legacyDuty(float setpointF, float temperatureF)
+{
+    float offset = constrain((setpointF - temperatureF) * 2.0f, -10.0f, 10.0f);
+    if (fabsf(offset) < 5.0f)
+        offset = 0.0f;
+    return constrain(feedforward(setpointF) + offset, 0.0f, 100.0f);
+}
+
+static const unsigned long RUN_MS = 4UL * 60 * 60 * 1000;
+
+// Step the setpoint from 225F (plant settled there) to 250F and run for four
+// hours. Returns the time from the step until the temperature last entered
+// +-bandF of the setpoint, RUN_MS if it was outside at the end.
+template <typename Controller>
+static unsigned long settlingMs(Controller duty, float bandF, float &overshootF)
+{
+    const float setpoint = 250.0f;
+    ChamberPlant plant(225.0f);
+    unsigned long settledAt = 0;
+    overshootF = 0.0f;
+    for (unsigned long t = 0; t < RUN_MS; t += ChamberPlant::STEP_MS)
+    {
+        float temperature = plant.step(duty(setpoint, plant.temperature));
+        overshootF = max(overshootF, temperature - setpoint);
+        if (fabsf(temperature - setpoint) > bandF)
+            settledAt = t + ChamberPlant::STEP_MS;
+    }
+    return fabsf(plant.temperature - setpoint) > bandF ? RUN_MS : settledAt;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_pid_settles_after_setpoint_step()
+{
+    PidController pid;
+    pid.setGains(2.0f, 0.01f, 0.0f); // TunableParams defaults
+    pid.setOutputLimits(0.0f, 100.0f);
+    pid.reset(225.0f);
+
+    float overshootF;
+    unsigned long ms = settlingMs([&](float setpoint, float temperature)
+                                  { return pid.update(setpoint, temperature, feedforward(setpoint), ChamberPlant::STEP_MS / 1000.0f); },
+                                  5.0f, overshootF);
+    char message[80];
+    snprintf(message, sizeof(message), "PID: settled in %lu s, overshoot %.1f F", ms / 1000, overshootF);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(15UL * 60 * 1000, ms);
+    TEST_ASSERT_LESS_OR_EQUAL(15.0f, overshootF);
+}
+
+// The legacy offset parks 2-3F short of the setpoint (its deadband hides the
+// feedforward error); the integrator takes the PID all the way there
+void test_pid_settles_closer_than_legacy_offset()
+{
+    PidController pid;
+    pid.setGains(2.0f, 0.01f, 0.0f);
+    pid.setOutputLimits(0.0f, 100.0f);
+    pid.reset(225.0f);
+
+    float pidOvershootF, legacyOvershootF;
+    unsigned long pidMs = settlingMs([&](float setpoint, float temperature)
+                                     { return pid.update(setpoint, temperature, feedforward(setpoint), ChamberPlant::STEP_MS / 1000.0f); },
+                                     2.0f, pidOvershootF);
+    unsigned long legacyMs = settlingMs(legacyDuty, 2.0f, legacyOvershootF);
+    char message[80];
+    snprintf(message, sizeof(message), "within 2 F: PID after %lu s, legacy after %lu s", pidMs / 1000, legacyMs / 1000);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(legacyMs, pidMs);
+}
+
+void test_integral_removes_feedforward_error()
+{
+    PidController pid;
+    pid.setGains(2.0f, 0.01f, 0.0f);
+    pid.setOutputLimits(0.0f, 100.0f);
+    pid.reset(225.0f);
+    ChamberPlant plant(225.0f);
+    float duty = 0.0f;
+    for (unsigned long t = 0; t < RUN_MS; t += ChamberPlant::STEP_MS)
+    {
+        duty = pid.update(225.0f, plant.temperature, feedforward(225.0f), ChamberPlant::STEP_MS / 1000.0f);
+        plant.step(duty);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 225.0f, plant.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, ChamberPlant::dutyFor(225.0f), duty);
+}
+
+void test_integrator_does_not_wind_up_at_full_duty()
+{
+    PidController pid;
+    pid.setGains(2.0f, 0.01f, 0.0f);
+    pid.setOutputLimits(0.0f, 100.0f);
+    pid.reset(70.0f);
+    // Cold start far below the setpoint: the output saturates for a long time
+    for (int i = 0; i < 7200; i++)
+        TEST_ASSERT_EQUAL_FLOAT(100.0f, pid.update(400.0f, 70.0f, feedforward(250.0f), 0.5f));
+    TEST_ASSERT_LESS_OR_EQUAL(100.0f - feedforward(250.0f), pid.getIntegral());
+
+    // Once past the setpoint the duty drops at once rather than unwinding
+    TEST_ASSERT_LESS_THAN(feedforward(250.0f), pid.update(250.0f, 260.0f, feedforward(250.0f), 0.5f));
+}
+
+void test_setpoint_step_does_not_kick_derivative()
+{
+    PidController pid;
+    pid.setGains(0.0f, 0.0f, 50.0f);
+    pid.reset(225.0f);
+    pid.update(225.0f, 225.0f, 41.0f, 0.5f);
+    TEST_ASSERT_EQUAL_FLOAT(41.0f, pid.update(275.0f, 225.0f, 41.0f, 0.5f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, pid.getDerivative());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pid_settles_after_setpoint_step);
+    RUN_TEST(test_pid_settles_closer_than_legacy_offset);
+    RUN_TEST(test_integral_removes_feedforward_error);
+    RUN_TEST(test_integrator_does_not_wind_up_at_full_duty);
+    RUN_TEST(test_setpoint_step_does_not_kick_derivative);
+    return UNITY_END();
+}
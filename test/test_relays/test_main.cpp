@@ -0,0 +1,215 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "RelayDriver.cpp"
+#include "RelayScheduler.cpp"
+#include "TraceBuffer.cpp"
+
+static const int AUGER_PIN = 25;
+static const int FAN_PIN = 26;
+static const int IGNITER_PIN = 27;
+
+static RelayScheduler *scheduler;
+
+// The pre-scheduler augerPWM(): relay state decided whenever loop() gets to it
+static bool legacyPWM(int percent, float periodSeconds)
+{
+    static unsigned long cycleStartTime = 0;
+    static bool cycleInitialized = false;
+
+    if (!cycleInitialized)
+    {
+        cycleStartTime = millis();
+        cycleInitialized = true;
+    }
+
+    unsigned long periodMillis = (unsigned long)(periodSeconds * 1000.0);
+    unsigned long onTimeMillis = (unsigned long)((percent / 100.0) * periodMillis);
+    unsigned long elapsedTime = millis() - cycleStartTime;
+
+    if (elapsedTime >= periodMillis)
+    {
+        cycleStartTime = millis();
+        elapsedTime = 0;
+    }
+    return (elapsedTime < onTimeMillis);
+}
+
+// Tracks the pulses seen on a pin, sampled every time the clock moves
+struct PulseMeter
+{
+    int pin;
+    bool on;
+    uint64_t risingUs;
+    unsigned long pulses;
+    unsigned long maxErrorUs; // largest |pulse - expectedUs|
+
+    void sample(uint64_t expectedUs)
+    {
+        bool level = digitalRead(pin) == On;
+        if (level && !on)
+            risingUs = HostClock::micros();
+        if (!level && on)
+        {
+            uint64_t lengthUs = HostClock::micros() - risingUs;
+            unsigned long errorUs = lengthUs > expectedUs ? lengthUs - expectedUs : expectedUs - lengthUs;
+            maxErrorUs = max(maxErrorUs, errorUs);
+            pulses++;
+        }
+        on = level;
+    }
+};
+
+void setUp()
+{
+    HostClock::set(0);
+    scheduler = new RelayScheduler();
+    scheduler->begin(AUGER_PIN, FAN_PIN, IGNITER_PIN);
+}
+
+void tearDown()
+{
+    esp_timer_stop(HostTimer::last());
+    delete scheduler;
+}
+
+void test_duty_cycle_edges_on_schedule()
+{
+    scheduler->setDuty(RelayScheduler::Auger, 30.0f, 10.0f);
+    scheduler->setDuty(RelayScheduler::Fan, 75.0f, 2.0f);
+    PulseMeter auger = {AUGER_PIN};
+    PulseMeter fan = {FAN_PIN};
+    uint64_t startUs = HostClock::micros();
+    for (int ms = 0; ms < 100000; ms++)
+    {
+        HostTimer::run(1000);
+        auger.sample(3000000);
+        fan.sample(1500000);
+        // Rising edges on the absolute 10 s schedule
+        if (auger.on && auger.risingUs == HostClock::micros())
+            TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)((auger.risingUs - startUs - RelayScheduler::TICK_US) % 10000000));
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, auger.pulses);
+    TEST_ASSERT_EQUAL_UINT32(50, fan.pulses);
+    TEST_ASSERT_EQUAL_UINT32(0, auger.maxErrorUs);
+    TEST_ASSERT_EQUAL_UINT32(0, fan.maxErrorUs);
+
+    RelayScheduler::CycleStats stats = scheduler->getStats(RelayScheduler::Auger);
+    TEST_ASSERT_EQUAL_UINT32(3000000, stats.commandedOnUs);
+    TEST_ASSERT_EQUAL_UINT32(3000000, stats.achievedOnUs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.maxErrorUs);
+    TEST_ASSERT_EQUAL_UINT32(9, stats.cycles);
+}
+
+// A foreground loop() held up by slow HTTP requests for up to 400 ms at a
+// time: the legacy loop-polled PWM stretches pulses by the stall, the
+// scheduler's timer keeps them to the tick
+void test_foreground_stalls_do_not_stretch_pulses()
+{
+    scheduler->setDuty(RelayScheduler::Auger, 30.0f, 10.0f);
+    PulseMeter legacy = {AUGER_PIN + 1};
+    PulseMeter timed = {AUGER_PIN};
+    uint32_t seed = 12345;
+    while (HostClock::micros() < 600000000ULL)
+    {
+        digitalWrite(legacy.pin, legacyPWM(30, 10.0f) ? On : Off);
+        legacy.sample(3000000);
+        seed = seed * 1103515245 + 12345;
+        unsigned long stallMs = (seed >> 16) % 8 == 0 ? (seed >> 8) % 400 : 2;
+        for (unsigned long ms = 0; ms < stallMs; ms++)
+        {
+            HostTimer::run(1000);
+            timed.sample(3000000);
+        }
+    }
+
+    RelayScheduler::CycleStats stats = scheduler->getStats(RelayScheduler::Auger);
+    char message[120];
+    snprintf(message, sizeof(message), "worst pulse error over %lu cycles: loop-polled %lu ms, timer %lu us",
+             stats.cycles, legacy.maxErrorUs / 1000, stats.maxErrorUs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN(100000, legacy.maxErrorUs);
+    TEST_ASSERT_LESS_OR_EQUAL(RelayScheduler::TICK_US, stats.maxErrorUs);
+    TEST_ASSERT_LESS_OR_EQUAL(RelayScheduler::TICK_US, timed.maxErrorUs);
+    TEST_ASSERT_GREATER_OR_EQUAL(58, stats.cycles);
+}
+
+// The timer task itself held off: the achieved on-time reports the error
+void test_stats_report_timer_jitter()
+{
+    scheduler->setDuty(RelayScheduler::Auger, 50.0f, 1.0f);
+    int64_t nowUs = 0;
+    uint32_t seed = 1;
+    for (int tick = 0; tick < 20000; tick++)
+    {
+        seed = seed * 1103515245 + 12345;
+        nowUs += RelayScheduler::TICK_US;
+        scheduler->tick(nowUs + (seed >> 16) % 700); // up to 0.7 ms late
+    }
+    RelayScheduler::CycleStats stats = scheduler->getStats(RelayScheduler::Auger);
+    TEST_ASSERT_EQUAL_UINT32(19, stats.cycles);
+    TEST_ASSERT_EQUAL_UINT32(500000, stats.commandedOnUs);
+    TEST_ASSERT_EQUAL((long)stats.achievedOnUs - (long)stats.commandedOnUs, stats.lastErrorUs);
+    TEST_ASSERT_GREATER_THAN(0, stats.maxErrorUs);
+    TEST_ASSERT_LESS_OR_EQUAL(RelayScheduler::TICK_US + 700, stats.maxErrorUs);
+
+    scheduler->resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler->getStats(RelayScheduler::Auger).cycles);
+}
+
+void test_duty_change_takes_effect_without_re_energizing()
+{
+    scheduler->setDuty(RelayScheduler::Auger, 50.0f, 10.0f);
+    HostTimer::run(2000000);
+    TEST_ASSERT_EQUAL(On, digitalRead(AUGER_PIN));
+
+    // Shorter duty cuts the running pulse at once...
+    scheduler->setDuty(RelayScheduler::Auger, 10.0f, 10.0f);
+    HostTimer::run(1000);
+    TEST_ASSERT_EQUAL(Off, digitalRead(AUGER_PIN));
+
+    // ...and a longer one does not switch it back on before the next cycle
+    scheduler->setDuty(RelayScheduler::Auger, 80.0f, 10.0f);
+    HostTimer::run(7000000);
+    TEST_ASSERT_EQUAL(Off, digitalRead(AUGER_PIN));
+    HostTimer::run(1000000);
+    TEST_ASSERT_EQUAL(On, digitalRead(AUGER_PIN));
+}
+
+void test_idle_output_starts_at_once()
+{
+    scheduler->setDuty(RelayScheduler::Fan, 0.0f, 10.0f);
+    HostTimer::run(3000000);
+    TEST_ASSERT_EQUAL(Off, digitalRead(FAN_PIN));
+
+    scheduler->setDuty(RelayScheduler::Fan, 20.0f, 10.0f);
+    HostTimer::run(1000);
+    TEST_ASSERT_EQUAL(On, digitalRead(FAN_PIN));
+    HostTimer::run(2000000);
+    TEST_ASSERT_EQUAL(Off, digitalRead(FAN_PIN));
+}
+
+void test_igniter_on_off()
+{
+    scheduler->setOn(RelayScheduler::Igniter, true);
+    HostTimer::run(1000);
+    TEST_ASSERT_EQUAL(On, digitalRead(IGNITER_PIN));
+    HostTimer::run(60000000);
+    TEST_ASSERT_EQUAL(On, digitalRead(IGNITER_PIN));
+    TEST_ASSERT_EQUAL_UINT32(1, RelayDriver::getStats(RelayDriver::Igniter).transitions);
+
+    scheduler->setOn(RelayScheduler::Igniter, false);
+    HostTimer::run(RelayScheduler::TICK_US);
+    TEST_ASSERT_EQUAL(Off, digitalRead(IGNITER_PIN));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_duty_cycle_edges_on_schedule);
+    RUN_TEST(test_foreground_stalls_do_not_stretch_pulses);
+    RUN_TEST(test_stats_report_timer_jitter);
+    RUN_TEST(test_duty_change_takes_effect_without_re_energizing);
+    RUN_TEST(test_idle_output_starts_at_once);
+    RUN_TEST(test_igniter_on_off);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "SensorAcquisition.cpp"
+#include "TraceBuffer.cpp"
+#include "max6675.cpp"
+
+static const int FIRE_POT_CS = 5;
+static const int SMOKE_CHAMBER_CS = 4;
+
+// MAX6675 register for a temperature: 0.25C per count from bit 3
+static uint16_t rawFor(float celsius)
+{
+    return (uint16_t)(celsius / 0.25f) << 3;
+}
+
+static SensorAcquisition *acquisition;
+
+void setUp()
+{
+    HostClock::set(0);
+    MockSpiBus::reset();
+    MockSpiBus::attach(FIRE_POT_CS, rawFor(400.0f));
+    MockSpiBus::attach(SMOKE_CHAMBER_CS, rawFor(100.0f));
+    acquisition = new SensorAcquisition();
+    acquisition->begin(18, 19, FIRE_POT_CS, SMOKE_CHAMBER_CS);
+}
+
+void tearDown()
+{
+    delete acquisition;
+}
+
+void test_prime_reads_both_channels()
+{
+    acquisition->prime();
+    ThermocoupleSample firePot = acquisition->getSample(SensorAcquisition::FirePot);
+    ThermocoupleSample smokeChamber = acquisition->getSample(SensorAcquisition::SmokeChamber);
+    TEST_ASSERT_EQUAL_UINT32(1, firePot.sequence);
+    TEST_ASSERT_EQUAL_UINT32(1, smokeChamber.sequence);
+    TEST_ASSERT_EQUAL_FLOAT(752.0f, firePot.temperatureF);
+    TEST_ASSERT_EQUAL_FLOAT(212.0f, smokeChamber.temperatureF);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::strayTransfers());
+}
+
+void test_decodes_quarter_degrees_and_open_circuit()
+{
+    MockSpiBus::chip(FIRE_POT_CS)->raw = rawFor(20.25f);
+    MockSpiBus::chip(SMOKE_CHAMBER_CS)->raw = rawFor(100.0f) | 0x4;
+    acquisition->prime();
+
+    ThermocoupleSample firePot = acquisition->getSample(SensorAcquisition::FirePot);
+    TEST_ASSERT_FALSE(firePot.openCircuit);
+    TEST_ASSERT_EQUAL_FLOAT(68.45f, firePot.temperatureF);
+
+    ThermocoupleSample smokeChamber = acquisition->getSample(SensorAcquisition::SmokeChamber);
+    TEST_ASSERT_TRUE(smokeChamber.openCircuit);
+    TEST_ASSERT_EQUAL_FLOAT(32.0f, smokeChamber.temperatureF);
+    TEST_ASSERT_EQUAL_UINT16(rawFor(100.0f) | 0x4, smokeChamber.raw);
+}
+
+// task() from a 1 ms loop: each chip read once per conversion, never early,
+// the channels half a conversion apart and at most one transfer per call
+void test_task_respects_conversion_time_and_staggers_channels()
+{
+    unsigned long lastReadMs[SensorAcquisition::ChannelCount] = {};
+    uint32_t lastSequence[SensorAcquisition::ChannelCount] = {};
+    unsigned long lastAnyReadMs = 0;
+    for (int ms = 0; ms < 10000; ms++)
+    {
+        HostClock::advanceMs(1);
+        uint32_t transfers = MockSpiBus::transfers();
+        acquisition->task();
+        TEST_ASSERT_LESS_OR_EQUAL(1, MockSpiBus::transfers() - transfers);
+
+        for (int channel = 0; channel < SensorAcquisition::ChannelCount; channel++)
+        {
+            ThermocoupleSample sample = acquisition->getSample((SensorAcquisition::Channel)channel);
+            if (sample.sequence == lastSequence[channel])
+                continue;
+            TEST_ASSERT_EQUAL_UINT32(lastSequence[channel] + 1, sample.sequence);
+            TEST_ASSERT_EQUAL_UINT32(millis(), sample.timestampMs);
+            if (lastSequence[channel] > 0)
+                TEST_ASSERT_EQUAL_UINT32(MAX6675::CONVERSION_TIME_MS, sample.timestampMs - lastReadMs[channel]);
+            if (lastAnyReadMs > 0)
+                TEST_ASSERT_GREATER_OR_EQUAL(MAX6675::CONVERSION_TIME_MS / 2, sample.timestampMs - lastAnyReadMs);
+            lastSequence[channel] = sample.sequence;
+            lastReadMs[channel] = sample.timestampMs;
+            lastAnyReadMs = sample.timestampMs;
+        }
+    }
+
+    for (int channel = 0; channel < SensorAcquisition::ChannelCount; channel++)
+        TEST_ASSERT_UINT32_WITHIN(1, 10000 / MAX6675::CONVERSION_TIME_MS, lastSequence[channel]);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::chip(FIRE_POT_CS)->earlyReads);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::chip(SMOKE_CHAMBER_CS)->earlyReads);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::strayTransfers());
+}
+
+// A loop() held up for longer than a conversion reads each chip once when it
+// comes back, then returns to the conversion period
+void test_late_task_reads_once_and_resumes()
+{
+    acquisition->prime();
+    HostClock::advanceMs(1000);
+    uint32_t transfers = MockSpiBus::transfers();
+    acquisition->task();
+    acquisition->task();
+    acquisition->task();
+    TEST_ASSERT_EQUAL_UINT32(2, MockSpiBus::transfers() - transfers);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::chip(FIRE_POT_CS)->earlyReads);
+    TEST_ASSERT_EQUAL_UINT32(0, MockSpiBus::chip(SMOKE_CHAMBER_CS)->earlyReads);
+}
+
+// Time loop() spends blocked reading both thermocouples: the bit-banged
+// readFahrenheit() against the hardware SPI task() (simulated clock), and the
+// host cost of a task() call that has nothing due
+void test_benchmark_acquisition_blocking_time()
+{
+    MAX6675 bitBanged(18, 15, 19);
+    uint64_t startUs = HostClock::micros();
+    bitBanged.readFahrenheit();
+    bitBanged.readFahrenheit();
+    uint64_t bitBangedUs = HostClock::micros() - startUs;
+
+    acquisition->prime();
+    HostClock::advanceMs(MAX6675::CONVERSION_TIME_MS);
+    startUs = HostClock::micros();
+    acquisition->task();
+    uint64_t hardwareUs = HostClock::micros() - startUs;
+    TEST_ASSERT_EQUAL_UINT32(2, acquisition->getSample(SensorAcquisition::FirePot).sequence);
+
+    const int calls = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+        acquisition->task();
+    double idleNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+
+    char message[160];
+    snprintf(message, sizeof(message), "per loop(): bit-banged %u us blocked, hardware SPI %u us delay (+4 us transfer), idle task() %.1f ns host",
+             (unsigned)bitBangedUs, (unsigned)hardwareUs, idleNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_OR_EQUAL(600, bitBangedUs);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)hardwareUs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_prime_reads_both_channels);
+    RUN_TEST(test_decodes_quarter_degrees_and_open_circuit);
+    RUN_TEST(test_task_respects_conversion_time_and_staggers_channels);
+    RUN_TEST(test_late_task_reads_once_and_resumes);
+    RUN_TEST(test_benchmark_acquisition_blocking_time);
+    return UNITY_END();
+}
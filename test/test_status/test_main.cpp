@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "SensorHealth.cpp"
+#include "StatusCache.cpp"
+#include "Telemetry.cpp"
+
+static const int CLIENTS = 4; // phones and a dashboard polling every second
+
+static StatusCache *cache;
+
+static void publish(float smokeChamberTemp)
+{
+    TelemetrySnapshot snapshot = {};
+    snapshot.timestampMs = millis();
+    snapshot.smokeChamberTemp = smokeChamberTemp;
+    snapshot.firePotTemp = 612.5f;
+    snapshot.setpoint = 225.0f;
+    snapshot.smokesetpoint = 50.0f;
+    strlcpy(snapshot.activeState, "Running", sizeof(snapshot.activeState));
+    snapshot.augerMode = 2;
+    snapshot.augerDutyCycle = 41.5f;
+    snapshot.augerFrequency = 0.1f;
+    snapshot.fanMode = 2;
+    snapshot.fanDutyCycle = 55.0f;
+    snapshot.fanFrequency = 0.1f;
+    snapshot.smokeChamberSensor.valid = true;
+    snapshot.firePotSensor.valid = true;
+    Telemetry::publish(snapshot);
+}
+
+// What handleGetStatus() did on every poll before the cache: a document
+// from the live data, serialized into a heap String
+static String legacyStatus()
+{
+    TelemetrySnapshot snapshot;
+    Telemetry::read(snapshot);
+    StaticJsonDocument<512> doc;
+    doc["smokeChamberTemp"] = snapshot.smokeChamberTemp;
+    doc["firePotTemp"] = snapshot.firePotTemp;
+    doc["operating"]["setpoint"] = snapshot.setpoint;
+    doc["operating"]["smokesetpoint"] = snapshot.smokesetpoint;
+    doc["operating"]["activeState"] = snapshot.activeState;
+    doc["igniterMode"] = snapshot.igniterMode;
+    doc["augerMode"] = snapshot.augerMode;
+    doc["augerDutyCycle"] = snapshot.augerDutyCycle;
+    doc["augerFrequency"] = snapshot.augerFrequency;
+    doc["fanMode"] = snapshot.fanMode;
+    doc["fanDutyCycle"] = snapshot.fanDutyCycle;
+    doc["fanFrequency"] = snapshot.fanFrequency;
+    String response;
+    serializeJson(doc, response);
+    return response;
+}
+
+void setUp()
+{
+    HostClock::advanceMs(500);
+    cache = new StatusCache();
+    cache->begin();
+}
+
+void tearDown()
+{
+    delete cache;
+}
+
+void test_body_is_the_latest_snapshot()
+{
+    publish(226.5f);
+    StatusCache::Lock lock(*cache);
+    cache->refresh();
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, cache->getJson(), cache->getLength()));
+    TEST_ASSERT_EQUAL_UINT32(Telemetry::getVersion(), doc["version"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_FLOAT(226.5f, doc["smokeChamberTemp"].as<float>());
+    TEST_ASSERT_EQUAL_STRING("Running", doc["operating"]["activeState"].as<const char *>());
+    TEST_ASSERT_TRUE(doc["sensors"]["firePot"]["valid"].as<bool>());
+    TEST_ASSERT_LESS_THAN(StatusCache::SIZE - 1, cache->getLength());
+}
+
+// The ETag stays put between ticks, so a poll with it gets a 304, and
+// changes with the next published snapshot
+void test_etag_follows_the_snapshot_version()
+{
+    publish(225.0f);
+    StatusCache::Lock lock(*cache);
+    cache->refresh();
+    String etag = cache->getETag();
+    TEST_ASSERT_EQUAL(Telemetry::getVersion(), cache->getVersion());
+    TEST_ASSERT_TRUE(cache->matches(etag));
+
+    cache->refresh();
+    TEST_ASSERT_TRUE(cache->matches(etag));
+
+    publish(225.25f);
+    TEST_ASSERT_TRUE(cache->matches(etag)); // until the next request refreshes it
+    cache->refresh();
+    TEST_ASSERT_FALSE(cache->matches(etag));
+    TEST_ASSERT_TRUE(cache->matches(cache->getETag()));
+    TEST_ASSERT_FALSE(cache->matches(""));
+    TEST_ASSERT_FALSE(cache->matches("*"));
+}
+
+void test_empty_cache_never_matches()
+{
+    TEST_ASSERT_FALSE(cache->matches(""));
+    TEST_ASSERT_FALSE(cache->matches(cache->getETag()));
+}
+
+template <typename Poll>
+static double nsPerPoll(Poll poll)
+{
+    const int ticks = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        publish(225.0f + tick % 7);
+        for (int client = 0; client < CLIENTS; client++)
+            poll();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (ticks * CLIENTS);
+}
+
+// Handler work per poll with four clients polling each control tick: the old
+// serialize-per-request, the cache sending the 200 body, and the cache
+// answering a poll that already has the tick with a 304
+void test_benchmark_handler_latency()
+{
+    static char socket[StatusCache::SIZE];
+    volatile size_t sent = 0;
+
+    double legacyNs = nsPerPoll([&]()
+    {
+        String response = legacyStatus();
+        memcpy(socket, response.c_str(), response.length());
+        sent = response.length();
+    });
+    double cachedNs = nsPerPoll([&]()
+    {
+        StatusCache::Lock lock(*cache);
+        cache->refresh();
+        memcpy(socket, cache->getJson(), cache->getLength());
+        sent = cache->getLength();
+    });
+    String etag;
+    double notModifiedNs = nsPerPoll([&]()
+    {
+        StatusCache::Lock lock(*cache);
+        cache->refresh();
+        if (!cache->matches(etag))
+        {
+            memcpy(socket, cache->getJson(), cache->getLength());
+            etag = cache->getETag();
+        }
+    });
+    (void)sent;
+
+    char message[160];
+    snprintf(message, sizeof(message), "per poll, %d clients: serialize each %.0f ns, cached 200 %.0f ns, 304 %.0f ns",
+             CLIENTS, legacyNs, cachedNs, notModifiedNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(legacyNs, cachedNs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_body_is_the_latest_snapshot);
+    RUN_TEST(test_etag_follows_the_snapshot_version);
+    RUN_TEST(test_empty_cache_never_matches);
+    RUN_TEST(test_benchmark_handler_latency);
+    return UNITY_END();
+}
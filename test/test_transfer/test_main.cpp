@@ -0,0 +1,132 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "TransferFunction.cpp"
+
+SmokerConfig smokerConfig;
+
+// Stock tables from SmokerControl.cpp: {duty %, input}
+static const float AUGER_TABLE[11][2] = {{33.0f, 175.0f}, {37.0f, 200.0f}, {41.0f, 225.0f}, {47.0f, 250.0f},
+                                         {52.0f, 275.0f}, {58.0f, 300.0f}, {64.0f, 325.0f}, {72.0f, 350.0f},
+                                         {80.0f, 375.0f}, {90.0f, 400.0f}, {100.0f, 425.0f}};
+static const float FAN_TABLE[11][2] = {{100.0f, 0.0f}, {95.0f, 10.0f}, {90.0f, 20.0f}, {85.0f, 30.0f},
+                                       {80.0f, 40.0f}, {75.0f, 50.0f}, {70.0f, 60.0f}, {65.0f, 70.0f},
+                                       {60.0f, 80.0f}, {55.0f, 90.0f}, {50.0f, 100.0f}};
+
+// The evaluation AugerControlTask() did before: copy to the stack, then scan
+static float legacyEvaluate(const float table[11][2], float input)
+{
+    float dutyCycleArray[11];
+    float tempArray[11];
+    for (int i = 0; i < 11; i++)
+    {
+        dutyCycleArray[i] = table[i][0];
+        tempArray[i] = table[i][1];
+    }
+    return lookupTableInterpolate(input, tempArray, dutyCycleArray, 11);
+}
+
+static void assertMatchesLinearScan(const float table[11][2], float from, float to)
+{
+    CompiledCurve curve;
+    TEST_ASSERT_TRUE(curve.compile(table, 11, 1, 0));
+    for (float input = from; input <= to; input += (to - from) / 9973.0f)
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, legacyEvaluate(table, input), curve.evaluate(input));
+    // Breakpoints exactly, and clamping outside the table
+    for (int i = 0; i < 11; i++)
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, table[i][0], curve.evaluate(table[i][1]));
+    TEST_ASSERT_EQUAL_FLOAT(table[0][0], curve.evaluate(table[0][1] - 1000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(table[10][0], curve.evaluate(table[10][1] + 1000.0f));
+}
+
+void setUp()
+{
+    memcpy(smokerConfig.tunable.augerTransferFunc, AUGER_TABLE, sizeof(AUGER_TABLE));
+    memcpy(smokerConfig.tunable.fanTransferFunc, FAN_TABLE, sizeof(FAN_TABLE));
+    InvalidateTransferFunctions();
+}
+
+void tearDown() {}
+
+void test_stock_tables_match_the_linear_scan()
+{
+    assertMatchesLinearScan(AUGER_TABLE, 150.0f, 450.0f);
+    assertMatchesLinearScan(FAN_TABLE, -10.0f, 110.0f);
+}
+
+// Narrow segments among wide ones need more cells than MAX_CELLS,
+// so the cell index is capped and lookup walks a few segments
+void test_irregular_table_matches_the_linear_scan()
+{
+    const float narrow[11][2] = {{0.0f, 100.0f}, {5.0f, 100.5f}, {10.0f, 160.0f}, {12.0f, 161.0f},
+                                 {40.0f, 300.0f}, {41.0f, 300.25f}, {60.0f, 380.0f}, {61.0f, 381.0f},
+                                 {62.0f, 382.0f}, {90.0f, 420.0f}, {100.0f, 500.0f}};
+    assertMatchesLinearScan(narrow, 90.0f, 510.0f);
+}
+
+// A table that is not strictly increasing cannot be compiled; evaluation
+// falls back to the linear scan on the live table
+void test_non_monotonic_table_falls_back()
+{
+    float table[11][2];
+    memcpy(table, AUGER_TABLE, sizeof(table));
+    table[5][1] = table[4][1];
+    CompiledCurve curve;
+    TEST_ASSERT_FALSE(curve.compile(table, 11, 1, 0));
+    TEST_ASSERT_FALSE(curve.isValid());
+
+    memcpy(smokerConfig.tunable.augerTransferFunc, table, sizeof(table));
+    InvalidateTransferFunctions();
+    for (float setpoint = 150.0f; setpoint < 450.0f; setpoint += 3.7f)
+        TEST_ASSERT_EQUAL_FLOAT(legacyEvaluate(table, setpoint), EvaluateAugerTransferFunction(setpoint));
+}
+
+// A POST /api/tunable or a config load calls InvalidateTransferFunctions()
+// after changing a table; the next evaluation uses the new curve
+void test_invalidate_recompiles()
+{
+    TEST_ASSERT_EQUAL_FLOAT(58.0f, EvaluateAugerTransferFunction(300.0f));
+    TEST_ASSERT_EQUAL_FLOAT(75.0f, EvaluateFanTransferFunction(50.0f));
+
+    smokerConfig.tunable.augerTransferFunc[5][0] = 60.0f;
+    smokerConfig.tunable.fanTransferFunc[5][0] = 70.0f;
+    InvalidateTransferFunctions();
+    TEST_ASSERT_EQUAL_FLOAT(60.0f, EvaluateAugerTransferFunction(300.0f));
+    TEST_ASSERT_EQUAL_FLOAT(70.0f, EvaluateFanTransferFunction(50.0f));
+}
+
+template <typename Evaluate>
+static double nsPerEvaluation(Evaluate evaluate)
+{
+    const int evaluations = 2000000;
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < evaluations; i++)
+        sink = evaluate(175.0f + (i % 2500) * 0.1f);
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / evaluations;
+}
+
+// Cost of one auger duty lookup over setpoints spread across the table
+void test_benchmark_compiled_against_linear_scan()
+{
+    double legacyNs = nsPerEvaluation([](float setpoint) { return legacyEvaluate(smokerConfig.tunable.augerTransferFunc, setpoint); });
+    double compiledNs = nsPerEvaluation([](float setpoint) { return EvaluateAugerTransferFunction(setpoint); });
+
+    char message[100];
+    snprintf(message, sizeof(message), "auger lookup: copy + linear scan %.1f ns, compiled %.1f ns (%.1fx)",
+             legacyNs, compiledNs, legacyNs / compiledNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(legacyNs, compiledNs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stock_tables_match_the_linear_scan);
+    RUN_TEST(test_irregular_table_matches_the_linear_scan);
+    RUN_TEST(test_non_monotonic_table_falls_back);
+    RUN_TEST(test_invalidate_recompiles);
+    RUN_TEST(test_benchmark_compiled_against_linear_scan);
+    return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Load test for the smoker controller's web interface.
+
+Hammers the HTTP endpoints from several concurrent clients and reports the
+throughput and latency of each, and the control-task jitter the controller
+recorded meanwhile (/api/scheduler), next to an idle baseline taken first.
+Run it against either firmware (RelayBoard or RelayBoardAsync) to compare
+the web servers:
+
+    python3 tools/loadtest.py 192.168.1.50 --clients 8 --duration 60
+
+Only GETs and idempotent requests are sent; nothing changes the cook. The
+scheduler statistics are reset at the start of the baseline and of the load.
+Standard library only.
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+# Path, weight: what a few phones and a dashboard do, plus chart loads and downloads
+ENDPOINTS = [
+    ("/api/status", 40),
+    ("/api/tunable", 5),
+    ("/api/recipe", 5),
+    ("/api/buttons", 5),
+    ("/api/actuators", 5),
+    ("/api/outputs/stats", 5),
+    ("/api/scheduler", 5),
+    ("/api/profile", 3),
+    ("/api/auger/feed", 3),
+    ("/api/logging/config", 3),
+    ("/api/spiffs/list", 3),
+    ("/api/logging/data?duration=60&points=200", 8),
+    ("/api/logging/data?duration=60", 4),
+]
+
+# Whole-log CSV download, added with --downloads
+DOWNLOAD = ("/api/logging/download", 2)
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {}
+        self.errors = {}
+        self.bytes = 0
+
+    def add(self, path, seconds, length, error):
+        with self.lock:
+            if error:
+                self.errors[path] = self.errors.get(path, 0) + 1
+            else:
+                self.latencies.setdefault(path, []).append(seconds)
+                self.bytes += length
+
+
+def fetch(base, path, timeout, method="GET"):
+    request = urllib.request.Request(base + path, method=method, data=b"" if method == "POST" else None)
+    with urllib.request.urlopen(request, timeout=timeout) as response:
+        length = 0
+        while True:
+            chunk = response.read(4096)
+            if not chunk:
+                return length
+            length += len(chunk)
+
+
+def scheduler_stats(base, timeout):
+    request = urllib.request.Request(base + "/api/scheduler")
+    with urllib.request.urlopen(request, timeout=timeout) as response:
+        return json.load(response)["tasks"]
+
+
+def reset_scheduler(base, timeout):
+    fetch(base, "/api/scheduler/reset", timeout, method="POST")
+
+
+def client(base, schedule, deadline, timeout, stats):
+    index = 0
+    while time.monotonic() < deadline:
+        path = schedule[index % len(schedule)]
+        index += 1
+        start = time.monotonic()
+        try:
+            length = fetch(base, path, timeout)
+            stats.add(path, time.monotonic() - start, length, False)
+        except (urllib.error.URLError, OSError):
+            stats.add(path, time.monotonic() - start, 0, True)
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def print_jitter(title, tasks):
+    print(title)
+    print("  %-14s %8s %12s %12s %8s %8s" % ("task", "runs", "mean jitter", "max jitter", "missed", "overruns"))
+    for task in tasks:
+        print("  %-14s %8d %9.0f us %9d us %8d %8d" % (
+            task["name"], task["runs"], task["meanJitterUs"], task["maxJitterUs"],
+            task["missedDeadlines"], task["overruns"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("host", help="controller address, e.g. 192.168.1.50 or smoker.local:80")
+    parser.add_argument("--clients", type=int, default=8, help="concurrent clients (default 8)")
+    parser.add_argument("--duration", type=float, default=30.0, help="seconds of load (default 30)")
+    parser.add_argument("--baseline", type=float, default=10.0, help="idle seconds measured first, 0 to skip (default 10)")
+    parser.add_argument("--timeout", type=float, default=10.0, help="per-request timeout in seconds (default 10)")
+    parser.add_argument("--downloads", action="store_true", help="include whole-log CSV downloads")
+    parser.add_argument("--json", action="store_true", help="print the results as JSON")
+    args = parser.parse_args()
+
+    base = args.host if args.host.startswith("http") else "http://" + args.host
+    endpoints = ENDPOINTS + ([DOWNLOAD] if args.downloads else [])
+    schedule = [path for path, weight in endpoints for _ in range(weight)]
+
+    try:
+        baseline = None
+        if args.baseline > 0:
+            reset_scheduler(base, args.timeout)
+            time.sleep(args.baseline)
+            baseline = scheduler_stats(base, args.timeout)
+
+        reset_scheduler(base, args.timeout)
+        stats = Stats()
+        start = time.monotonic()
+        deadline = start + args.duration
+        threads = []
+        for number in range(args.clients):
+            # Each client starts at a different point of the mix
+            offset = number * len(schedule) // args.clients
+            thread = threading.Thread(target=client, daemon=True,
+                                      args=(base, schedule[offset:] + schedule[:offset], deadline, args.timeout, stats))
+            thread.start()
+            threads.append(thread)
+        for thread in threads:
+            thread.join()
+        elapsed = time.monotonic() - start
+        loaded = scheduler_stats(base, args.timeout)
+    except (urllib.error.URLError, OSError, ValueError, KeyError) as error:
+        print("loadtest: cannot reach %s: %s" % (base, error), file=sys.stderr)
+        return 1
+
+    requests = sum(len(values) for values in stats.latencies.values())
+    errors = sum(stats.errors.values())
+    endpoints_report = []
+    for path, _ in endpoints:
+        values = stats.latencies.get(path, [])
+        endpoints_report.append({
+            "path": path,
+            "requests": len(values),
+            "errors": stats.errors.get(path, 0),
+            "p50Ms": percentile(values, 0.5) * 1000 if values else None,
+            "p95Ms": percentile(values, 0.95) * 1000 if values else None,
+            "maxMs": max(values) * 1000 if values else None,
+        })
+
+    if args.json:
+        json.dump({
+            "clients": args.clients,
+            "seconds": elapsed,
+            "requests": requests,
+            "errors": errors,
+            "requestsPerSecond": requests / elapsed,
+            "bytesPerSecond": stats.bytes / elapsed,
+            "endpoints": endpoints_report,
+            "baselineTasks": baseline,
+            "loadedTasks": loaded,
+        }, sys.stdout, indent=2)
+        print()
+        return 0 if errors == 0 else 2
+
+    print("%d clients for %.1f s: %d requests (%.1f/s), %d errors, %.1f KB/s" % (
+        args.clients, elapsed, requests, requests / elapsed, errors, stats.bytes / elapsed / 1024))
+    print("  %-42s %7s %6s %9s %9s %9s" % ("endpoint", "count", "errors", "p50", "p95", "max"))
+    for row in endpoints_report:
+        if row["requests"]:
+            print("  %-42s %7d %6d %6.0f ms %6.0f ms %6.0f ms" % (
+                row["path"], row["requests"], row["errors"], row["p50Ms"], row["p95Ms"], row["maxMs"]))
+        else:
+            print("  %-42s %7d %6d" % (row["path"], 0, row["errors"]))
+    print()
+    if baseline is not None:
+        print_jitter("Control tasks, idle (%g s):" % args.baseline, baseline)
+    print_jitter("Control tasks, under load:", loaded)
+    return 0 if errors == 0 else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())